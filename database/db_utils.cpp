@@ -1,7 +1,12 @@
 #include "db_utils.h"
 #include "../utils/hash_utils.h"
+#include "../services/friend_graph.h"
+#include "../services/post_store.h"
+#include "../utils/time_utils.h"
+#include "../utils/id_generator.h"
 #include <vector>
 #include <sstream>
+#include <iostream>
 
 bool checkCredentials(sqlite3* db, const std::string& username, const std::string& password){
     std::string hashedPassword = hashed(password);
@@ -49,7 +54,7 @@ bool registerUser(sqlite3* db, const std::string& username, const std::string& p
     return success;
 }
 // Posts
-int createPost(sqlite3* db, const std::string& username, const std::string& content) {
+int64_t createPost(sqlite3* db, const std::string& username, const std::string& content) {
     std::string userIdQuery = "SELECT id FROM users WHERE username = ?;";
     sqlite3_stmt* userStmt;
     int userId = -1;
@@ -61,28 +66,34 @@ int createPost(sqlite3* db, const std::string& username, const std::string& cont
         sqlite3_finalize(userStmt);
     }
     if (userId == -1) return -1;
-    std::string query = "INSERT INTO posts (user_id, content) VALUES (?, ?);";
+    int64_t postId = IdGenerator::posts().next();
+    std::string query = "INSERT INTO posts (id, user_id, content, created_at) VALUES (?, ?, ?, ?);";
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
         return -1;
-    sqlite3_bind_int(stmt, 1, userId);
-    sqlite3_bind_text(stmt, 2, content.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 1, postId);
+    sqlite3_bind_int(stmt, 2, userId);
+    sqlite3_bind_text(stmt, 3, content.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 4, IdGenerator::millisOf(postId));
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
     if (success) {
-        return sqlite3_last_insert_rowid(db);
+        return postId;
     }
     return -1;
 }
 
-bool deletePost(sqlite3* db, int postId) {
+bool deletePost(sqlite3* db, int64_t postId) {
     std::string query = "DELETE FROM posts WHERE id = ?;";
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
         return false;
-    sqlite3_bind_int(stmt, 1, postId);
+    sqlite3_bind_int64(stmt, 1, postId);
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
+    if (success) {
+        PostStore::instance().invalidate(postId);
+    }
     return success;
 }
 // Feed database utilities
@@ -118,7 +129,7 @@ std::string getFeed(sqlite3* db, const std::string& username) {
         oss << friendIds[i];
         if (i < friendIds.size() - 1) oss << ",";
     }
-    oss << ") ORDER BY posts.created_at DESC;";
+    oss << ") ORDER BY posts.id DESC;";
     std::string postsQuery = oss.str();
     
     sqlite3_stmt* postsStmt;
@@ -128,12 +139,12 @@ std::string getFeed(sqlite3* db, const std::string& username) {
         while (sqlite3_step(postsStmt) == SQLITE_ROW) {
             if (!first) feedData += ",";
             first = false;
-            feedData += "{\"post_id\":" + std::to_string(sqlite3_column_int(postsStmt, 0)) +
+            feedData += "{\"post_id\":" + std::to_string(sqlite3_column_int64(postsStmt, 0)) +
                         ",\"username\":\"" + std::string(reinterpret_cast<const char*>(sqlite3_column_text(postsStmt, 1))) +
                         "\",\"content\":\"" + std::string(reinterpret_cast<const char*>(sqlite3_column_text(postsStmt, 2))) +
                         "\",\"like_count\":" + std::to_string(sqlite3_column_int(postsStmt, 3)) +
                         ",\"comment_count\":" + std::to_string(sqlite3_column_int(postsStmt, 4)) +
-                        ",\"created_at\":\"" + std::string(reinterpret_cast<const char*>(sqlite3_column_text(postsStmt, 5))) + "\"}";
+                        ",\"created_at\":\"" + time_utils::toIso8601(columnEpochSeconds(postsStmt, 5)) + "\"}";
         }
         sqlite3_finalize(postsStmt);
     }
@@ -142,7 +153,7 @@ std::string getFeed(sqlite3* db, const std::string& username) {
 }
 
 std::string getUserPosts(sqlite3* db, const std::string& username) {
-    std::string query = "SELECT posts.id, posts.content, posts.like_count, posts.comment_count, posts.created_at FROM posts JOIN users ON posts.user_id = users.id WHERE users.username = ? ORDER BY posts.created_at DESC;";
+    std::string query = "SELECT posts.id, posts.content, posts.like_count, posts.comment_count, posts.created_at FROM posts JOIN users ON posts.user_id = users.id WHERE users.username = ? ORDER BY posts.id DESC;";
     sqlite3_stmt* stmt;
     std::string userPostsData = "[";
     bool first = true;
@@ -151,11 +162,11 @@ std::string getUserPosts(sqlite3* db, const std::string& username) {
         while (sqlite3_step(stmt) == SQLITE_ROW) {
             if (!first) userPostsData += ",";
             first = false;
-            userPostsData += "{\"post_id\":" + std::to_string(sqlite3_column_int(stmt, 0)) +
+            userPostsData += "{\"post_id\":" + std::to_string(sqlite3_column_int64(stmt, 0)) +
                              ",\"content\":\"" + std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1))) +
                              "\",\"like_count\":" + std::to_string(sqlite3_column_int(stmt, 2)) +
                              ",\"comment_count\":" + std::to_string(sqlite3_column_int(stmt, 3)) +
-                             ",\"created_at\":\"" + std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4))) + "\"}";
+                             ",\"created_at\":\"" + time_utils::toIso8601(columnEpochSeconds(stmt, 4)) + "\"}";
         }
         sqlite3_finalize(stmt);
     }
@@ -163,7 +174,7 @@ std::string getUserPosts(sqlite3* db, const std::string& username) {
     return userPostsData;
 }
 
-bool likePost(sqlite3* db, int postId, const std::string& username) {
+bool likePost(sqlite3* db, int64_t postId, const std::string& username) {
     std::string userIdQuery = "SELECT id FROM users WHERE username = ?;";
     sqlite3_stmt* userStmt;
     int userId = -1;
@@ -175,27 +186,29 @@ bool likePost(sqlite3* db, int postId, const std::string& username) {
         sqlite3_finalize(userStmt);
     }
     if (userId == -1) return false;
-    std::string query = "INSERT INTO likes (user_id, post_id) VALUES (?, ?);";
+    std::string query = "INSERT INTO likes (user_id, post_id, created_at) VALUES (?, ?, ?);";
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
         return false;
     sqlite3_bind_int(stmt, 1, userId);
-    sqlite3_bind_int(stmt, 2, postId);
+    sqlite3_bind_int64(stmt, 2, postId);
+    sqlite3_bind_int64(stmt, 3, time_utils::nowMillis());
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
     if (success) {
         std::string updateQuery = "UPDATE posts SET like_count = like_count + 1 WHERE id = ?;";
         sqlite3_stmt* updateStmt;
         if (sqlite3_prepare_v2(db, updateQuery.c_str(), -1, &updateStmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int(updateStmt, 1, postId);
+            sqlite3_bind_int64(updateStmt, 1, postId);
             sqlite3_step(updateStmt);
             sqlite3_finalize(updateStmt);
         }
+        PostStore::instance().invalidate(postId);
     }
     return success;
 }
 
-bool unlikePost(sqlite3* db, int postId, const std::string& username) {
+bool unlikePost(sqlite3* db, int64_t postId, const std::string& username) {
     std::string userIdQuery = "SELECT id FROM users WHERE username = ?;";
     sqlite3_stmt* userStmt;
     int userId = -1;
@@ -212,22 +225,23 @@ bool unlikePost(sqlite3* db, int postId, const std::string& username) {
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
         return false;
     sqlite3_bind_int(stmt, 1, userId);
-    sqlite3_bind_int(stmt, 2, postId);
+    sqlite3_bind_int64(stmt, 2, postId);
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
     if (success) {
         std::string updateQuery = "UPDATE posts SET like_count = like_count - 1 WHERE id = ? AND like_count > 0;";
         sqlite3_stmt* updateStmt;
         if (sqlite3_prepare_v2(db, updateQuery.c_str(), -1, &updateStmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int(updateStmt, 1, postId);
+            sqlite3_bind_int64(updateStmt, 1, postId);
             sqlite3_step(updateStmt);
             sqlite3_finalize(updateStmt);
         }
+        PostStore::instance().invalidate(postId);
     }
     return success;
 }
 
-int commentOnPost(sqlite3* db, int postId, const std::string& username, const std::string& comment) {
+int64_t commentOnPost(sqlite3* db, int64_t postId, const std::string& username, const std::string& comment) {
     std::string userIdQuery = "SELECT id FROM users WHERE username = ?;";
     sqlite3_stmt* userStmt;
     int userId = -1;
@@ -239,36 +253,40 @@ int commentOnPost(sqlite3* db, int postId, const std::string& username, const st
         sqlite3_finalize(userStmt);
     }
     if (userId == -1) return -1;
-    std::string query = "INSERT INTO comments (post_id, user_id, content) VALUES (?, ?, ?);";
+    int64_t commentId = IdGenerator::comments().next();
+    std::string query = "INSERT INTO comments (id, post_id, user_id, content, created_at) VALUES (?, ?, ?, ?, ?);";
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
         return -1;
-    sqlite3_bind_int(stmt, 1, postId);
-    sqlite3_bind_int(stmt, 2, userId);
-    sqlite3_bind_text(stmt, 3, comment.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 1, commentId);
+    sqlite3_bind_int64(stmt, 2, postId);
+    sqlite3_bind_int(stmt, 3, userId);
+    sqlite3_bind_text(stmt, 4, comment.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 5, IdGenerator::millisOf(commentId));
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
     if (success) {
         std::string updateQuery = "UPDATE posts SET comment_count = comment_count + 1 WHERE id = ?;";
         sqlite3_stmt* updateStmt;
         if (sqlite3_prepare_v2(db, updateQuery.c_str(), -1, &updateStmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int(updateStmt, 1, postId);
+            sqlite3_bind_int64(updateStmt, 1, postId);
             sqlite3_step(updateStmt);
             sqlite3_finalize(updateStmt);
         }
-        return sqlite3_last_insert_rowid(db);
+        PostStore::instance().invalidate(postId);
+        return commentId;
     }
     return -1;
 }
 
-bool deleteComment(sqlite3* db, int commentId) {
-    int postId = -1;
+bool deleteComment(sqlite3* db, int64_t commentId) {
+    int64_t postId = -1;
     std::string postIdQuery = "SELECT post_id FROM comments WHERE id = ?;";
     sqlite3_stmt* postStmt;
     if (sqlite3_prepare_v2(db, postIdQuery.c_str(), -1, &postStmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_int(postStmt, 1, commentId);
+        sqlite3_bind_int64(postStmt, 1, commentId);
         if (sqlite3_step(postStmt) == SQLITE_ROW) {
-            postId = sqlite3_column_int(postStmt, 0);
+            postId = sqlite3_column_int64(postStmt, 0);
         }
         sqlite3_finalize(postStmt);
     }
@@ -277,17 +295,18 @@ bool deleteComment(sqlite3* db, int commentId) {
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
         return false;
-    sqlite3_bind_int(stmt, 1, commentId);
+    sqlite3_bind_int64(stmt, 1, commentId);
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
     if (success) {
         std::string updateQuery = "UPDATE posts SET comment_count = comment_count - 1 WHERE id = ? AND comment_count > 0;";
         sqlite3_stmt* updateStmt;
         if (sqlite3_prepare_v2(db, updateQuery.c_str(), -1, &updateStmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int(updateStmt, 1, postId);
+            sqlite3_bind_int64(updateStmt, 1, postId);
             sqlite3_step(updateStmt);
             sqlite3_finalize(updateStmt);
         }
+        PostStore::instance().invalidate(postId);
     }
     return success;
 }
@@ -307,11 +326,12 @@ bool addFriend(sqlite3* db, const std::string& username, const std::string& frie
         sqlite3_finalize(userStmt);
     }
     if (userId == -1 || friendId == -1) return false;
-    std::string query = "INSERT INTO friends (requester_id, addressee_id, status) VALUES (?, ?, 'pending');";
+    std::string query = "INSERT INTO friends (requester_id, addressee_id, status, created_at) VALUES (?, ?, 'pending', ?);";
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) return false;
     sqlite3_bind_int(stmt, 1, userId);
     sqlite3_bind_int(stmt, 2, friendId);
+    sqlite3_bind_int64(stmt, 3, time_utils::nowMillis());
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
     return success;
@@ -341,10 +361,18 @@ bool removefriend(sqlite3* db, const std::string& username, const std::string& f
     sqlite3_bind_int(stmt, 4, userId);
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
+    if (success && sqlite3_changes(db) > 0) {
+        FriendGraph::instance().removeFriendship(username, friendUsername);
+    }
     return success;
 }
 
-std::string getFriendsList(sqlite3* db, const std::string& username) {
+std::vector<std::string> getFriendNames(sqlite3* db, const std::string& username) {
+    FriendGraph& graph = FriendGraph::instance();
+    if (graph.loaded()) {
+        return graph.friendsOf(username);
+    }
+
     std::string userIdQuery = "SELECT id FROM users WHERE username = ?;";
     sqlite3_stmt* userStmt;
     int userId = -1;
@@ -353,22 +381,30 @@ std::string getFriendsList(sqlite3* db, const std::string& username) {
         if (sqlite3_step(userStmt) == SQLITE_ROW) userId = sqlite3_column_int(userStmt, 0);
         sqlite3_finalize(userStmt);
     }
-    if (userId == -1) return "[]";
+    std::vector<std::string> friends;
+    if (userId == -1) return friends;
     std::string query = "SELECT u.username FROM users u JOIN friends f ON (u.id = f.addressee_id OR u.id = f.requester_id) WHERE f.status = 'accepted' AND (f.requester_id = ? OR f.addressee_id = ?) AND u.id != ?;";
     sqlite3_stmt* stmt;
-    std::string friendsListData = "[";
-    bool first = true;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
         sqlite3_bind_int(stmt, 1, userId);
         sqlite3_bind_int(stmt, 2, userId);
         sqlite3_bind_int(stmt, 3, userId);
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            if (!first) friendsListData += ",";
-            first = false;
-            friendsListData += "\"" + std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))) + "\"";
+            friends.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
         }
         sqlite3_finalize(stmt);
     }
+    return friends;
+}
+
+std::string getFriendsList(sqlite3* db, const std::string& username) {
+    std::string friendsListData = "[";
+    bool first = true;
+    for (const std::string& friendName : getFriendNames(db, username)) {
+        if (!first) friendsListData += ",";
+        first = false;
+        friendsListData += "\"" + friendName + "\"";
+    }
     friendsListData += "]";
     return friendsListData;
 }
@@ -436,7 +472,7 @@ std::string getNotifications(sqlite3* db, const std::string& username) {
                                  ",\"type\":\"" + std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1))) +
                                  "\",\"message\":\"" + std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2))) +
                                  "\",\"is_read\":" + std::to_string(sqlite3_column_int(stmt, 3)) +
-                                 ",\"created_at\":\"" + std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4))) + "\"}";
+                                 ",\"created_at\":\"" + time_utils::toIso8601(columnEpochSeconds(stmt, 4)) + "\"}";
         }
         sqlite3_finalize(stmt);
     }
@@ -490,6 +526,10 @@ std::vector<std::string> getAllUsersExcept(sqlite3* db, const std::string& exclu
 }
 
 bool areFriends(sqlite3* db, const std::string& user1, const std::string& user2) {
+    FriendGraph& graph = FriendGraph::instance();
+    if (graph.loaded()) {
+        return graph.areFriends(user1, user2);
+    }
     std::string query = R"(
         SELECT COUNT(*) FROM friends f
         JOIN users u1 ON f.requester_id = u1.id
@@ -575,4 +615,164 @@ std::string getUserInfo(sqlite3* db, const std::string& username) {
         sqlite3_finalize(stmt);
     }
     return userInfo;
-}
\ No newline at end of file
+}
+// Timestamps
+std::time_t columnEpochSeconds(sqlite3_stmt* stmt, int column) {
+    switch (sqlite3_column_type(stmt, column)) {
+    case SQLITE_INTEGER: {
+        int64_t millis = sqlite3_column_int64(stmt, column);
+        return static_cast<std::time_t>(millis >= 0 ? millis / 1000 : (millis - 999) / 1000);
+    }
+    case SQLITE_TEXT: {
+        // Rows written before the migration (or by an older binary) still hold DATETIME text
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+        int64_t millis;
+        if (text && time_utils::parseDateTime(text, millis)) {
+            return static_cast<std::time_t>(millis / 1000);
+        }
+        return 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+static bool replaceLegacyTimestampDefaults(sqlite3* db) {
+    int schemaVersion = -1;
+    sqlite3_stmt* stmt;
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    if (sqlite3_prepare_v2(db, "PRAGMA schema_version;", -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            schemaVersion = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    const char* rewrite =
+        "UPDATE sqlite_master SET sql = replace(sql, 'created_at DATETIME DEFAULT CURRENT_TIMESTAMP',"
+        " 'created_at INTEGER DEFAULT (CAST(ROUND((julianday(''now'') - 2440587.5) * 86400000) AS INTEGER))')"
+        " WHERE type = 'table' AND name IN ('posts', 'comments', 'likes', 'friends', 'notifications')"
+        " AND instr(sql, 'created_at DATETIME DEFAULT CURRENT_TIMESTAMP') > 0;";
+    bool ok = schemaVersion >= 0 &&
+              sqlite3_exec(db, "PRAGMA writable_schema = ON;", nullptr, nullptr, nullptr) == SQLITE_OK &&
+              sqlite3_exec(db, rewrite, nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (ok && sqlite3_changes(db) > 0) {
+        // Makes every connection, this one included, reparse the schema
+        std::string bump = "PRAGMA schema_version = " + std::to_string(schemaVersion + 1) + ";";
+        ok = sqlite3_exec(db, bump.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    sqlite3_exec(db, "PRAGMA writable_schema = OFF;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, ok ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr);
+    return ok;
+}
+
+bool migrateTimestampsToEpochMillis(sqlite3* db) {
+    sqlite3_stmt* stmt;
+    int version = 0;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (version >= kSchemaVersionEpochMillis) {
+        return true;
+    }
+
+    // Convert in small batches, each in its own transaction, so a large table never holds
+    // the write lock for long. Rows whose text doesn't parse become NULL and drop out.
+    const int kBatchSize = 1000;
+    const char* tables[] = {"posts", "comments", "likes", "friends", "notifications"};
+    for (const char* table : tables) {
+        std::string query = std::string("UPDATE ") + table +
+            " SET created_at = CAST(ROUND((julianday(created_at) - 2440587.5) * 86400000) AS INTEGER)"
+            " WHERE rowid IN (SELECT rowid FROM " + table + " WHERE typeof(created_at) = 'text' LIMIT ?);";
+        if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            continue;  // Table doesn't exist in this database
+        }
+        sqlite3_bind_int(stmt, 1, kBatchSize);
+        int converted = 0;
+        while (true) {
+            sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr);
+            int rc = sqlite3_step(stmt);
+            int changed = sqlite3_changes(db);
+            sqlite3_exec(db, rc == SQLITE_DONE ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr);
+            sqlite3_reset(stmt);
+            if (rc != SQLITE_DONE) {
+                std::cerr << "Timestamp migration failed on " << table << ": " << sqlite3_errmsg(db) << std::endl;
+                sqlite3_finalize(stmt);
+                return false;
+            }
+            if (changed == 0) {
+                break;
+            }
+            converted += changed;
+        }
+        sqlite3_finalize(stmt);
+        if (converted > 0) {
+            std::cout << "Converted " << converted << " " << table << ".created_at values to epoch ms" << std::endl;
+        }
+    }
+
+    // Tables created by the old schema still default created_at to DATETIME text. Swap in the
+    // epoch-ms default of schema.sql by editing the stored definition: SQLite documents this
+    // for default changes since the rows on disk don't change, so no table is copied.
+    if (!replaceLegacyTimestampDefaults(db)) {
+        std::cerr << "Timestamp default migration failed: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+
+    std::string setVersion = "PRAGMA user_version = " + std::to_string(kSchemaVersionEpochMillis) + ";";
+    return sqlite3_exec(db, setVersion.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+void seedIdGenerators(sqlite3* db) {
+    // Ids already stored stay as they are: old autoincrement ids are small and time-ordered
+    // among themselves, so they sort below everything the generators hand out. This only
+    // guards against reusing an id written by another process or a clock that stepped back.
+    struct Seed { const char* query; IdGenerator& generator; };
+    Seed seeds[] = {
+        {"SELECT MAX(id) FROM posts;", IdGenerator::posts()},
+        {"SELECT MAX(id) FROM comments;", IdGenerator::comments()},
+    };
+    for (const Seed& seed : seeds) {
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, seed.query, -1, &stmt, nullptr) != SQLITE_OK) {
+            continue;
+        }
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            seed.generator.seedAbove(sqlite3_column_int64(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+    }
+}
+
+sqlite3* threadReadConnection(const std::string& path) {
+    struct Connection {
+        std::string path;
+        sqlite3* db = nullptr;
+        ~Connection() {
+            if (db) {
+                sqlite3_close(db);
+            }
+        }
+    };
+    thread_local Connection connection;
+    if (connection.db != nullptr && connection.path == path) {
+        return connection.db;
+    }
+    if (connection.db != nullptr) {
+        sqlite3_close(connection.db);
+        connection.db = nullptr;
+    }
+    if (sqlite3_open_v2(path.c_str(), &connection.db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "Can't open " << path << " for reading: " << sqlite3_errmsg(connection.db) << std::endl;
+        sqlite3_close(connection.db);
+        connection.db = nullptr;
+        return nullptr;
+    }
+    sqlite3_busy_timeout(connection.db, 1000);
+    connection.path = path;
+    return connection.db;
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include <sqlite3.h>
+#include <cstdint>
+#include <ctime>
 #include <string>
 #include <vector>
 // login and signup
@@ -7,20 +9,21 @@ bool checkCredentials(sqlite3* db, const std::string& username, const std::strin
 bool userExists(sqlite3* db, const std::string& username);
 bool registerUser(sqlite3* db, const std::string& username, const std::string& password);
 // Posts
-int createPost(sqlite3* db, const std::string& username, const std::string& content); // returns postId
-bool deletePost(sqlite3* db, int postId);
+int64_t createPost(sqlite3* db, const std::string& username, const std::string& content); // returns postId
+bool deletePost(sqlite3* db, int64_t postId);
 // Feed
 std::string getFeed(sqlite3* db, const std::string& username); // returns JSON string
 // std::string getUserPosts(sqlite3* db, const std::string& username); // returns JSON string
 // Likes
-// bool likePost(sqlite3* db, int postId, const std::string& username);
-// bool unlikePost(sqlite3* db, int postId, const std::string& username);
+// bool likePost(sqlite3* db, int64_t postId, const std::string& username);
+// bool unlikePost(sqlite3* db, int64_t postId, const std::string& username);
 // Comments 
-// int commentOnPost(sqlite3* db, int postId, const std::string& username, const std::string& comment); // returns commentId
-// bool deleteComment(sqlite3* db, int commentId);
+// int64_t commentOnPost(sqlite3* db, int64_t postId, const std::string& username, const std::string& comment); // returns commentId
+// bool deleteComment(sqlite3* db, int64_t commentId);
 // friends
 bool addFriend(sqlite3* db, const std::string& username, const std::string& friendUsername);
 bool removefriend(sqlite3* db, const std::string& username, const std::string& friendUsername);
+std::vector<std::string> getFriendNames(sqlite3* db, const std::string& username); // from FriendGraph once loaded
 std::string getFriendsList(sqlite3* db, const std::string& username); // returns JSON string
 // profile
 std::string getProfile(sqlite3* db, const std::string& username); // returns JSON string
@@ -37,4 +40,13 @@ std::string getUserInfo(sqlite3* db, const std::string& username); // returns JS
 bool updateUser(sqlite3* db, const std::string& user_id, const std::string& username, const std::string& password_hash, const std::string& profile_pic, const std::string& bio);
 bool deleteUser(sqlite3* db, const std::string& user_id);
 bool getUserByUsername(sqlite3* db, const std::string& username, std::string& user_id, std::string& password_hash, std::string& profile_pic, std::string& bio, time_t& created_at);
-bool getUserByID(sqlite3* db, const std::string& user_id, std::string& username, std::string& password_hash, std::string& profile_pic, std::string& bio, time_t& created_at);
\ No newline at end of file
+bool getUserByID(sqlite3* db, const std::string& user_id, std::string& username, std::string& password_hash, std::string& profile_pic, std::string& bio, time_t& created_at);
+// Timestamps: created_at columns hold integer epoch milliseconds (PRAGMA user_version >= 1)
+const int kSchemaVersionEpochMillis = 1;
+std::time_t columnEpochSeconds(sqlite3_stmt* stmt, int column); // also reads legacy DATETIME text
+bool migrateTimestampsToEpochMillis(sqlite3* db); // converts existing rows in batches, once
+// Post and comment ids come from IdGenerator; call once at startup, before the first insert
+void seedIdGenerators(sqlite3* db);
+// Read-only connection to the database file at path, owned by the calling thread: opened on
+// first use and closed when the thread exits. For worker threads that mustn't share a handle.
+sqlite3* threadReadConnection(const std::string& path);
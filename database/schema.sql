@@ -7,20 +7,23 @@ CREATE TABLE IF NOT EXISTS users  (
     created_at DATETIME DEFAULT CURRENT_TIMESTAMP
 );
 
+-- created_at here and on likes, comments, friends and notifications is integer epoch
+-- milliseconds; migrateTimestampsToEpochMillis() converts rows stored as DATETIME text, and the
+-- CURRENT_TIMESTAMP defaults of tables created before that
 CREATE TABLE IF NOT EXISTS posts  (
     id INTEGER PRIMARY KEY,
     user_id INTEGER,
     content TEXT,
     like_count INTEGER DEFAULT 0,
     comment_count INTEGER DEFAULT 0,
-    created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+    created_at INTEGER DEFAULT (CAST(ROUND((julianday('now') - 2440587.5) * 86400000) AS INTEGER)),
     FOREIGN KEY (user_id) REFERENCES users (id)
 );
 
 CREATE TABLE IF NOT EXISTS likes (
     user_id INTEGER,
     post_id INTEGER,
-    created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+    created_at INTEGER DEFAULT (CAST(ROUND((julianday('now') - 2440587.5) * 86400000) AS INTEGER)),
     PRIMARY KEY (user_id, post_id),
     FOREIGN KEY (user_id) REFERENCES users (id),
     FOREIGN KEY (post_id) REFERENCES posts (id)
@@ -31,7 +34,7 @@ CREATE TABLE IF NOT EXISTS comments (
     post_id INTEGER,
     user_id INTEGER,
     content TEXT,
-    created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+    created_at INTEGER DEFAULT (CAST(ROUND((julianday('now') - 2440587.5) * 86400000) AS INTEGER)),
     FOREIGN KEY (post_id) REFERENCES posts (id),
     FOREIGN KEY (user_id) REFERENCES users (id)
 );
@@ -41,7 +44,7 @@ CREATE TABLE IF NOT EXISTS friends (
     requester_id INTEGER,
     addressee_id INTEGER,
     status TEXT CHECK (status IN ('pending', 'accepted', 'declined')),
-    created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+    created_at INTEGER DEFAULT (CAST(ROUND((julianday('now') - 2440587.5) * 86400000) AS INTEGER)),
     FOREIGN KEY (requester_id) REFERENCES users (id),
     FOREIGN KEY (addressee_id) REFERENCES users (id)
 );
@@ -53,7 +56,7 @@ CREATE TABLE IF NOT EXISTS notifications (
     reference_id INTEGER,
     message TEXT,
     is_read BOOLEAN DEFAULT 0,
-    created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+    created_at INTEGER DEFAULT (CAST(ROUND((julianday('now') - 2440587.5) * 86400000) AS INTEGER)),
     FOREIGN KEY (user_id) REFERENCES users (id)
 );
 
@@ -61,11 +64,36 @@ CREATE TABLE IF NOT EXISTS feed (
     id INTEGER PRIMARY KEY,
     user_id INTEGER,
     post_id INTEGER,
-    shown_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+    shown_at INTEGER DEFAULT (CAST(ROUND((julianday('now') - 2440587.5) * 86400000) AS INTEGER)),
     FOREIGN KEY (user_id) REFERENCES users (id),
     FOREIGN KEY (post_id) REFERENCES posts (id)
 );
 
+-- Decayed interaction score of viewer with author's posts, written back by AffinityStore;
+-- score was current at updated_at (epoch milliseconds)
+CREATE TABLE IF NOT EXISTS affinity (
+    viewer_id INTEGER,
+    author_id INTEGER,
+    score REAL,
+    updated_at INTEGER,
+    PRIMARY KEY (viewer_id, author_id),
+    FOREIGN KEY (viewer_id) REFERENCES users (id),
+    FOREIGN KEY (author_id) REFERENCES users (id)
+);
+
+-- Each user's stored friend suggestions in rank order, written by SuggestionStore; built_at
+-- (epoch milliseconds) is when the list was computed
+CREATE TABLE IF NOT EXISTS friend_suggestions (
+    user_id INTEGER,
+    rank INTEGER,
+    suggested_id INTEGER,
+    mutual_friends INTEGER,
+    built_at INTEGER,
+    PRIMARY KEY (user_id, rank),
+    FOREIGN KEY (user_id) REFERENCES users (id),
+    FOREIGN KEY (suggested_id) REFERENCES users (id)
+);
+
 CREATE TABLE IF NOT EXISTS profile (
     id INTEGER PRIMARY KEY,
     user_id INTEGER UNIQUE,
@@ -77,3 +105,18 @@ CREATE TABLE IF NOT EXISTS profile (
     FOREIGN KEY (user_id) REFERENCES users (id)
 );
 
+-- Post and comment ids are time-sortable (see utils/id_generator.h), so "newest first" is
+-- ORDER BY id DESC. Every index entry ends with the rowid, which is the id, so these serve
+-- per-author and per-post scans in time order without a sort.
+CREATE INDEX IF NOT EXISTS idx_posts_user ON posts (user_id);
+CREATE INDEX IF NOT EXISTS idx_comments_post ON comments (post_id);
+
+-- One row per post a user has been shown, with shown_at in epoch milliseconds (FeedLog
+-- writes INSERT OR IGNORE). Also serves "newest post shown" and "which of these were
+-- shown" as ranges over one user's entries.
+CREATE UNIQUE INDEX IF NOT EXISTS idx_feed_user_post ON feed (user_id, post_id);
+
+-- Both sides of a user's friend requests and friendships, by status, as index ranges
+-- (search results resolve relationships for a whole page with one lookup per side)
+CREATE INDEX IF NOT EXISTS idx_friends_requester ON friends (requester_id, status);
+CREATE INDEX IF NOT EXISTS idx_friends_addressee ON friends (addressee_id, status);
@@ -10,16 +10,16 @@ crow::response handle_create_comment(sqlite3* db, const crow::request& req, cons
     try {
         std::cout << "RAW BODY: " << req.body << std::endl;
         auto body = json::parse(req.body);
-        int post_id;
+        int64_t post_id;
         if (body["post_id"].is_number()) {
             post_id = body["post_id"];
         } else if (body["post_id"].is_string()) {
-            post_id = std::stoi(body["post_id"].get<std::string>());
+            post_id = std::stoll(body["post_id"].get<std::string>());
         } else {
             return crow::response(400, "Invalid post_id type");
         }
         std::string content = body["content"];
-        int result = CommentService::createComment(db, post_id, username, content);
+        int64_t result = CommentService::createComment(db, post_id, username, content);
         if (result != -1) {
             return crow::response(201, "Comment added successfully.");
         } else {
@@ -36,7 +36,7 @@ crow::response handle_get_comments(sqlite3* db, const crow::request& req) {
     if (!url_post_id) {
         return crow::response(400, "Missing post_id");
     }
-    int post_id = std::stoi(url_post_id);
+    int64_t post_id = std::stoll(url_post_id);
     auto comments = CommentService::getCommentsByPost(post_id);
     json res = json::array();
     for (const auto& comment : comments) {
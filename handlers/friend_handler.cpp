@@ -1,6 +1,8 @@
 #include "friend_handler.h"
 #include "../services/friend_search_service.h"
-#include "../services/friend_suggestion_service.h"
+#include "../services/suggestion_store.h"
+#include "../services/timeline_precomputer.h"
+#include "../services/timeline_push_hub.h"
 #include "login_handler.h"  // for get_session_from_cookie, active_sessions
 
 // All handlers proxy to FriendSearchService and enforce session
@@ -81,6 +83,12 @@ crow::response handleRespondToFriendRequest(sqlite3* db, const crow::request& re
     else if (action == "reject")
         ok = service.rejectFriendRequest(requester, addressee);
 
+    if (ok && action == "accept") {
+        TimelinePrecomputer::instance().invalidateUser(requester);
+        TimelinePrecomputer::instance().invalidateUser(addressee);
+        TimelinePushHub::instance().reloadFriends(db, requester);
+        TimelinePushHub::instance().reloadFriends(db, addressee);
+    }
     if (ok)
         return crow::response(200, R"({"success":true,"message":"Friend request processed"})");
     return crow::response(400, R"({"success":false,"message":"Failed to process friend request"})");
@@ -97,8 +105,13 @@ crow::response handleRemoveFriend(sqlite3* db, const crow::request& req) {
     std::string user2 = body["friend_username"].s();
 
     FriendSearchService service(db);
-    if (service.removeFriend(user1, user2))
+    if (service.removeFriend(user1, user2)) {
+        TimelinePrecomputer::instance().invalidateUser(user1);
+        TimelinePrecomputer::instance().invalidateUser(user2);
+        TimelinePushHub::instance().reloadFriends(db, user1);
+        TimelinePushHub::instance().reloadFriends(db, user2);
         return crow::response(200, R"({"success":true,"message":"Friend removed"})");
+    }
     return crow::response(400, R"({"success":false,"message":"Failed to remove friend"})");
 }
 
@@ -109,9 +122,8 @@ crow::response handleGetFriendSuggestions(sqlite3* db, const crow::request& req)
     std::string username = active_sessions[session_id];
     int limit = req.url_params.get("limit") ? std::stoi(req.url_params.get("limit")) : 20;
 
-    // Use AVL tree-based friend suggestion service
-    FriendSuggestionService suggestionService(db);
-    auto suggestions = suggestionService.suggestFriends(username, limit);
+    // Stored per user and rebuilt in the background when nearby friendships change
+    auto suggestions = SuggestionStore::instance().suggestionsFor(db, username, limit);
 
 
 
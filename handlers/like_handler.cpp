@@ -12,11 +12,11 @@ crow::response handleToggleLike(sqlite3* db, const crow::request& req, const std
             return crow::response(400, "Missing post_id");
         }
         
-        int post_id;
+        int64_t post_id;
         if (body["post_id"].is_number()) {
             post_id = body["post_id"];
         } else if (body["post_id"].is_string()) {
-            post_id = std::stoi(body["post_id"].get<std::string>());
+            post_id = std::stoll(body["post_id"].get<std::string>());
         } else {
             return crow::response(400, "Invalid post_id type");
         }
@@ -46,7 +46,7 @@ crow::response handleGetLikeStatus(sqlite3* db, const crow::request& req, const
     }
     
     try {
-        int post_id = std::stoi(post_id_param);
+        int64_t post_id = std::stoll(post_id_param);
         bool is_liked = LikeService::isPostLikedByUser(db, post_id, username);
         
         json response = {
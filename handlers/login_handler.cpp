@@ -2,6 +2,7 @@
 #include <crow.h>
 #include "../database/db_utils.h"
 #include "../utils/hash_utils.h"
+#include "../services/timeline_precomputer.h"
 #include <iostream>
 #include <sstream>
 #include <unordered_map>
@@ -37,6 +38,7 @@ crow::response handle_login(sqlite3* db, const crow::request& req) {
         // Generate session ID and store it
         std::string session_id = generate_session_id(); // generate ID if the credintials are correct
         active_sessions[session_id] = username; // mapping it to the username
+        TimelinePrecomputer::instance().noteLogin(username); // timeline page is usually the next request
         
         // Create JSON response with redirect and set cookie
         crow::response res(200);
@@ -2,6 +2,9 @@
 // post_handler.cpp
 #include "post_handler.h"
 #include "../services/post_service.h"
+#include "../services/timeline_change_feed.h"
+#include "../services/timeline_precomputer.h"
+#include "../services/timeline_push_hub.h"
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -14,11 +17,14 @@ crow::response PostHandler::handleCreatePost(const crow::request& req, const std
         std::string privacy = body.value("privacy", "Public");
 
         std::cerr << "[CreatePost] user_name: " << username << ", content: " << content << std::endl;
-        int result = PostService::createPost(username, content, image_url);
+        int64_t result = PostService::createPost(username, content, image_url);
         if (result == -1) {
             std::cerr << "[CreatePost] Failed: user not found or DB error." << std::endl;
             return crow::response(400, "Failed to create post: user not found or DB error");
         }
+        TimelinePrecomputer::instance().invalidateAuthor(username);
+        TimelineChangeFeed::instance().recordPost(result, username);
+        TimelinePushHub::instance().notifyPost(username, result);
         return crow::response(201, "Post created successfully");
     } catch (const std::exception& e) {
         std::cerr << "[CreatePost] Exception: " << e.what() << std::endl;
@@ -34,7 +40,7 @@ crow::response PostHandler::handleGetAllPosts() {
             {"id", post.getId()},
             {"user_name", post.getUserName()},
             {"content", post.getContent()},
-            {"timestamp", std::to_string(post.getcreated_at())},
+            {"timestamp", post.getTimestamp()},
             {"like_count", post.getLikeCount()},
             {"comment_count", post.getCommentCount()}
         });
@@ -1,4 +1,5 @@
 #include "search_handler.h"
+#include "../services/post_store.h"
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -21,18 +22,13 @@ namespace search_handler {
             return crow::response(200, response.dump());
         }
         
-        // Prepare SQL query to search posts by content and username
+        // Find the matching post ids; the post records themselves come from the shared store
         const char* sql = R"(
-            SELECT p.id, p.user_id, p.content, p.created_at, u.username as user_name,
-                   COUNT(DISTINCT l.id) as like_count,
-                   COUNT(DISTINCT c.id) as comment_count
+            SELECT p.id, p.user_id
             FROM posts p
             JOIN users u ON p.user_id = u.id
-            LEFT JOIN likes l ON p.id = l.post_id
-            LEFT JOIN comments c ON p.id = c.post_id
             WHERE p.content LIKE ? OR u.username LIKE ?
-            GROUP BY p.id, p.user_id, p.content, p.created_at, u.username
-            ORDER BY p.created_at DESC
+            ORDER BY p.id DESC
             LIMIT 20
         )";
         
@@ -49,19 +45,12 @@ namespace search_handler {
         sqlite3_bind_text(stmt, 1, search_pattern.c_str(), -1, SQLITE_STATIC);
         sqlite3_bind_text(stmt, 2, search_pattern.c_str(), -1, SQLITE_STATIC);
         
-        json posts_array = json::array();
+        std::vector<int64_t> post_ids;
+        std::vector<int> user_ids;
         
         while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-            json post;
-            post["id"] = sqlite3_column_int(stmt, 0);
-            post["user_id"] = sqlite3_column_int(stmt, 1);
-            post["content"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-            post["timestamp"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-            post["user_name"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-            post["like_count"] = sqlite3_column_int(stmt, 5);
-            post["comment_count"] = sqlite3_column_int(stmt, 6);
-            
-            posts_array.push_back(post);
+            post_ids.push_back(sqlite3_column_int64(stmt, 0));
+            user_ids.push_back(sqlite3_column_int(stmt, 1));
         }
         
         sqlite3_finalize(stmt);
@@ -71,6 +60,24 @@ namespace search_handler {
             return crow::response(500, "Database error");
         }
         
+        json posts_array = json::array();
+        auto posts = PostStore::instance().multiGet(db, post_ids);
+        for (size_t i = 0; i < posts.size(); i++) {
+            if (!posts[i]) {
+                continue;  // Deleted between the search and the fetch
+            }
+            json post;
+            post["id"] = posts[i]->getId();
+            post["user_id"] = user_ids[i];
+            post["content"] = posts[i]->getContent();
+            post["timestamp"] = posts[i]->getTimestamp();
+            post["user_name"] = posts[i]->getUserName();
+            post["like_count"] = posts[i]->getLikeCount();
+            post["comment_count"] = posts[i]->getCommentCount();
+            
+            posts_array.push_back(post);
+        }
+        
         json response;
         response["posts"] = posts_array;
         
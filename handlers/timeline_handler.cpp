@@ -1,44 +1,235 @@
 #include "timeline_handler.h"
+#include "../database/db_utils.h"
 #include "../services/dynamic_timeline_service.h"
+#include "../services/feed_log.h"
+#include "../services/post_store.h"
+#include "../services/timeline_change_feed.h"
+#include "../services/timeline_precomputer.h"
+#include "../services/timeline_response_cache.h"
 #include "../services/Post.h"
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
 
 using json = nlohmann::json;
 
+namespace {
+    bool requestUsername(const crow::request& req, std::string& username) {
+        if (req.url_params.get("username")) {
+            username = req.url_params.get("username");
+            return true;
+        }
+        auto body = crow::json::load(req.body);
+        if (body && body["username"].t() == crow::json::type::String) {
+            username = body["username"].s();
+            return true;
+        }
+        return false;
+    }
+
+    json postJson(const Post& post) {
+        return {
+            {"id", post.getId()},
+            {"user_name", post.getUserName()},
+            {"content", post.getContent()},
+            {"image_url", post.getImageUrl()},
+            {"timestamp", post.getTimestamp()},
+            {"like_count", post.getLikeCount()},
+            {"comment_count", post.getCommentCount()}
+        };
+    }
+
+    std::string timelineBody(const std::vector<Post>& posts, std::vector<int64_t>& postIds) {
+        json res = json::array();
+        postIds.reserve(posts.size());
+        for (const auto& post : posts) {
+            res.push_back(postJson(post));
+            postIds.push_back(post.getId());
+        }
+        std::cout << "Returning " << posts.size() << " posts in timeline" << std::endl;
+        return res.dump();
+    }
+
+    // Headers for a response that won't be kept in TimelineResponseCache; the caller keeps
+    // the body itself and moves it into the reply
+    std::shared_ptr<const TimelineResponseCache::Response> uncachedResponse(const std::string& body, int64_t nextCursor) {
+        auto response = std::make_shared<TimelineResponseCache::Response>();
+        response->etag = TimelineResponseCache::makeEtag(body);
+        response->nextCursor = nextCursor;
+        return response;
+    }
+}
+
 namespace timeline_handler {
     crow::response handle_get_timeline(sqlite3* db, const crow::request& req) {
         std::string username;
+        if (!requestUsername(req, username)) {
+            return crow::response(400, "Missing username parameter");
+        }
         
-        if (req.url_params.get("username")) {
-            username = req.url_params.get("username");
+        int64_t cursor = 0;  // Id of the oldest post already shown; 0 for the first page
+        if (req.url_params.get("cursor")) {
+            try {
+                cursor = std::stoll(req.url_params.get("cursor"));
+            } catch (const std::exception&) {
+                return crow::response(400, "Invalid cursor parameter");
+            }
+        }
+        
+        // Ranked mode is a single page of the best posts, so it takes no cursor
+        bool ranked = req.url_params.get("mode") && std::string(req.url_params.get("mode")) == "ranked";
+        
+        std::cout << "=== TIMELINE REQUEST FOR USER: " << username << " ===" << std::endl;
+        
+        TimelinePrecomputer::InteractiveScope interactive;
+        TimelinePrecomputer& precomputer = TimelinePrecomputer::instance();
+        TimelineResponseCache& cache = TimelineResponseCache::instance();
+        // Taken before the page is read, so polling /since from here can only repeat events
+        uint64_t feedCursor = TimelineChangeFeed::instance().head();
+        
+        std::shared_ptr<const TimelineResponseCache::Response> cached;
+        std::string uncachedBody;  // The body, when cached->body doesn't hold it
+        if (ranked) {
+            // Scores move with every like, so ranked pages aren't cached; the ETag still spares
+            // an unchanged body
+            std::vector<int64_t> postIds;
+            uncachedBody = timelineBody(DynamicTimelineService(db).generateRankedTimeline(username), postIds);
+            cached = uncachedResponse(uncachedBody, 0);
+            FeedLog::instance().recordShown(username, postIds);
         } else {
-            auto body = crow::json::load(req.body);
-            if (body && body["username"].t() == crow::json::type::String) {
-                username = body["username"].s();
+            cached = cache.find(username, cursor, precomputer.version(username));
+        }
+        if (!cached) {
+            // Opened before any post is read, so a like landing mid-build keeps the page uncached
+            TimelineResponseCache::BuildScope build;
+            uint64_t version = 0;
+            std::vector<Post> posts;
+            if (cursor == 0) {
+                posts = precomputer.firstPage(db, username, &version);
+            } else {
+                // Posts only get newer ids, so an older page changes only when the friends do
+                version = precomputer.version(username);
+                posts = DynamicTimelineService(db).generateDynamicTimeline(username, 50, nullptr, cursor);
+            }
+            
+            std::vector<int64_t> postIds;
+            std::string body = timelineBody(posts, postIds);
+            // A cache hit repeats a page this user was already served, so only builds are recorded
+            FeedLog::instance().recordShown(username, postIds);
+            if (version != 0) {
+                cached = cache.store(build, username, cursor, version, std::move(body), postIds);
             } else {
-                return crow::response(400, "Missing username parameter");
+                // Raced an invalidation: answer with what we built but don't keep it
+                cached = uncachedResponse(body, postIds.empty() ? 0 : postIds.back());
+                uncachedBody = std::move(body);
             }
         }
         
-        std::cout << "=== TIMELINE REQUEST FOR USER: " << username << " ===" << std::endl;
+        crow::response response;
+        response.set_header("ETag", cached->etag);
+        response.set_header("X-Feed-Cursor", std::to_string(feedCursor));
+        if (cached->nextCursor != 0) {
+            response.set_header("X-Next-Cursor", std::to_string(cached->nextCursor));
+        }
+        if (req.get_header_value("If-None-Match").find(cached->etag) != std::string::npos) {
+            response.code = 304;
+            return response;
+        }
+        response.code = 200;
+        // Crow owns its body string, so a cached page is copied in once; nothing is re-serialized
+        response.body = cached->body.empty() ? std::move(uncachedBody) : cached->body;
+        return response;
+    }
+    
+    crow::response handle_get_timeline_unread(sqlite3* db, const crow::request& req) {
+        std::string username;
+        if (!requestUsername(req, username)) {
+            return crow::response(400, "Missing username parameter");
+        }
+        int unread = FeedLog::instance().unreadCount(db, username);
+        json res = {{"unread", unread}, {"more", unread >= FeedLog::kMaxUnread}};
+        return crow::response(200, res.dump());
+    }
+    
+    crow::response handle_get_timeline_since(sqlite3* db, const crow::request& req) {
+        std::string username;
+        if (!requestUsername(req, username)) {
+            return crow::response(400, "Missing username parameter");
+        }
+        if (!req.url_params.get("cursor")) {
+            return crow::response(400, "Missing cursor parameter");
+        }
+        uint64_t cursor;
+        try {
+            cursor = std::stoull(req.url_params.get("cursor"));
+        } catch (const std::exception&) {
+            return crow::response(400, "Invalid cursor parameter");
+        }
         
-        DynamicTimelineService dynamicService(db);
-        auto posts = dynamicService.generateDynamicTimeline(username, 50);
+        TimelineChangeFeed& feed = TimelineChangeFeed::instance();
+        json res = {{"cursor", cursor}, {"posts", json::array()}, {"updated", json::array()}, {"deleted", json::array()}};
+        if (cursor == feed.head()) {
+            return crow::response(200, res.dump());
+        }
         
-        json res = json::array();
-        for (const auto& post : posts) {
-            res.push_back({
-                {"id", post.getId()},
-                {"user_name", post.getUserName()},
-                {"content", post.getContent()},
-                {"image_url", post.getImageUrl()},
-                {"timestamp", post.getTimestamp()},
-                {"like_count", post.getLikeCount()},
-                {"comment_count", post.getCommentCount()}
-            });
+        std::vector<std::string> authors = getFriendNames(db, username);
+        authors.push_back(username);
+        std::vector<TimelineChangeFeed::Event> events;
+        uint64_t head;
+        if (!feed.since(cursor, authors, events, head)) {
+            json reset = {{"reset", true}, {"cursor", head}};
+            return crow::response(410, reset.dump());
+        }
+        res["cursor"] = head;
+        if (events.empty()) {
+            return crow::response(200, res.dump());
         }
+        std::unordered_set<std::string> authorSet(authors.begin(), authors.end());
         
-        std::cout << "Returning " << posts.size() << " posts in timeline" << std::endl;
+        // Newest first, each post once; a post created in this window is sent whole, so
+        // later changes to it don't need reporting separately
+        std::vector<int64_t> created;
+        std::vector<int64_t> changed;
+        std::unordered_set<int64_t> seen;
+        for (auto it = events.rbegin(); it != events.rend(); ++it) {
+            if (it->created) {
+                seen.insert(it->postId);
+                created.push_back(it->postId);
+            }
+        }
+        std::sort(created.begin(), created.end(), std::greater<int64_t>());
+        for (auto it = events.rbegin(); it != events.rend(); ++it) {
+            if (!it->created && seen.insert(it->postId).second) {
+                changed.push_back(it->postId);
+            }
+        }
+        
+        std::vector<int64_t> ids = created;
+        ids.insert(ids.end(), changed.begin(), changed.end());
+        auto posts = PostStore::instance().multiGet(db, ids);
+        
+        for (size_t i = 0; i < ids.size(); i++) {
+            const auto& post = posts[i];
+            if (!post) {
+                if (i >= created.size()) {
+                    res["deleted"].push_back(ids[i]);  // Clients ignore ids they don't hold
+                }
+                continue;
+            }
+            if (authorSet.count(std::string(post->getUserName())) == 0) {
+                continue;  // A change the feed couldn't attribute, to someone else's post
+            }
+            if (i < created.size()) {
+                res["posts"].push_back(postJson(*post));
+            } else {
+                res["updated"].push_back({
+                    {"id", post->getId()},
+                    {"like_count", post->getLikeCount()},
+                    {"comment_count", post->getCommentCount()}
+                });
+            }
+        }
         return crow::response(200, res.dump());
     }
 }
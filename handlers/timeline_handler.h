@@ -4,4 +4,9 @@
 
 namespace timeline_handler {
     crow::response handle_get_timeline(sqlite3* db, const crow::request& req);
+    // {"unread": N, "more": bool}: friends' posts newer than the newest one the user has been
+    // shown, counted up to FeedLog::kMaxUnread ("more" when the cap was hit)
+    crow::response handle_get_timeline_unread(sqlite3* db, const crow::request& req);
+    // Posts and counter changes since the client's feed cursor (X-Feed-Cursor on the timeline)
+    crow::response handle_get_timeline_since(sqlite3* db, const crow::request& req);
 }
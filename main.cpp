@@ -7,16 +7,34 @@
 #include <fstream>
 #include <sqlite3.h>
 #include <sstream>
+#include <sys/resource.h>
 #include <unordered_map>
 #include "handlers/comment_handler.h"
 #include "handlers/friend_handler.h"
 #include "handlers/like_handler.h"
 #include "handlers/search_handler.h"
+#include "services/affinity_store.h"
+#include "services/dynamic_timeline_service.h"
+#include "services/feed_log.h"
+#include "services/friend_graph.h"
+#include "services/post_store.h"
+#include "services/suggestion_store.h"
+#include "services/timeline_precomputer.h"
+#include "services/timeline_push_hub.h"
+#include "services/timeline_response_cache.h"
+#include "database/db_utils.h"
+#include "utils/string_intern.h"
 
 // Use the session management from login_handler
 using ::active_sessions;         // stores the session id->username
 using ::get_session_from_cookie; // extracts session ID from HTTP cookies
 
+// True if the request carries the cookie of a signed-in user
+bool has_session(const crow::request &req) {
+  std::string session_id = get_session_from_cookie(req);
+  return !session_id.empty() && active_sessions.find(session_id) != active_sessions.end();
+}
+
 crow::response serve_file(const std::string &path,
                           const std::string &content_type) {
   // Get the executable's directory and go up to project root
@@ -77,6 +95,23 @@ int main() {
     return 1;
   }
   initialize_schema(db);
+  if (!migrateTimestampsToEpochMillis(db)) {
+    std::cerr << "Timestamp migration incomplete; it will resume on next start" << std::endl;
+  }
+  seedIdGenerators(db);
+  FriendGraph::instance().load(db);
+  TimelinePrecomputer::instance().start(db);
+  TimelinePushHub::instance().start(db);
+  AffinityStore::instance().start(db);
+  FeedLog::instance().start(db);
+  SuggestionStore::instance().start(db);
+
+  // Every push connection holds a socket open, so allow as many as the hard limit does
+  rlimit files;
+  if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+    files.rlim_cur = files.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &files);
+  }
   crow::SimpleApp app;
 
   CROW_ROUTE(app, "/")
@@ -159,6 +194,71 @@ int main() {
         return timeline_handler::handle_get_timeline(db, modified_req);
       });
 
+  CROW_ROUTE(app, "/api/timeline/since")
+      .methods("GET"_method)([db](const crow::request &req) {
+        std::string session_id = get_session_from_cookie(req);
+        if (active_sessions.find(session_id) == active_sessions.end()) {
+          return crow::response(401, "Unauthorized");
+        }
+        crow::request modified_req = req;
+        modified_req.body = "{\"username\":\"" + active_sessions[session_id] + "\"}";
+        return timeline_handler::handle_get_timeline_since(db, modified_req);
+      });
+
+  CROW_ROUTE(app, "/api/timeline/unread")
+      .methods("GET"_method)([db](const crow::request &req) {
+        std::string session_id = get_session_from_cookie(req);
+        if (active_sessions.find(session_id) == active_sessions.end()) {
+          return crow::response(401, "Unauthorized");
+        }
+        crow::request modified_req = req;
+        modified_req.body = "{\"username\":\"" + active_sessions[session_id] + "\"}";
+        return timeline_handler::handle_get_timeline_unread(db, modified_req);
+      });
+
+  // Push channel: new posts by friends arrive as they're created, and the client can send
+  // {"type":"watch","post_ids":[...]} to get live counts for the posts on screen. The
+  // session is checked during the handshake; the connection's userdata carries it until close.
+  struct PushSession {
+    std::string username;
+    uint64_t subscription = 0;
+  };
+  CROW_WEBSOCKET_ROUTE(app, "/ws/timeline")
+      .onaccept([](const crow::request &req, void **userdata) {
+        std::string session_id = get_session_from_cookie(req);
+        auto session = active_sessions.find(session_id);
+        if (session == active_sessions.end()) {
+          return false;
+        }
+        *userdata = new PushSession{session->second};
+        return true;
+      })
+      .onopen([db](crow::websocket::connection &conn) {
+        auto *session = static_cast<PushSession *>(conn.userdata());
+        session->subscription = TimelinePushHub::instance().subscribe(
+            db, session->username, [&conn](const std::string &message) { conn.send_text(message); });
+      })
+      .onmessage([](crow::websocket::connection &conn, const std::string &data, bool is_binary) {
+        auto *session = static_cast<PushSession *>(conn.userdata());
+        auto message = crow::json::load(data);
+        if (is_binary || !message || !message.has("type") || message["type"].s() != "watch" ||
+            !message.has("post_ids") || message["post_ids"].t() != crow::json::type::List) {
+          return;
+        }
+        std::vector<int64_t> post_ids;
+        for (const auto &id : message["post_ids"]) {
+          if (id.t() == crow::json::type::Number) {
+            post_ids.push_back(id.i());
+          }
+        }
+        TimelinePushHub::instance().watchPosts(session->subscription, std::move(post_ids));
+      })
+      .onclose([](crow::websocket::connection &conn, const std::string &, uint16_t) {
+        auto *session = static_cast<PushSession *>(conn.userdata());
+        TimelinePushHub::instance().unsubscribe(session->subscription);
+        delete session;
+      });
+
   CROW_ROUTE(app, "/api/posts").methods("GET"_method)([](const crow::request &req) {
     // Session validation for getting posts
     std::string session_id = get_session_from_cookie(req);
@@ -253,6 +353,158 @@ int main() {
     return handleGetLikeStatus(db, req, username);
   });
 
+  // Shared post store counters, for watching cache size and hit rate
+  CROW_ROUTE(app, "/api/stats/post-store").methods("GET"_method)([](const crow::request& req) {
+    if (!has_session(req)) {
+      return crow::response(401, "Unauthorized");
+    }
+    PostStore::Stats stats = PostStore::instance().stats();
+    crow::json::wvalue res;
+    res["hits"] = stats.hits;
+    res["misses"] = stats.misses;
+    res["evictions"] = stats.evictions;
+    res["entries"] = stats.entries;
+    res["bytes"] = stats.bytes;
+    res["hit_rate"] = stats.hitRate();
+    return crow::response(200, res);
+  });
+
+  // Rows the timeline engine reads per post it returns
+  CROW_ROUTE(app, "/api/stats/timeline-fetch").methods("GET"_method)([](const crow::request& req) {
+    if (!has_session(req)) {
+      return crow::response(401, "Unauthorized");
+    }
+    DynamicTimelineService::FetchStats stats = DynamicTimelineService::fetchStats();
+    crow::json::wvalue res;
+    res["timelines"] = stats.timelines;
+    res["rows_fetched"] = stats.rowsFetched;
+    res["rows_returned"] = stats.rowsReturned;
+    res["refills"] = stats.refills;
+    res["rows_per_returned"] = stats.rowsPerReturned();
+    return crow::response(200, res);
+  });
+
+  // Background timeline precomputation counters
+  CROW_ROUTE(app, "/api/stats/timeline-precompute").methods("GET"_method)([](const crow::request& req) {
+    if (!has_session(req)) {
+      return crow::response(401, "Unauthorized");
+    }
+    TimelinePrecomputer::Stats stats = TimelinePrecomputer::instance().stats();
+    crow::json::wvalue res;
+    res["hits"] = stats.hits;
+    res["misses"] = stats.misses;
+    res["precomputed"] = stats.precomputed;
+    res["invalidations"] = stats.invalidations;
+    res["entries"] = stats.entries;
+    return crow::response(200, res);
+  });
+
+  // Push channel counters
+  CROW_ROUTE(app, "/api/stats/timeline-push").methods("GET"_method)([](const crow::request& req) {
+    if (!has_session(req)) {
+      return crow::response(401, "Unauthorized");
+    }
+    TimelinePushHub::Stats stats = TimelinePushHub::instance().stats();
+    crow::json::wvalue res;
+    res["connections"] = stats.connections;
+    res["users"] = stats.users;
+    res["notified"] = stats.notified;
+    res["messages"] = stats.messages;
+    res["overflows"] = stats.overflows;
+    res["counter_messages"] = stats.counterMessages;
+    res["watched_posts"] = stats.watchedPosts;
+    return crow::response(200, res);
+  });
+
+  // Serialized timeline response cache counters
+  CROW_ROUTE(app, "/api/stats/timeline-responses").methods("GET"_method)([](const crow::request& req) {
+    if (!has_session(req)) {
+      return crow::response(401, "Unauthorized");
+    }
+    TimelineResponseCache::Stats stats = TimelineResponseCache::instance().stats();
+    crow::json::wvalue res;
+    res["hits"] = stats.hits;
+    res["misses"] = stats.misses;
+    res["invalidations"] = stats.invalidations;
+    res["raced"] = stats.raced;
+    res["entries"] = stats.entries;
+    res["bytes"] = stats.bytes;
+    return crow::response(200, res);
+  });
+
+  // Viewer-to-author affinity counters
+  CROW_ROUTE(app, "/api/stats/affinity").methods("GET"_method)([](const crow::request& req) {
+    if (!has_session(req)) {
+      return crow::response(401, "Unauthorized");
+    }
+    AffinityStore::Stats stats = AffinityStore::instance().stats();
+    crow::json::wvalue res;
+    res["viewers"] = stats.viewers;
+    res["pairs"] = stats.pairs;
+    res["interactions"] = stats.interactions;
+    res["evictions"] = stats.evictions;
+    res["rows_written"] = stats.rowsWritten;
+    res["pending"] = stats.pending;
+    return crow::response(200, res);
+  });
+
+  // Shown-post log counters
+  CROW_ROUTE(app, "/api/stats/feed-log").methods("GET"_method)([](const crow::request& req) {
+    if (!has_session(req)) {
+      return crow::response(401, "Unauthorized");
+    }
+    FeedLog::Stats stats = FeedLog::instance().stats();
+    crow::json::wvalue res;
+    res["recorded"] = stats.recorded;
+    res["rows_written"] = stats.rowsWritten;
+    res["flushes"] = stats.flushes;
+    res["pending"] = stats.pending;
+    return crow::response(200, res);
+  });
+
+  // In-memory friendship graph size and compactions
+  CROW_ROUTE(app, "/api/stats/friend-graph").methods("GET"_method)([](const crow::request& req) {
+    if (!has_session(req)) {
+      return crow::response(401, "Unauthorized");
+    }
+    FriendGraph::Stats stats = FriendGraph::instance().stats();
+    crow::json::wvalue res;
+    res["users"] = stats.users;
+    res["friendships"] = stats.friendships;
+    res["delta"] = stats.delta;
+    res["compactions"] = stats.compactions;
+    return crow::response(200, res);
+  });
+
+  // Interned username table, which only grows
+  CROW_ROUTE(app, "/api/stats/atoms").methods("GET"_method)([](const crow::request& req) {
+    if (!has_session(req)) {
+      return crow::response(401, "Unauthorized");
+    }
+    Atom::TableStats stats = Atom::tableStats();
+    crow::json::wvalue res;
+    res["atoms"] = stats.atoms;
+    res["bytes"] = stats.bytes;
+    return crow::response(200, res);
+  });
+
+  // Stored friend suggestion lists and their background rebuilds
+  CROW_ROUTE(app, "/api/stats/suggestions").methods("GET"_method)([](const crow::request& req) {
+    if (!has_session(req)) {
+      return crow::response(401, "Unauthorized");
+    }
+    SuggestionStore::Stats stats = SuggestionStore::instance().stats();
+    crow::json::wvalue res;
+    res["lists"] = stats.lists;
+    res["hits"] = stats.hits;
+    res["misses"] = stats.misses;
+    res["refreshes"] = stats.refreshes;
+    res["coalesced"] = stats.coalesced;
+    res["rows_written"] = stats.rowsWritten;
+    res["queued"] = stats.queued;
+    return crow::response(200, res);
+  });
+
   // Get current user endpoint
   CROW_ROUTE(app, "/api/user/current")
       .methods("GET"_method)([](const crow::request &req) {
@@ -292,6 +544,11 @@ int main() {
   */
 
   app.port(18080).multithreaded().run();
+  SuggestionStore::instance().stop();
+  FeedLog::instance().stop();
+  AffinityStore::instance().stop();
+  TimelinePushHub::instance().stop();
+  TimelinePrecomputer::instance().stop();
   sqlite3_close(db);
 
     
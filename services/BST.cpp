@@ -1,64 +1,31 @@
 #include "BST.h"
 
-BST::BST() : root(nullptr) {}
-BST::~BST() { destroy(root); }
-
-void BST::destroy(BSTNode* node) {
-    if (!node) return;
-    destroy(node->left);
-    destroy(node->right);
-    delete node;
-}
-
-BSTNode* BST::insert(BSTNode* node, const std::string& key) {
-    if (!node) return new BSTNode(key);
-    if (key < node->key)
-        node->left = insert(node->left, key);
-    else if (key > node->key)
-        node->right = insert(node->right, key);
-    return node;
-}
+BST::BST() {}
 
 void BST::insert(const std::string& key) {
-    root = insert(root, key);
-}
-
-bool BST::search(BSTNode* node, const std::string& key) {
-    if (!node) return false;
-    if (key == node->key) return true;
-    if (key < node->key) return search(node->left, key);
-    else return search(node->right, key);
+    tree.insert(key);
 }
 
 bool BST::search(const std::string& key) {
-    return search(root, key);
-}
-
-void BST::inOrder(BSTNode* node, std::vector<std::string>& result) {
-    if (!node) return;
-    inOrder(node->left, result);
-    result.push_back(node->key);
-    inOrder(node->right, result);
+    return tree.contains(key);
 }
 
 std::vector<std::string> BST::inOrder() {
     std::vector<std::string> result;
-    inOrder(root, result);
+    result.reserve(tree.size());
+    for (auto it = tree.begin(); it != tree.end(); ++it) {
+        result.push_back(it->key);
+    }
     return result;
 }
 
-void BST::prefixSearch(BSTNode* node, const std::string& prefix, std::vector<std::string>& result) {
-    if (!node) return;
-    if (node->key.compare(0, prefix.size(), prefix) == 0)
-        result.push_back(node->key);
-    if (prefix <= node->key)
-        prefixSearch(node->left, prefix, result);
-    if (prefix >= node->key)
-        prefixSearch(node->right, prefix, result);
-}
-
+// Keys sharing a prefix are contiguous in sorted order: start at the first key >= prefix
+// and stop at the first one that no longer matches
 std::vector<std::string> BST::prefixSearch(const std::string& prefix) {
     std::vector<std::string> result;
-    prefixSearch(root, prefix, result);
+    for (auto it = tree.lowerBound(prefix); it != tree.end(); ++it) {
+        if (it->key.compare(0, prefix.size(), prefix) != 0) break;
+        result.push_back(it->key);
+    }
     return result;
 }
@@ -0,0 +1,425 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Header-only AVL tree shared by AVLTree, BST, PostAVLTree and UserSearchBST.
+//
+//   BalancedTree<Key, Value, Compare, Allocator, Duplicates, Augmentation>
+//
+// Value defaults to NoValue for set-like use. Behaviour that used to be hand-coded in
+// each tree is picked at compile time through the policy parameters below.
+
+struct NoValue {};
+
+// Duplicate handling policies: what insert() does when an equal key is already present
+struct RejectDuplicates {
+    static const bool allowEqual = false;
+    static const bool replaceValue = false;
+};
+struct ReplaceDuplicates {
+    static const bool allowEqual = false;
+    static const bool replaceValue = true;
+};
+struct AllowDuplicates {  // Equal keys are kept, later inserts sort after earlier ones
+    static const bool allowEqual = true;
+    static const bool replaceValue = false;
+};
+
+// Augmentation policies: extra per-node data recomputed bottom-up whenever a subtree changes
+struct NoAugmentation {
+    struct Data {};
+    template <class Node> static void update(Node*) {}
+};
+struct SubtreeSizeAugmentation {
+    struct Data { size_t count = 1; };
+    template <class Node> static void update(Node* node) {
+        node->augment.count = 1 + (node->left ? node->left->augment.count : 0)
+                                + (node->right ? node->right->augment.count : 0);
+    }
+};
+
+// Node allocator that carves nodes out of fixed-size chunks and recycles freed nodes
+// through a free list, so building a tree costs one heap allocation per ChunkNodes nodes.
+// Copies share the pool; rebinding to another type starts a fresh one. Not thread-safe,
+// like the trees that use it.
+template <class T, size_t ChunkNodes = 64>
+class NodePoolAllocator {
+public:
+    using value_type = T;
+    template <class U> struct rebind { using other = NodePoolAllocator<U, ChunkNodes>; };
+
+    NodePoolAllocator() : pool(std::make_shared<Pool>()) {}
+    template <class U>
+    NodePoolAllocator(const NodePoolAllocator<U, ChunkNodes>&) : pool(std::make_shared<Pool>()) {}
+
+    T* allocate(size_t n) {
+        if (n != 1) {
+            return std::allocator<T>().allocate(n);
+        }
+        return pool->take();
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (n != 1) {
+            std::allocator<T>().deallocate(p, n);
+            return;
+        }
+        pool->give(p);
+    }
+
+    bool operator==(const NodePoolAllocator& other) const { return pool == other.pool; }
+    bool operator!=(const NodePoolAllocator& other) const { return pool != other.pool; }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    struct Pool {
+        std::vector<std::unique_ptr<Slot[]>> chunks;
+        Slot* freeList = nullptr;
+
+        T* take() {
+            if (freeList == nullptr) {
+                chunks.emplace_back(new Slot[ChunkNodes]);
+                Slot* chunk = chunks.back().get();
+                for (size_t i = 0; i < ChunkNodes; i++) {
+                    chunk[i].next = freeList;
+                    freeList = &chunk[i];
+                }
+            }
+            Slot* slot = freeList;
+            freeList = slot->next;
+            return reinterpret_cast<T*>(slot->storage);
+        }
+
+        void give(T* p) {
+            Slot* slot = reinterpret_cast<Slot*>(p);
+            slot->next = freeList;
+            freeList = slot;
+        }
+    };
+
+    std::shared_ptr<Pool> pool;
+};
+
+template <class Key,
+          class Value = NoValue,
+          class Compare = std::less<Key>,
+          class Allocator = std::allocator<Key>,
+          class Duplicates = RejectDuplicates,
+          class Augmentation = NoAugmentation>
+class BalancedTree {
+public:
+    struct Node {
+        Key key;
+        Value value;
+        Node* left;
+        Node* right;
+        int height;
+        typename Augmentation::Data augment;
+
+        Node(Key k, Value v)
+            : key(std::move(k)), value(std::move(v)), left(nullptr), right(nullptr), height(1) {}
+    };
+
+    // In-order iterator driven by an explicit stack of pending ancestors (no recursion).
+    // Reverse iterators visit keys from largest to smallest.
+    template <bool Reverse>
+    class Iterator {
+    public:
+        Iterator() = default;
+
+        const Node& operator*() const { return *stack.back(); }
+        const Node* operator->() const { return stack.back(); }
+
+        Iterator& operator++() {
+            const Node* node = stack.back();
+            stack.pop_back();
+            pushSpine(Reverse ? node->left : node->right);
+            return *this;
+        }
+
+        bool atEnd() const { return stack.empty(); }
+        void invalidate() { stack.clear(); }
+
+        bool operator==(const Iterator& other) const {
+            if (stack.empty() || other.stack.empty()) {
+                return stack.empty() && other.stack.empty();
+            }
+            return stack.back() == other.stack.back();
+        }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class BalancedTree;
+
+        std::vector<const Node*> stack;
+
+        void pushSpine(const Node* node) {
+            while (node != nullptr) {
+                stack.push_back(node);
+                node = Reverse ? node->right : node->left;
+            }
+        }
+    };
+
+    using iterator = Iterator<false>;
+    using reverse_iterator = Iterator<true>;
+
+    explicit BalancedTree(const Compare& compare = Compare(), const Allocator& allocator = Allocator())
+        : root(nullptr), count(0), less(compare), alloc(allocator) {}
+
+    BalancedTree(const BalancedTree&) = delete;
+    BalancedTree& operator=(const BalancedTree&) = delete;
+
+    // The allocator is copied rather than moved so the source stays usable (and empty)
+    BalancedTree(BalancedTree&& other) noexcept
+        : root(other.root), count(other.count), less(other.less), alloc(other.alloc) {
+        other.root = nullptr;
+        other.count = 0;
+    }
+
+    BalancedTree& operator=(BalancedTree&& other) noexcept {
+        if (this != &other) {
+            clear();
+            root = other.root;
+            count = other.count;
+            less = other.less;
+            alloc = other.alloc;
+            other.root = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+
+    ~BalancedTree() { clear(); }
+
+    // Returns the node holding key and whether a new node was created
+    std::pair<Node*, bool> insert(Key key, Value value = Value()) {
+        Node* found = nullptr;
+        if (!Duplicates::allowEqual && (found = findNode(key)) != nullptr) {
+            if (Duplicates::replaceValue) {
+                found->value = std::move(value);
+            }
+            return std::make_pair(found, false);
+        }
+        Node* node = createNode(std::move(key), std::move(value));
+        root = insert(root, node);
+        count++;
+        return std::make_pair(node, true);
+    }
+
+    // Removes one node with an equal key. Other nodes never move in memory.
+    bool erase(const Key& key) {
+        bool erased = false;
+        root = erase(root, key, erased);
+        if (erased) {
+            count--;
+        }
+        return erased;
+    }
+
+    // A const tree only hands out const nodes. Through the non-const overload the value may
+    // be changed in place, but not the key: it fixes the node's position.
+    Node* find(const Key& key) { return findNode(key); }
+    const Node* find(const Key& key) const { return findNode(key); }
+    bool contains(const Key& key) const { return findNode(key) != nullptr; }
+
+    iterator begin() const {
+        iterator it;
+        it.pushSpine(root);
+        return it;
+    }
+    iterator end() const { return iterator(); }
+    reverse_iterator rbegin() const {
+        reverse_iterator it;
+        it.pushSpine(root);
+        return it;
+    }
+    reverse_iterator rend() const { return reverse_iterator(); }
+
+    // First node with key >= key, walking forward
+    iterator lowerBound(const Key& key) const {
+        iterator it;
+        const Node* current = root;
+        while (current != nullptr) {
+            if (!less(current->key, key)) {
+                it.stack.push_back(current);
+                current = current->left;
+            } else {
+                current = current->right;
+            }
+        }
+        return it;
+    }
+
+    // Last node with key <= key, walking backward
+    reverse_iterator atOrBelow(const Key& key) const {
+        reverse_iterator it;
+        const Node* current = root;
+        while (current != nullptr) {
+            if (!less(key, current->key)) {
+                it.stack.push_back(current);
+                current = current->right;
+            } else {
+                current = current->left;
+            }
+        }
+        return it;
+    }
+
+    const Node* rootNode() const { return root; }
+    const Compare& comparator() const { return less; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    void clear() {
+        // Iterative post-order teardown so very deep trees can't overflow the stack
+        std::vector<Node*> pending;
+        if (root != nullptr) {
+            pending.push_back(root);
+        }
+        while (!pending.empty()) {
+            Node* node = pending.back();
+            pending.pop_back();
+            if (node->left) pending.push_back(node->left);
+            if (node->right) pending.push_back(node->right);
+            destroyNode(node);
+        }
+        root = nullptr;
+        count = 0;
+    }
+
+private:
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+    using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+    Node* root;
+    size_t count;
+    Compare less;
+    NodeAllocator alloc;
+
+    Node* createNode(Key key, Value value) {
+        Node* node = NodeTraits::allocate(alloc, 1);
+        NodeTraits::construct(alloc, node, std::move(key), std::move(value));
+        return node;
+    }
+
+    void destroyNode(Node* node) {
+        NodeTraits::destroy(alloc, node);
+        NodeTraits::deallocate(alloc, node, 1);
+    }
+
+    Node* findNode(const Key& key) const {
+        Node* current = root;
+        while (current != nullptr) {
+            if (less(key, current->key)) {
+                current = current->left;
+            } else if (less(current->key, key)) {
+                current = current->right;
+            } else {
+                return current;
+            }
+        }
+        return nullptr;
+    }
+
+    static int getHeight(Node* node) { return node ? node->height : 0; }
+    static int getBalance(Node* node) { return node ? getHeight(node->left) - getHeight(node->right) : 0; }
+
+    static void update(Node* node) {
+        node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+        Augmentation::update(node);
+    }
+
+    static Node* rotateRight(Node* y) {
+        Node* x = y->left;
+        y->left = x->right;
+        x->right = y;
+        update(y);
+        update(x);
+        return x;
+    }
+
+    static Node* rotateLeft(Node* x) {
+        Node* y = x->right;
+        x->right = y->left;
+        y->left = x;
+        update(x);
+        update(y);
+        return y;
+    }
+
+    static Node* rebalance(Node* node) {
+        update(node);
+        int balance = getBalance(node);
+        if (balance > 1) {
+            if (getBalance(node->left) < 0) {
+                node->left = rotateLeft(node->left);
+            }
+            return rotateRight(node);
+        }
+        if (balance < -1) {
+            if (getBalance(node->right) > 0) {
+                node->right = rotateRight(node->right);
+            }
+            return rotateLeft(node);
+        }
+        return node;
+    }
+
+    Node* insert(Node* node, Node* newNode) {
+        if (node == nullptr) {
+            return newNode;
+        }
+        if (less(newNode->key, node->key)) {
+            node->left = insert(node->left, newNode);
+        } else {
+            node->right = insert(node->right, newNode);
+        }
+        return rebalance(node);
+    }
+
+    Node* erase(Node* node, const Key& key, bool& erased) {
+        if (node == nullptr) {
+            return node;
+        }
+        if (less(key, node->key)) {
+            node->left = erase(node->left, key, erased);
+        } else if (less(node->key, key)) {
+            node->right = erase(node->right, key, erased);
+        } else {
+            Node* left = node->left;
+            Node* right = node->right;
+            destroyNode(node);
+            erased = true;
+
+            if (left == nullptr || right == nullptr) {
+                return left ? left : right;
+            }
+            // Splice the in-order successor into place instead of copying its contents,
+            // so callers holding node pointers stay valid
+            Node* successor = nullptr;
+            right = detachMin(right, successor);
+            successor->left = left;
+            successor->right = right;
+            node = successor;
+        }
+        return rebalance(node);
+    }
+
+    static Node* detachMin(Node* node, Node*& minNode) {
+        if (node->left == nullptr) {
+            minNode = node;
+            return node->right;
+        }
+        node->left = detachMin(node->left, minNode);
+        return rebalance(node);
+    }
+};
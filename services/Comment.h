@@ -1,33 +1,41 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <ctime>
+#include "../utils/string_intern.h"
 
 class Comment {
 
-    int id;
-    int post_id;
-    std::string user_name;
-    std::string content;
+    int64_t id;
+    int64_t post_id;
+    Atom user_name;      // Interned, shared with the user's posts and other comments
+    SharedText content;
     std::time_t created_at;
 
     public:
 
     Comment();
-    Comment(int id, int post_id, const std::string& user_name, const std::string& content, std::time_t created_at);
+    Comment(int64_t id, int64_t post_id, std::string_view user_name, std::string content, std::time_t created_at);
+
+    Comment(const Comment&) = default;
+    Comment(Comment&&) noexcept = default;
+    Comment& operator=(const Comment&) = default;
+    Comment& operator=(Comment&&) noexcept = default;
 
     // Getters
-    int getId() const;
-    int getPostId() const;
-    std::string getUserName() const;
-    std::string getContent() const;
+    int64_t getId() const;
+    int64_t getPostId() const;
+    std::string_view getUserName() const;
+    std::string_view getContent() const;
     std::time_t getCreatedAt() const;
     std::string getTimestamp() const;
 
     // Setters
-    void setContent(const std::string& new_content);
-    void setId(int new_id);
-    void setPostId(int new_post_id);
-    void setUserName(const std::string& new_user_name);
+    void setContent(std::string new_content);
+    void setId(int64_t new_id);
+    void setPostId(int64_t new_post_id);
+    void setUserName(std::string_view new_user_name);
     void setCreatedAt(std::time_t new_created_at);
 };
\ No newline at end of file
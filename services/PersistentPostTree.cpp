@@ -0,0 +1,349 @@
+#include "PersistentPostTree.h"
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+// ---- Snapshot ----
+
+PersistentPostTree::Snapshot::Snapshot(const PersistentPostTree* tree, int slot)
+    : tree(tree), slot(slot) {
+    // The slot is pinned before the root is read, so nothing reachable from it can be freed
+    const Version* version = tree->current.load();
+    root = version->root;
+    count = version->count;
+}
+
+PersistentPostTree::Snapshot::Snapshot(Snapshot&& other) noexcept
+    : tree(other.tree), slot(other.slot), root(other.root), count(other.count) {
+    other.slot = -1;
+}
+
+PersistentPostTree::Snapshot::~Snapshot() {
+    if (slot >= 0) {
+        tree->unpinReader(slot);
+    }
+}
+
+void PersistentPostTree::Snapshot::Iterator::pushSpine(const Node* node) {
+    while (node != nullptr) {
+        stack.push_back(node);
+        node = node->right;
+    }
+}
+
+PersistentPostTree::Snapshot::Iterator& PersistentPostTree::Snapshot::Iterator::operator++() {
+    const Node* node = stack.back();
+    stack.pop_back();
+    pushSpine(node->left);
+    return *this;
+}
+
+bool PersistentPostTree::Snapshot::Iterator::operator==(const Iterator& other) const {
+    if (stack.empty() || other.stack.empty()) {
+        return stack.empty() && other.stack.empty();
+    }
+    return stack.back() == other.stack.back();
+}
+
+PersistentPostTree::Snapshot::Iterator PersistentPostTree::Snapshot::rbegin() const {
+    Iterator it;
+    it.pushSpine(root);
+    return it;
+}
+
+PersistentPostTree::Snapshot::Iterator PersistentPostTree::Snapshot::rend() const {
+    return Iterator();
+}
+
+PersistentPostTree::Snapshot::Iterator PersistentPostTree::Snapshot::atOrBelow(const PostKey& key) const {
+    Iterator it;
+    const Node* node = root;
+    while (node != nullptr) {
+        if (!(key < node->key)) {
+            it.stack.push_back(node);
+            node = node->right;
+        } else {
+            node = node->left;
+        }
+    }
+    return it;
+}
+
+std::vector<Post> PersistentPostTree::Snapshot::getTimelineInOrder(int limit) const {
+    std::vector<Post> result;
+    result.reserve(std::min(count, limit > 0 ? limit : 0));
+    for (auto it = rbegin(); it != rend() && (int)result.size() < limit; ++it) {
+        result.push_back(*it);
+    }
+    return result;
+}
+
+std::vector<Post> PersistentPostTree::Snapshot::before(const PostKey& cursor, int n) const {
+    std::vector<Post> result;
+    if (n <= 0) {
+        return result;
+    }
+    if (cursor == std::numeric_limits<PostKey>::min()) {
+        return result;
+    }
+    for (auto it = atOrBelow(cursor - 1); it != rend() && (int)result.size() < n; ++it) {
+        result.push_back(*it);
+    }
+    return result;
+}
+
+int PersistentPostTree::Snapshot::size() const {
+    return count;
+}
+
+// ---- Tree ----
+
+PersistentPostTree::PersistentPostTree() : globalEpoch(1), writeId(0) {
+    for (auto& epoch : readerEpochs) {
+        epoch.store(0);
+    }
+    current.store(new Version{nullptr, 0});
+}
+
+PersistentPostTree::~PersistentPostTree() {
+    // No snapshot may outlive the tree, so everything can go
+    for (Retired& batch : retired) {
+        for (const Node* node : batch.nodes) {
+            delete node;
+        }
+        delete batch.version;
+    }
+    const Version* version = current.load();
+    destroy(version->root);
+    delete version;
+}
+
+PersistentPostTree::Snapshot PersistentPostTree::snapshot() const {
+    return Snapshot(this, pinReader());
+}
+
+int PersistentPostTree::pinReader() const {
+    // Start each thread at a different slot so readers rarely race for the same one
+    static std::atomic<unsigned> nextHint(0);
+    thread_local unsigned hint = nextHint.fetch_add(1);
+
+    while (true) {
+        uint64_t epoch = globalEpoch.load();
+        for (int i = 0; i < kReaderSlots; i++) {
+            int slot = (hint + i) % kReaderSlots;
+            uint64_t expected = 0;
+            if (readerEpochs[slot].compare_exchange_strong(expected, epoch)) {
+                hint = slot;
+                return slot;
+            }
+        }
+        // Every slot is held by a live snapshot; wait for one to be released
+        std::this_thread::yield();
+    }
+}
+
+void PersistentPostTree::unpinReader(int slot) const {
+    readerEpochs[slot].store(0);
+}
+
+void PersistentPostTree::insert(const Post& post) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    writeId++;
+
+    const Version* version = current.load();
+    const Node* root = version->root;
+    int count = version->count;
+
+    // Re-inserting an id replaces the old post
+    PostKey key = post.getId();
+    if (find(root, key) != nullptr) {
+        root = remove(root, key);
+        count--;
+    }
+
+    root = insert(root, key, std::make_shared<const Post>(post));
+    publish(root, count + 1);
+}
+
+void PersistentPostTree::remove(int64_t postId) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Version* version = current.load();
+    if (find(version->root, postId) == nullptr) {
+        return;
+    }
+    writeId++;
+
+    const Node* root = remove(version->root, postId);
+    publish(root, version->count - 1);
+}
+
+bool PersistentPostTree::search(int64_t postId) {
+    return find(snapshot().root, postId) != nullptr;
+}
+
+int PersistentPostTree::size() const {
+    return current.load()->count;
+}
+
+// Returns a node this write may modify: the node itself if this write created it,
+// otherwise a fresh copy (the original is retired once the write is published)
+PersistentPostTree::Node* PersistentPostTree::own(const Node* node) {
+    if (node->writeId == writeId) {
+        return const_cast<Node*>(node);
+    }
+    replaced.push_back(node);
+    Node* copy = new Node(*node);
+    copy->writeId = writeId;
+    return copy;
+}
+
+PersistentPostTree::Node* PersistentPostTree::makeNode(const PostKey& key, std::shared_ptr<const Post> post) {
+    return new Node{key, std::move(post), nullptr, nullptr, 1, writeId};
+}
+
+const PersistentPostTree::Node* PersistentPostTree::insert(const Node* node, const PostKey& key,
+                                                           const std::shared_ptr<const Post>& post) {
+    if (node == nullptr) {
+        return makeNode(key, post);
+    }
+    Node* copy = own(node);
+    if (key < copy->key) {
+        copy->left = insert(copy->left, key, post);
+    } else {
+        copy->right = insert(copy->right, key, post);
+    }
+    return rebalance(copy);
+}
+
+const PersistentPostTree::Node* PersistentPostTree::remove(const Node* node, const PostKey& key) {
+    if (node == nullptr) {
+        return node;
+    }
+    if (key < node->key) {
+        Node* copy = own(node);
+        copy->left = remove(copy->left, key);
+        return rebalance(copy);
+    }
+    if (node->key < key) {
+        Node* copy = own(node);
+        copy->right = remove(copy->right, key);
+        return rebalance(copy);
+    }
+
+    replaced.push_back(node);
+    if (node->left == nullptr || node->right == nullptr) {
+        return node->left ? node->left : node->right;
+    }
+    const Node* successor = nullptr;
+    const Node* right = detachMin(node->right, successor);
+    Node* copy = own(successor);
+    copy->left = node->left;
+    copy->right = right;
+    return rebalance(copy);
+}
+
+const PersistentPostTree::Node* PersistentPostTree::detachMin(const Node* node, const Node*& minNode) {
+    if (node->left == nullptr) {
+        minNode = node;
+        return node->right;
+    }
+    Node* copy = own(node);
+    copy->left = detachMin(copy->left, minNode);
+    return rebalance(copy);
+}
+
+const PersistentPostTree::Node* PersistentPostTree::find(const Node* node, const PostKey& key) {
+    while (node != nullptr && node->key != key) {
+        node = key < node->key ? node->left : node->right;
+    }
+    return node;
+}
+
+int PersistentPostTree::getHeight(const Node* node) {
+    return node ? node->height : 0;
+}
+
+void PersistentPostTree::updateHeight(Node* node) {
+    node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+}
+
+// Rotations only copy the child they lift; the subtrees they re-hang are shared as is
+PersistentPostTree::Node* PersistentPostTree::rotateRight(Node* y) {
+    Node* x = own(y->left);
+    y->left = x->right;
+    x->right = y;
+    updateHeight(y);
+    updateHeight(x);
+    return x;
+}
+
+PersistentPostTree::Node* PersistentPostTree::rotateLeft(Node* x) {
+    Node* y = own(x->right);
+    x->right = y->left;
+    y->left = x;
+    updateHeight(x);
+    updateHeight(y);
+    return y;
+}
+
+PersistentPostTree::Node* PersistentPostTree::rebalance(Node* node) {
+    updateHeight(node);
+    int balance = getHeight(node->left) - getHeight(node->right);
+    if (balance > 1) {
+        const Node* left = node->left;
+        if (getHeight(left->left) < getHeight(left->right)) {
+            node->left = rotateLeft(own(left));
+        }
+        return rotateRight(node);
+    }
+    if (balance < -1) {
+        const Node* right = node->right;
+        if (getHeight(right->right) < getHeight(right->left)) {
+            node->right = rotateRight(own(right));
+        }
+        return rotateLeft(node);
+    }
+    return node;
+}
+
+void PersistentPostTree::publish(const Node* root, int count) {
+    const Version* old = current.exchange(new Version{root, count});
+
+    // Readers pinned at or before this epoch may still see the old version
+    uint64_t epoch = globalEpoch.fetch_add(1);
+    retired.push_back(Retired{epoch, std::move(replaced), old});
+    replaced.clear();
+    reclaim();
+}
+
+void PersistentPostTree::reclaim() {
+    uint64_t oldestReader = std::numeric_limits<uint64_t>::max();
+    for (const auto& slot : readerEpochs) {
+        uint64_t epoch = slot.load();
+        if (epoch != 0) {
+            oldestReader = std::min(oldestReader, epoch);
+        }
+    }
+
+    while (!retired.empty() && retired.front().epoch < oldestReader) {
+        for (const Node* node : retired.front().nodes) {
+            delete node;
+        }
+        delete retired.front().version;
+        retired.pop_front();
+    }
+}
+
+void PersistentPostTree::destroy(const Node* node) {
+    std::vector<const Node*> pending;
+    if (node != nullptr) {
+        pending.push_back(node);
+    }
+    while (!pending.empty()) {
+        const Node* next = pending.back();
+        pending.pop_back();
+        if (next->left) pending.push_back(next->left);
+        if (next->right) pending.push_back(next->right);
+        delete next;
+    }
+}
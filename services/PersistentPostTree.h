@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Post.h"
+
+// Immutable, path-copying AVL tree of posts for timelines shared between requests.
+//
+// A write never modifies a node a reader can see: it copies the O(log n) nodes on the
+// path it touches and publishes the new root with one atomic store. Readers take a
+// Snapshot, which pins the current epoch in a reader slot and then reads the root; the
+// read path never takes a lock. Nodes replaced by a write are retired with the epoch
+// of that write and freed once every pinned reader is newer.
+//
+// Writers are serialized among themselves by a mutex.
+class PersistentPostTree {
+public:
+    using PostKey = int64_t;  // The post id, which is time-sortable (see IdGenerator)
+
+    struct Node {
+        PostKey key;
+        std::shared_ptr<const Post> post;  // Shared between versions, so path copies don't copy posts
+        const Node* left;
+        const Node* right;
+        int height;
+        uint64_t writeId;  // Write that created this node; only that write may still mutate it
+    };
+
+    // Consistent, read-only view of the tree. Holding one keeps its nodes alive.
+    class Snapshot {
+    public:
+        // Newest-first iterator over the snapshot, stack based
+        class Iterator {
+        public:
+            Iterator() = default;
+            const Post& operator*() const { return *stack.back()->post; }
+            const Post* operator->() const { return stack.back()->post.get(); }
+            Iterator& operator++();
+            bool operator==(const Iterator& other) const;
+            bool operator!=(const Iterator& other) const { return !(*this == other); }
+        private:
+            friend class Snapshot;
+            std::vector<const Node*> stack;
+            void pushSpine(const Node* node);
+        };
+
+        Snapshot(Snapshot&& other) noexcept;
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+        ~Snapshot();
+
+        Iterator rbegin() const;
+        Iterator rend() const;
+        Iterator atOrBelow(const PostKey& key) const;
+
+        std::vector<Post> getTimelineInOrder(int limit = 50) const;
+        std::vector<Post> before(const PostKey& cursor, int n) const;
+        int size() const;
+
+    private:
+        friend class PersistentPostTree;
+        Snapshot(const PersistentPostTree* tree, int slot);
+
+        const PersistentPostTree* tree;
+        int slot;
+        const Node* root;
+        int count;
+    };
+
+    PersistentPostTree();
+    ~PersistentPostTree();
+
+    PersistentPostTree(const PersistentPostTree&) = delete;
+    PersistentPostTree& operator=(const PersistentPostTree&) = delete;
+
+    Snapshot snapshot() const;
+
+    void insert(const Post& post);
+    void remove(int64_t postId);
+    bool search(int64_t postId);
+    int size() const;
+
+private:
+    static const int kReaderSlots = 128;
+
+    // Root and size published together, so a snapshot never sees one without the other
+    struct Version {
+        const Node* root;
+        int count;
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        std::vector<const Node*> nodes;
+        const Version* version;
+    };
+
+    std::atomic<const Version*> current;
+    mutable std::atomic<uint64_t> globalEpoch;
+    mutable std::atomic<uint64_t> readerEpochs[kReaderSlots];  // 0 = slot free
+
+    // Writer-only state, guarded by writeMutex
+    std::mutex writeMutex;
+    uint64_t writeId;
+    std::vector<const Node*> replaced;
+    std::deque<Retired> retired;
+
+    int pinReader() const;
+    void unpinReader(int slot) const;
+
+    Node* own(const Node* node);
+    Node* makeNode(const PostKey& key, std::shared_ptr<const Post> post);
+    const Node* insert(const Node* node, const PostKey& key, const std::shared_ptr<const Post>& post);
+    const Node* remove(const Node* node, const PostKey& key);
+    const Node* detachMin(const Node* node, const Node*& minNode);
+    Node* rebalance(Node* node);
+    Node* rotateRight(Node* y);
+    Node* rotateLeft(Node* x);
+    static const Node* find(const Node* node, const PostKey& key);
+    static int getHeight(const Node* node);
+    static void updateHeight(Node* node);
+
+    void publish(const Node* root, int count);
+    void reclaim();
+    static void destroy(const Node* node);
+};
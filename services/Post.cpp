@@ -1,34 +1,35 @@
 #include "Post.h"
 #include <ctime>
+#include "../utils/time_utils.h"
 
 // Default constructor
-Post::Post() : id(0), user_name(""), content(""), image_url(""), created_at(0) {}
+Post::Post() : id(0), created_at(0) {}
 
 // Parameterized constructor
-Post::Post(int id, const std::string& user_name, const std::string& content, const std::string& image_url, 
+Post::Post(int64_t id, std::string_view user_name, std::string content, std::string image_url, 
     std::time_t created_at, int like_count, int comment_count)
-    : id(id), user_name(user_name), content(content), image_url(image_url),
+    : id(id), user_name(user_name), content(std::move(content)), image_url(std::move(image_url)),
       created_at(created_at), like_count(like_count), comment_count(comment_count) {}
 
 // Minimal constructor for timeline fetch
-Post::Post(int id, const std::string& content, const std::string& user_name, std::time_t created_at)
-    : id(id), user_name(user_name), content(content), image_url(""), created_at(created_at), like_count(0), comment_count(0) {}
+Post::Post(int64_t id, std::string content, std::string_view user_name, std::time_t created_at)
+    : id(id), user_name(user_name), content(std::move(content)), created_at(created_at), like_count(0), comment_count(0) {}
 
 // Getters
-int Post::getId() const {
+int64_t Post::getId() const {
     return id;
 }
 
-std::string Post::getUserName() const {
-    return user_name;
+std::string_view Post::getUserName() const {
+    return user_name.view();
 }
 
-std::string Post::getContent() const {
-    return content;
+std::string_view Post::getContent() const {
+    return content.view();
 }
 
-std::string Post::getImageUrl() const {
-    return image_url;
+std::string_view Post::getImageUrl() const {
+    return image_url.view();
 }
 
 
@@ -45,27 +46,24 @@ int Post::getCommentCount() const {
 }
 
 std::string Post::getTimestamp() const {
-    char buf[32];
-    std::tm* tm_info = std::localtime(&created_at);
-    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", tm_info);
-    return std::string(buf);
+    return time_utils::toIso8601(created_at);
 }
 
 // Setters
 
-void Post::setId(int new_id) {
+void Post::setId(int64_t new_id) {
         id = new_id;
     }
 
-void Post::setUserName(const std::string& new_user_name) {
-    user_name = new_user_name;
+void Post::setUserName(std::string_view new_user_name) {
+    user_name = Atom(new_user_name);
     }
 
-void Post::setContent(const std::string& new_content) {
-        content = new_content;
+void Post::setContent(std::string new_content) {
+        content = SharedText(std::move(new_content));
     }
-void Post::setImageUrl(const std::string& new_image_url) {
-        image_url = new_image_url;
+void Post::setImageUrl(std::string new_image_url) {
+        image_url = SharedText(std::move(new_image_url));
     }
 
 void Post::setLikeCount(int count) {
@@ -81,10 +79,7 @@ void Post::setCreatedAt(std::time_t createdAt) {
 }
 
 void Post::setCreatedAt(const std::string& createdAt) {
-    struct tm tm;
-    if (strptime(createdAt.c_str(), "%Y-%m-%d %H:%M:%S", &tm)) {
-        this->created_at = mktime(&tm);
-    } else {
-        this->created_at = 0;
-    }
+    // SQLite DATETIME text is UTC
+    int64_t millis;
+    this->created_at = time_utils::parseDateTime(createdAt, millis) ? static_cast<std::time_t>(millis / 1000) : 0;
 }
\ No newline at end of file
@@ -1,17 +1,20 @@
 #ifndef POST_H
 #define POST_H
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <ctime>
 #include <iostream>
 #include <vector>
 #include "Comment.h"
+#include "../utils/string_intern.h"
 
 class Post {
 
-    int id;
-    std::string user_name;
-    std::string content;
-    std::string image_url;
+    int64_t id;            // Time-sortable, see IdGenerator
+    Atom user_name;        // Interned: every post by a user shares one copy of the name
+    SharedText content;    // Shared between copies of the post
+    SharedText image_url;  // Usually empty, which costs nothing
     std::time_t created_at;
 
 public:
@@ -23,16 +26,23 @@ public:
 
 
     Post();
-    Post(int id, const std::string& user_name, const std::string& content, const std::string& image_url, 
+    Post(int64_t id, std::string_view user_name, std::string content, std::string image_url, 
         std::time_t created_at, int like_count, int comment_count = 0);
     // Minimal constructor for timeline fetch
-    Post(int id, const std::string& content, const std::string& user_name, std::time_t created_at);
+    Post(int64_t id, std::string content, std::string_view user_name, std::time_t created_at);
+
+    // Copies share the name and text buffers, so copying a post never copies its content
+    Post(const Post&) = default;
+    Post(Post&&) noexcept = default;
+    Post& operator=(const Post&) = default;
+    Post& operator=(Post&&) noexcept = default;
 
     // Getters
-    int getId() const;
-    std::string getUserName() const;
-    std::string getContent() const;
-    std::string getImageUrl() const;
+    int64_t getId() const;
+    // Views stay valid for as long as the post, or any copy of it, is alive
+    std::string_view getUserName() const;
+    std::string_view getContent() const;
+    std::string_view getImageUrl() const;
     std::string getTimestamp() const;
     std::string getPrivacy() const;
     std::time_t getcreated_at() const;
@@ -40,10 +50,10 @@ public:
     int getCommentCount() const;
 
     // Setters
-    void setId(int new_id);
-    void setUserName(const std::string& new_user_name);
-    void setContent(const std::string& new_content);
-    void setImageUrl(const std::string& new_image_url);
+    void setId(int64_t new_id);
+    void setUserName(std::string_view new_user_name);
+    void setContent(std::string new_content);
+    void setImageUrl(std::string new_image_url);
     void setTimestamp(const std::string& new_timestamp);
     void setPrivacy(const std::string& new_privacy);
     void setLikeCount(int count);
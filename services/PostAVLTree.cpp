@@ -1,258 +1,105 @@
 #include "PostAVLTree.h"
 #include <algorithm>
+#include <limits>
+#include "../utils/id_generator.h"
 
-PostAVLTree::PostAVLTree() : root(nullptr), nodeCount(0) {}
-
-PostAVLTree::~PostAVLTree() {
-    destroy(root);
-}
+PostAVLTree::PostAVLTree() {}
 
 void PostAVLTree::insert(const Post& post) {
-    root = insert(root, post);
-    nodeCount++;
-}
-
-void PostAVLTree::remove(int postId) {
-    root = remove(root, postId);
-    nodeCount--;
+    // Re-inserting an id replaces the old post, even if its author changed
+    remove(post.getId());
+    const PostAVLNode* node = tree.insert(post.getId(), post).first;
+    authorIndex[post.getUserName()].emplace(post.getId(), node);
 }
 
-bool PostAVLTree::search(int postId) {
-    PostAVLNode* current = root;
-    while (current != nullptr) {
-        if (current->post.getId() == postId) {
-            return true;
-        } else if (postId < current->post.getId()) {
-            current = current->left;
-        } else {
-            current = current->right;
+void PostAVLTree::remove(int64_t postId) {
+    const PostAVLNode* node = tree.find(postId);
+    if (node == nullptr) {
+        return;
+    }
+    auto author = authorIndex.find(node->value.getUserName());
+    if (author != authorIndex.end()) {
+        author->second.erase(postId);
+        if (author->second.empty()) {
+            authorIndex.erase(author);
         }
     }
-    return false;
+    tree.erase(postId);
+}
+
+bool PostAVLTree::search(int64_t postId) {
+    return tree.contains(postId);
 }
 
 std::vector<Post> PostAVLTree::getTimelineInOrder(int limit) {
     std::vector<Post> result;
-    int count = 0;
-    reverseInOrder(root, result, count, limit);
+    result.reserve(std::min(size(), limit > 0 ? limit : 0));
+    for (auto it = rbegin(); it != rend() && (int)result.size() < limit; ++it) {
+        result.push_back(*it);
+    }
     return result;
 }
 
 std::vector<Post> PostAVLTree::getPostsByUser(const std::string& username, int limit) {
     std::vector<Post> result;
-    int count = 0;
-    collectPostsByUser(root, username, result, count, limit);
-    
-    std::sort(result.begin(), result.end(), [](const Post& a, const Post& b) {
-        return a.getcreated_at() > b.getcreated_at();
-    });
-    
-    return result;
-}
-
-void PostAVLTree::clear() {
-    destroy(root);
-    root = nullptr;
-    nodeCount = 0;
-}
-
-int PostAVLTree::size() const {
-    return nodeCount;
-}
-
-PostAVLNode* PostAVLTree::insert(PostAVLNode* node, const Post& post) {
-    if (node == nullptr) {
-        return new PostAVLNode(post);
-    }
-    
-    if (isPostGreater(post, node->post)) {
-        node->right = insert(node->right, post);
-    } else if (!isPostEqual(post, node->post)) {
-        node->left = insert(node->left, post);
-    } else {
-        node->post = post;
-        return node;
+    auto author = authorIndex.find(username);
+    if (author == authorIndex.end()) {
+        return result;
     }
-    
-    node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
-    
-    int balance = getBalance(node);
-    
-    if (balance > 1 && !isPostGreater(post, node->left->post)) {
-        return rotateRight(node);
-    }
-    
-    if (balance < -1 && isPostGreater(post, node->right->post)) {
-        return rotateLeft(node);
-    }
-    
-    if (balance > 1 && isPostGreater(post, node->left->post)) {
-        node->left = rotateLeft(node->left);
-        return rotateRight(node);
-    }
-    
-    if (balance < -1 && !isPostGreater(post, node->right->post)) {
-        node->right = rotateRight(node->right);
-        return rotateLeft(node);
-    }
-    
-    return node;
-}
 
-PostAVLNode* PostAVLTree::remove(PostAVLNode* node, int postId) {
-    if (node == nullptr) {
-        return node;
-    }
-    
-    if (postId < node->post.getId()) {
-        node->left = remove(node->left, postId);
-    } else if (postId > node->post.getId()) {
-        node->right = remove(node->right, postId);
-    } else {
-        if (node->left == nullptr || node->right == nullptr) {
-            PostAVLNode* temp = node->left ? node->left : node->right;
-            
-            if (temp == nullptr) {
-                temp = node;
-                node = nullptr;
-            } else {
-                *node = *temp;
-            }
-            delete temp;
-        } else {
-            PostAVLNode* temp = minValueNode(node->right);
-            node->post = temp->post;
-            node->right = remove(node->right, temp->post.getId());
+    result.reserve(std::min<size_t>(author->second.size(), limit > 0 ? limit : 0));
+    for (const auto& entry : author->second) {
+        if ((int)result.size() >= limit) {
+            break;
         }
+        result.push_back(entry.second->value);
     }
-    
-    if (node == nullptr) {
-        return node;
-    }
-    
-    node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
-    
-    int balance = getBalance(node);
-    
-    if (balance > 1 && getBalance(node->left) >= 0) {
-        return rotateRight(node);
-    }
-    
-    if (balance > 1 && getBalance(node->left) < 0) {
-        node->left = rotateLeft(node->left);
-        return rotateRight(node);
-    }
-    
-    if (balance < -1 && getBalance(node->right) <= 0) {
-        return rotateLeft(node);
-    }
-    
-    if (balance < -1 && getBalance(node->right) > 0) {
-        node->right = rotateRight(node->right);
-        return rotateLeft(node);
-    }
-    
-    return node;
+    return result;
 }
 
-PostAVLNode* PostAVLTree::minValueNode(PostAVLNode* node) {
-    PostAVLNode* current = node;
-    while (current->left != nullptr) {
-        current = current->left;
-    }
-    return current;
+PostAVLTree::iterator PostAVLTree::begin() const {
+    return iterator(tree.begin());
 }
 
-PostAVLNode* PostAVLTree::maxValueNode(PostAVLNode* node) {
-    PostAVLNode* current = node;
-    while (current->right != nullptr) {
-        current = current->right;
-    }
-    return current;
+PostAVLTree::iterator PostAVLTree::end() const {
+    return iterator();
 }
 
-int PostAVLTree::getHeight(PostAVLNode* node) {
-    if (node == nullptr) {
-        return 0;
-    }
-    return node->height;
+PostAVLTree::reverse_iterator PostAVLTree::rbegin() const {
+    return reverse_iterator(tree.rbegin());
 }
 
-int PostAVLTree::getBalance(PostAVLNode* node) {
-    if (node == nullptr) {
-        return 0;
-    }
-    return getHeight(node->left) - getHeight(node->right);
+PostAVLTree::reverse_iterator PostAVLTree::rend() const {
+    return reverse_iterator();
 }
 
-PostAVLNode* PostAVLTree::rotateRight(PostAVLNode* y) {
-    PostAVLNode* x = y->left;
-    PostAVLNode* T2 = x->right;
-    
-    x->right = y;
-    y->left = T2;
-    
-    y->height = std::max(getHeight(y->left), getHeight(y->right)) + 1;
-    x->height = std::max(getHeight(x->left), getHeight(x->right)) + 1;
-    
-    return x;
-}
-
-PostAVLNode* PostAVLTree::rotateLeft(PostAVLNode* x) {
-    PostAVLNode* y = x->right;
-    PostAVLNode* T2 = y->left;
-    
-    y->left = x;
-    x->right = T2;
-    
-    x->height = std::max(getHeight(x->left), getHeight(x->right)) + 1;
-    y->height = std::max(getHeight(y->left), getHeight(y->right)) + 1;
-    
-    return y;
-}
-
-void PostAVLTree::reverseInOrder(PostAVLNode* node, std::vector<Post>& result, int& count, int limit) {
-    if (node == nullptr || count >= limit) {
-        return;
-    }
-    
-    reverseInOrder(node->right, result, count, limit);
-    
-    if (count < limit) {
-        result.push_back(node->post);
-        count++;
+PostAVLTree::Range PostAVLTree::range(std::time_t t_from, std::time_t t_to) const {
+    reverse_iterator it(tree.atOrBelow(IdGenerator::firstIdAt(t_to + 1) - 1));
+    it.floor = IdGenerator::firstIdAt(t_from);
+    it.hasFloor = true;
+    if (!it.it.atEnd() && it.it->key < it.floor) {
+        it.it.invalidate();
     }
-    
-    reverseInOrder(node->left, result, count, limit);
+    return Range(it);
 }
 
-void PostAVLTree::collectPostsByUser(PostAVLNode* node, const std::string& username, std::vector<Post>& result, int& count, int limit) {
-    if (node == nullptr || count >= limit) {
-        return;
+PostAVLTree::Range PostAVLTree::before(const PostKey& cursor, int n) const {
+    if (n <= 0) {
+        return Range(reverse_iterator());
     }
-    collectPostsByUser(node->left, username, result, count, limit);
-    if (count < limit && node->post.getUserName() == username) {
-        result.push_back(node->post);
-        count++;
+    if (cursor == std::numeric_limits<PostKey>::min()) {
+        return Range(reverse_iterator());
     }
-    collectPostsByUser(node->right, username, result, count, limit);
+    reverse_iterator it(tree.atOrBelow(cursor - 1));  // Largest key strictly below the cursor
+    it.remaining = n;
+    return Range(it);
 }
 
-void PostAVLTree::destroy(PostAVLNode* node) {
-    if (node != nullptr) {
-        destroy(node->left);
-        destroy(node->right);
-        delete node;
-    }
-}
-
-bool PostAVLTree::isPostGreater(const Post& a, const Post& b) {
-    if (a.getcreated_at() != b.getcreated_at()) {
-        return a.getcreated_at() > b.getcreated_at();
-    }
-    return a.getId() > b.getId();
+void PostAVLTree::clear() {
+    tree.clear();
+    authorIndex.clear();
 }
 
-bool PostAVLTree::isPostEqual(const Post& a, const Post& b) {
-    return a.getId() == b.getId();
+int PostAVLTree::size() const {
+    return (int)tree.size();
 }
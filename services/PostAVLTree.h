@@ -1,49 +1,103 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <ctime>
+#include <map>
+#include <unordered_map>
+#include <functional>
 #include "Post.h"
-
-struct PostAVLNode {
-    Post post;
-    PostAVLNode* left;
-    PostAVLNode* right;
-    int height;
-    
-    PostAVLNode(const Post& p) : post(p), left(nullptr), right(nullptr), height(1) {}
-};
+#include "BalancedTree.h"
 
 class PostAVLTree {
 public:
+    // Ordering key of the tree: the post id, which is time-sortable (see IdGenerator).
+    // Also used as a keyset pagination cursor.
+    using PostKey = int64_t;
+
+private:
+    using Tree = BalancedTree<PostKey, Post, std::less<PostKey>, NodePoolAllocator<Post>>;
+    using PostAVLNode = Tree::Node;
+
+public:
+    // Walks the tree without recursion. Reverse iterators run newest first.
+    // An iterator may carry a lower bound and a budget; it turns into end() once the
+    // next post would fall below the bound or the budget is spent.
+    template <bool Reverse>
+    class Iterator {
+    public:
+        Iterator() = default;
+
+        const Post& operator*() const { return it->value; }
+        const Post* operator->() const { return &it->value; }
+
+        Iterator& operator++() {
+            ++it;
+            if (remaining > 0) {
+                remaining--;
+            }
+            if (remaining == 0 || (!it.atEnd() && hasFloor && it->key < floor)) {
+                it.invalidate();
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const { return it == other.it; }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class PostAVLTree;
+
+        Iterator(const Tree::Iterator<Reverse>& it) : it(it) {}
+
+        Tree::Iterator<Reverse> it;
+        PostKey floor{};
+        bool hasFloor = false;
+        int remaining = -1;  // -1 means unbounded
+    };
+
+    using iterator = Iterator<false>;
+    using reverse_iterator = Iterator<true>;
+
+    // A view over a slice of the tree. Iterating it streams posts in place; nothing is copied.
+    class Range {
+    public:
+        Range(reverse_iterator first) : first(first) {}
+        reverse_iterator begin() const { return first; }
+        reverse_iterator end() const { return reverse_iterator(); }
+    private:
+        reverse_iterator first;
+    };
+
     PostAVLTree();
-    ~PostAVLTree();
-    
+
     void insert(const Post& post);
-    void remove(int postId);
-    bool search(int postId);
+    void remove(int64_t postId);
+    bool search(int64_t postId);
     std::vector<Post> getTimelineInOrder(int limit = 50);  // Returns posts sorted by timestamp (newest first)
-    std::vector<Post> getPostsByUser(const std::string& username, int limit = 50);
+    std::vector<Post> getPostsByUser(const std::string& username, int limit = 50);  // Newest first, O(log n + limit)
+
+    iterator begin() const;              // Oldest first
+    iterator end() const;
+    reverse_iterator rbegin() const;     // Newest first
+    reverse_iterator rend() const;
+
+    // Posts whose ids were generated between t_from and t_to inclusive, newest first.
+    // Ids from before the generator sort below all of its ids, so they only show up
+    // in ranges reaching back to IdGenerator::kEpochMillis.
+    Range range(std::time_t t_from, std::time_t t_to) const;
+    // Up to n posts strictly older than cursor, newest first (keyset pagination)
+    Range before(const PostKey& cursor, int n) const;
+
     void clear();
     int size() const;
 
 private:
-    PostAVLNode* root;
-    int nodeCount;
-    
-    PostAVLNode* insert(PostAVLNode* node, const Post& post);
-    PostAVLNode* remove(PostAVLNode* node, int postId);
-    PostAVLNode* minValueNode(PostAVLNode* node);
-    PostAVLNode* maxValueNode(PostAVLNode* node);
-    
-    int getHeight(PostAVLNode* node);
-    int getBalance(PostAVLNode* node);
-    PostAVLNode* rotateRight(PostAVLNode* y);
-    PostAVLNode* rotateLeft(PostAVLNode* x);
-    
-    void reverseInOrder(PostAVLNode* node, std::vector<Post>& result, int& count, int limit);
-    void collectPostsByUser(PostAVLNode* node, const std::string& username, std::vector<Post>& result, int& count, int limit);
-    void destroy(PostAVLNode* node);
-    
-    bool isPostGreater(const Post& a, const Post& b);
-    bool isPostEqual(const Post& a, const Post& b);
+    // Secondary index: one ordered run per author, newest first, keyed like the main tree.
+    // Tree nodes never move once allocated, so the index can point straight at them.
+    using AuthorPosts = std::map<PostKey, const PostAVLNode*, std::greater<PostKey>>;
+
+    Tree tree;  // Keyed by id, so lookups by id need no separate index
+    std::unordered_map<std::string_view, AuthorPosts> authorIndex;  // Keys view the interned author names
+
 };
@@ -0,0 +1,238 @@
+#include "PostBlockIndex.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include "../utils/id_generator.h"
+
+PostBlockIndex::PostBlockIndex() : nodeCount(0) {}
+
+void PostBlockIndex::insert(const Post& post) {
+    remove(post.getId());
+
+    PostKey key = post.getId();
+    if (blocks.empty()) {
+        blocks.emplace_back();
+        blockMax.push_back(key);
+    }
+
+    size_t b = findBlock(key);
+    if (b == blocks.size()) {
+        b = blocks.size() - 1;  // Newer than everything (the usual case): append to the last block
+    }
+
+    Block& block = blocks[b];
+    size_t slot = std::lower_bound(block.keys.begin(), block.keys.end(), key) - block.keys.begin();
+    block.keys.insert(block.keys.begin() + slot, key);
+    block.posts.insert(block.posts.begin() + slot, post);
+    blockMax[b] = block.keys.back();
+
+    if (block.keys.size() > kBlockCapacity) {
+        splitBlock(b);
+    }
+
+    authorIndex[post.getUserName()].insert(key);
+    nodeCount++;
+}
+
+void PostBlockIndex::remove(int64_t postId) {
+    PostKey key = postId;
+    size_t b = findBlock(key);
+    if (b == blocks.size()) {
+        return;
+    }
+    Block& block = blocks[b];
+    size_t slot = std::lower_bound(block.keys.begin(), block.keys.end(), key) - block.keys.begin();
+    if (slot == block.keys.size() || block.keys[slot] != key) {
+        return;
+    }
+
+    auto author = authorIndex.find(block.posts[slot].getUserName());
+    if (author != authorIndex.end()) {
+        author->second.erase(key);
+        if (author->second.empty()) {
+            authorIndex.erase(author);
+        }
+    }
+
+    block.keys.erase(block.keys.begin() + slot);
+    block.posts.erase(block.posts.begin() + slot);
+    nodeCount--;
+
+    if (block.keys.empty()) {
+        blocks.erase(blocks.begin() + b);
+        blockMax.erase(blockMax.begin() + b);
+        return;
+    }
+    blockMax[b] = block.keys.back();
+
+    // Keep blocks at least a quarter full so scans stay dense
+    if (block.keys.size() < kBlockCapacity / 4) {
+        if (b + 1 < blocks.size() && block.keys.size() + blocks[b + 1].keys.size() <= kBlockCapacity) {
+            mergeWithNext(b);
+        } else if (b > 0 && block.keys.size() + blocks[b - 1].keys.size() <= kBlockCapacity) {
+            mergeWithNext(b - 1);
+        }
+    }
+}
+
+bool PostBlockIndex::search(int64_t postId) {
+    return find(postId) != nullptr;
+}
+
+std::vector<Post> PostBlockIndex::getTimelineInOrder(int limit) {
+    std::vector<Post> result;
+    result.reserve(std::min(nodeCount, limit > 0 ? limit : 0));
+    for (auto it = rbegin(); it != rend() && (int)result.size() < limit; ++it) {
+        result.push_back(*it);
+    }
+    return result;
+}
+
+std::vector<Post> PostBlockIndex::getPostsByUser(const std::string& username, int limit) {
+    std::vector<Post> result;
+    auto author = authorIndex.find(username);
+    if (author == authorIndex.end()) {
+        return result;
+    }
+
+    for (const PostKey& key : author->second) {
+        if ((int)result.size() >= limit) {
+            break;
+        }
+        if (const Post* post = find(key)) {
+            result.push_back(*post);
+        }
+    }
+    return result;
+}
+
+PostBlockIndex::iterator PostBlockIndex::begin() const {
+    iterator it;
+    it.index = this;
+    it.atEnd = blocks.empty();
+    return it;
+}
+
+PostBlockIndex::iterator PostBlockIndex::end() const {
+    return iterator();
+}
+
+PostBlockIndex::reverse_iterator PostBlockIndex::rbegin() const {
+    reverse_iterator it;
+    it.index = this;
+    it.atEnd = blocks.empty();
+    if (!it.atEnd) {
+        it.block = blocks.size() - 1;
+        it.slot = blocks.back().keys.size() - 1;
+    }
+    return it;
+}
+
+PostBlockIndex::reverse_iterator PostBlockIndex::rend() const {
+    return reverse_iterator();
+}
+
+PostBlockIndex::Range PostBlockIndex::range(std::time_t t_from, std::time_t t_to) const {
+    reverse_iterator it = seekAtOrBelow(IdGenerator::firstIdAt(t_to + 1) - 1);
+    it.floor = IdGenerator::firstIdAt(t_from);
+    it.hasFloor = true;
+    if (!it.atEnd && blocks[it.block].keys[it.slot] < it.floor) {
+        it.atEnd = true;
+    }
+    return Range(it);
+}
+
+PostBlockIndex::Range PostBlockIndex::before(const PostKey& cursor, int n) const {
+    if (n <= 0) {
+        return Range(reverse_iterator());
+    }
+    if (cursor == std::numeric_limits<PostKey>::min()) {
+        return Range(reverse_iterator());
+    }
+    reverse_iterator it = seekAtOrBelow(cursor - 1);
+    it.remaining = n;
+    return Range(it);
+}
+
+void PostBlockIndex::clear() {
+    blocks.clear();
+    blockMax.clear();
+    authorIndex.clear();
+    nodeCount = 0;
+}
+
+int PostBlockIndex::size() const {
+    return nodeCount;
+}
+
+// Index of the first block whose largest key is >= key, or blocks.size() if none
+size_t PostBlockIndex::findBlock(const PostKey& key) const {
+    return std::lower_bound(blockMax.begin(), blockMax.end(), key) - blockMax.begin();
+}
+
+const Post* PostBlockIndex::find(const PostKey& key) const {
+    size_t b = findBlock(key);
+    if (b == blocks.size()) {
+        return nullptr;
+    }
+    const Block& block = blocks[b];
+    auto it = std::lower_bound(block.keys.begin(), block.keys.end(), key);
+    if (it == block.keys.end() || *it != key) {
+        return nullptr;
+    }
+    return &block.posts[it - block.keys.begin()];
+}
+
+void PostBlockIndex::splitBlock(size_t b) {
+    Block upper;
+    size_t half = blocks[b].keys.size() / 2;
+    Block& lower = blocks[b];
+
+    upper.keys.assign(lower.keys.begin() + half, lower.keys.end());
+    upper.posts.assign(std::make_move_iterator(lower.posts.begin() + half),
+                       std::make_move_iterator(lower.posts.end()));
+    lower.keys.resize(half);
+    lower.posts.erase(lower.posts.begin() + half, lower.posts.end());
+
+    blockMax[b] = lower.keys.back();
+    PostKey upperMax = upper.keys.back();
+    blocks.insert(blocks.begin() + b + 1, std::move(upper));
+    blockMax.insert(blockMax.begin() + b + 1, upperMax);
+}
+
+void PostBlockIndex::mergeWithNext(size_t b) {
+    Block& lower = blocks[b];
+    Block& upper = blocks[b + 1];
+    lower.keys.insert(lower.keys.end(), upper.keys.begin(), upper.keys.end());
+    lower.posts.insert(lower.posts.end(), std::make_move_iterator(upper.posts.begin()),
+                       std::make_move_iterator(upper.posts.end()));
+    blockMax[b] = lower.keys.back();
+    blocks.erase(blocks.begin() + b + 1);
+    blockMax.erase(blockMax.begin() + b + 1);
+}
+
+PostBlockIndex::reverse_iterator PostBlockIndex::seekAtOrBelow(const PostKey& key) const {
+    reverse_iterator it;
+    it.index = this;
+
+    // First block whose max exceeds key holds the answer, or the block before it does
+    size_t b = std::upper_bound(blockMax.begin(), blockMax.end(), key) - blockMax.begin();
+    if (b == blocks.size()) {
+        if (blocks.empty()) {
+            return it;
+        }
+        b--;
+    }
+    const Block& block = blocks[b];
+    size_t slot = std::upper_bound(block.keys.begin(), block.keys.end(), key) - block.keys.begin();
+    if (slot > 0) {
+        it.block = b;
+        it.slot = slot - 1;
+        it.atEnd = false;
+    } else if (b > 0) {
+        it.block = b - 1;
+        it.slot = blocks[b - 1].keys.size() - 1;
+        it.atEnd = false;
+    }
+    return it;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ctime>
+#include <set>
+#include <unordered_map>
+#include <functional>
+#include "Post.h"
+
+// Timeline container with the same interface as PostAVLTree, laid out as a list of
+// sorted fixed-capacity blocks instead of one heap node per post. Posts of a block sit
+// next to each other, and the keys used for searching are kept in their own contiguous
+// arrays, so top-N scans and lookups touch a few cache lines instead of chasing pointers.
+class PostBlockIndex {
+public:
+    using PostKey = int64_t;  // The post id, which is time-sortable (see IdGenerator)
+
+    static const size_t kBlockCapacity = 64;
+
+    template <bool Reverse>
+    class Iterator {
+    public:
+        Iterator() = default;
+
+        const Post& operator*() const { return index->blocks[block].posts[slot]; }
+        const Post* operator->() const { return &index->blocks[block].posts[slot]; }
+
+        Iterator& operator++() {
+            if (Reverse) {
+                if (slot > 0) {
+                    slot--;
+                } else if (block > 0) {
+                    block--;
+                    slot = index->blocks[block].posts.size() - 1;
+                } else {
+                    atEnd = true;
+                }
+            } else {
+                slot++;
+                if (slot == index->blocks[block].posts.size()) {
+                    block++;
+                    slot = 0;
+                    atEnd = block == index->blocks.size();
+                }
+            }
+            if (remaining > 0) {
+                remaining--;
+            }
+            if (remaining == 0 || (!atEnd && hasFloor && index->blocks[block].keys[slot] < floor)) {
+                atEnd = true;
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            if (atEnd || other.atEnd) {
+                return atEnd && other.atEnd;
+            }
+            return block == other.block && slot == other.slot;
+        }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class PostBlockIndex;
+
+        const PostBlockIndex* index = nullptr;
+        size_t block = 0;
+        size_t slot = 0;
+        bool atEnd = true;
+        PostKey floor;
+        bool hasFloor = false;
+        int remaining = -1;  // -1 means unbounded
+    };
+
+    using iterator = Iterator<false>;
+    using reverse_iterator = Iterator<true>;
+
+    class Range {
+    public:
+        Range(reverse_iterator first) : first(first) {}
+        reverse_iterator begin() const { return first; }
+        reverse_iterator end() const { return reverse_iterator(); }
+    private:
+        reverse_iterator first;
+    };
+
+    PostBlockIndex();
+
+    void insert(const Post& post);
+    void remove(int64_t postId);
+    bool search(int64_t postId);
+    std::vector<Post> getTimelineInOrder(int limit = 50);  // Returns posts sorted by timestamp (newest first)
+    std::vector<Post> getPostsByUser(const std::string& username, int limit = 50);
+
+    iterator begin() const;
+    iterator end() const;
+    reverse_iterator rbegin() const;
+    reverse_iterator rend() const;
+
+    Range range(std::time_t t_from, std::time_t t_to) const;
+    Range before(const PostKey& cursor, int n) const;
+
+    void clear();
+    int size() const;
+
+private:
+    // keys[i] is the key of posts[i]; both stay sorted ascending
+    struct Block {
+        std::vector<PostKey> keys;
+        std::vector<Post> posts;
+    };
+
+    std::vector<Block> blocks;
+    std::vector<PostKey> blockMax;  // Largest key of each block, for the top-level search
+    int nodeCount;
+    std::unordered_map<std::string_view, std::set<PostKey, std::greater<PostKey>>> authorIndex;  // Keys view the interned author names
+
+    size_t findBlock(const PostKey& key) const;
+    const Post* find(const PostKey& key) const;
+    void splitBlock(size_t b);
+    void mergeWithNext(size_t b);
+    reverse_iterator seekAtOrBelow(const PostKey& key) const;
+};
@@ -0,0 +1,269 @@
+#include "affinity_store.h"
+#include "../utils/time_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+double AffinityStore::Score::at(int64_t nowMillis) const {
+    double ageDays = (nowMillis - updatedAt) / 86400000.0;
+    return ageDays <= 0 ? value : value * std::exp2(-ageDays / kHalfLifeDays);
+}
+
+AffinityStore& AffinityStore::instance() {
+    static AffinityStore store;
+    return store;
+}
+
+AffinityStore::AffinityStore()
+    : persistent(true), interactions(0), evictions(0), rowsWritten(0), writer(nullptr), running(false) {}
+
+void AffinityStore::start(sqlite3* db) {
+    std::lock_guard<std::mutex> lock(runMutex);
+    if (running) {
+        return;
+    }
+    load(db);
+    const char* path = sqlite3_db_filename(db, "main");
+    if (path == nullptr || *path == '\0') {
+        std::cerr << "Affinity persistence disabled: database has no file" << std::endl;
+        disablePersistence();
+        return;
+    }
+    if (sqlite3_open_v2(path, &writer, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        std::cerr << "Can't open " << path << " for affinity writes: " << sqlite3_errmsg(writer) << std::endl;
+        sqlite3_close(writer);
+        writer = nullptr;
+        disablePersistence();
+        return;
+    }
+    sqlite3_busy_timeout(writer, 5000);
+    running = true;
+    flusher = std::thread(&AffinityStore::flushLoop, this);
+}
+
+void AffinityStore::stop() {
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    wake.notify_all();
+    flusher.join();
+    flush();
+    std::lock_guard<std::mutex> lock(flushMutex);
+    sqlite3_close(writer);
+    writer = nullptr;
+}
+
+void AffinityStore::record(const std::string& viewer, const std::string& author, double weight) {
+    if (viewer == author || weight == 0) {
+        return;
+    }
+    int64_t now = time_utils::nowMillis();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    interactions++;
+    auto viewerScores = scores.find(viewer);
+    if (viewerScores == scores.end()) {
+        if (weight < 0) {
+            return;  // Nothing to take back: the like predates what we track
+        }
+        viewerScores = scores.emplace(viewer, std::unordered_map<std::string, Score>()).first;
+    }
+    auto& authors = viewerScores->second;
+    auto it = authors.find(author);
+    if (it == authors.end()) {
+        if (weight < 0) {
+            return;
+        }
+        if (authors.size() >= kMaxAuthorsPerViewer) {
+            auto weakest = std::min_element(authors.begin(), authors.end(), [now](const auto& a, const auto& b) {
+                return a.second.at(now) < b.second.at(now);
+            });
+            if (persistent) {
+                dirty.emplace(viewer, weakest->first);
+            }
+            authors.erase(weakest);
+            evictions++;
+        }
+        it = authors.emplace(author, Score{0, now}).first;
+    }
+    it->second.value = std::max(0.0, it->second.at(now) + weight);
+    it->second.updatedAt = now;
+    if (persistent) {
+        dirty.emplace(viewer, author);
+    }
+}
+
+double AffinityStore::affinity(const std::string& viewer, std::string_view author) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto authors = scores.find(viewer);
+    if (authors == scores.end()) {
+        return 0;
+    }
+    auto it = authors->second.find(std::string(author));
+    return it == authors->second.end() ? 0 : it->second.at(time_utils::nowMillis());
+}
+
+std::unordered_map<std::string, double> AffinityStore::scoresOf(const std::string& viewer) const {
+    std::unordered_map<std::string, double> result;
+    int64_t now = time_utils::nowMillis();
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto authors = scores.find(viewer);
+    if (authors != scores.end()) {
+        for (const auto& [author, score] : authors->second) {
+            result.emplace(author, score.at(now));
+        }
+    }
+    return result;
+}
+
+std::vector<std::pair<std::string, double>> AffinityStore::topAuthors(const std::string& viewer, size_t n) const {
+    std::unordered_map<std::string, double> all = scoresOf(viewer);
+    std::vector<std::pair<std::string, double>> top(all.begin(), all.end());
+    auto byScore = [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    };
+    if (top.size() > n) {
+        std::partial_sort(top.begin(), top.begin() + n, top.end(), byScore);
+        top.resize(n);
+    } else {
+        std::sort(top.begin(), top.end(), byScore);
+    }
+    return top;
+}
+
+AffinityStore::Stats AffinityStore::stats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    size_t pairs = 0;
+    for (const auto& viewer : scores) {
+        pairs += viewer.second.size();
+    }
+    return Stats{scores.size(), pairs, interactions, evictions, rowsWritten, dirty.size()};
+}
+
+void AffinityStore::disablePersistence() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    persistent = false;
+    dirty.clear();
+}
+
+void AffinityStore::load(sqlite3* db) {
+    std::string query =
+        "SELECT viewer.username, author.username, affinity.score, affinity.updated_at FROM affinity "
+        "JOIN users AS viewer ON viewer.id = affinity.viewer_id "
+        "JOIN users AS author ON author.id = affinity.author_id";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing affinity load: " << sqlite3_errmsg(db) << std::endl;
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto& authors = scores[reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))];
+        if (authors.size() < kMaxAuthorsPerViewer) {
+            authors[reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1))] =
+                Score{sqlite3_column_double(stmt, 2), sqlite3_column_int64(stmt, 3)};
+        }
+    }
+    sqlite3_finalize(stmt);
+}
+
+void AffinityStore::flushLoop() {
+    std::unique_lock<std::mutex> lock(runMutex);
+    while (running) {
+        wake.wait_for(lock, std::chrono::seconds(kFlushIntervalSeconds));
+        if (!running) {
+            break;
+        }
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+void AffinityStore::flush() {
+    std::lock_guard<std::mutex> flushLock(flushMutex);
+    if (writer == nullptr) {
+        return;
+    }
+
+    // Copy out what changed so writing doesn't hold up record() or lookups; a pair that is
+    // no longer in memory was evicted and is deleted
+    struct Row {
+        std::string viewer;
+        std::string author;
+        bool present;
+        Score score;
+    };
+    std::vector<Row> rows;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        rows.reserve(dirty.size());
+        for (const auto& [viewer, author] : dirty) {
+            Row row{viewer, author, false, Score{0, 0}};
+            auto authors = scores.find(viewer);
+            if (authors != scores.end()) {
+                auto it = authors->second.find(author);
+                if (it != authors->second.end()) {
+                    row.present = true;
+                    row.score = it->second;
+                }
+            }
+            rows.push_back(std::move(row));
+        }
+        dirty.clear();
+    }
+    if (rows.empty()) {
+        return;
+    }
+
+    const char* upsertSql =
+        "INSERT OR REPLACE INTO affinity (viewer_id, author_id, score, updated_at) "
+        "VALUES ((SELECT id FROM users WHERE username = ?), (SELECT id FROM users WHERE username = ?), ?, ?)";
+    const char* deleteSql =
+        "DELETE FROM affinity WHERE viewer_id = (SELECT id FROM users WHERE username = ?) "
+        "AND author_id = (SELECT id FROM users WHERE username = ?)";
+    sqlite3_stmt* upsert = nullptr;
+    sqlite3_stmt* remove = nullptr;
+    if (sqlite3_prepare_v2(writer, upsertSql, -1, &upsert, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(writer, deleteSql, -1, &remove, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing affinity flush: " << sqlite3_errmsg(writer) << std::endl;
+        sqlite3_finalize(upsert);
+        sqlite3_finalize(remove);
+        return;
+    }
+
+    sqlite3_exec(writer, "BEGIN", nullptr, nullptr, nullptr);
+    bool ok = true;
+    for (const Row& row : rows) {
+        sqlite3_stmt* stmt = row.present ? upsert : remove;
+        sqlite3_bind_text(stmt, 1, row.viewer.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, row.author.c_str(), -1, SQLITE_STATIC);
+        if (row.present) {
+            sqlite3_bind_double(stmt, 3, row.score.value);
+            sqlite3_bind_int64(stmt, 4, row.score.updatedAt);
+        }
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            ok = false;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(upsert);
+    sqlite3_finalize(remove);
+
+    if (ok && sqlite3_exec(writer, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        rowsWritten += rows.size();
+        return;
+    }
+    std::cerr << "Affinity flush failed: " << sqlite3_errmsg(writer) << std::endl;
+    sqlite3_exec(writer, "ROLLBACK", nullptr, nullptr, nullptr);
+    // Retry these pairs next time; whatever is in memory then is what gets written
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (const Row& row : rows) {
+        dirty.emplace(row.viewer, row.author);
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <sqlite3.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// How much each user interacts with each author, for ranking timelines and suggestions.
+//
+// Every like and comment adds to a per (viewer, author) score that halves every
+// kHalfLifeDays, so the score tracks recent interaction rather than all-time totals. A score
+// is kept as (value, time of last update) and decayed when read, so an interaction costs one
+// update and a lookup is two hash probes. Each viewer keeps at most kMaxAuthorsPerViewer
+// authors; a new author replaces the one with the lowest current score.
+//
+// Scores live in memory. Changed pairs are written to the affinity table in one transaction
+// every kFlushIntervalSeconds (and on stop), on a connection of the store's own, and are
+// read back by start(). If start() can't write to the database, nothing is tracked for it.
+class AffinityStore {
+public:
+    static constexpr double kLikeWeight = 1.0;
+    static constexpr double kCommentWeight = 2.0;
+
+    struct Stats {
+        size_t viewers;
+        size_t pairs;
+        uint64_t interactions;
+        uint64_t evictions;
+        uint64_t rowsWritten;
+        size_t pending;  // Pairs waiting for the next flush
+    };
+
+    static AffinityStore& instance();
+
+    // Loads the persisted scores and starts the flusher; writes go to db's file
+    void start(sqlite3* db);
+    // Stops the flusher after a final flush
+    void stop();
+
+    // viewer liked (weight > 0) or unliked (weight < 0) or commented on a post by author.
+    // Interactions with one's own posts are ignored.
+    void record(const std::string& viewer, const std::string& author, double weight);
+
+    // viewer's current score for author, >= 0 (0: no recent interaction)
+    double affinity(const std::string& viewer, std::string_view author) const;
+
+    // All of viewer's scores as of now; for scoring many candidates under one lock
+    std::unordered_map<std::string, double> scoresOf(const std::string& viewer) const;
+
+    // The n authors viewer interacts with most, highest first
+    std::vector<std::pair<std::string, double>> topAuthors(const std::string& viewer, size_t n) const;
+
+    Stats stats() const;
+
+private:
+    static constexpr double kHalfLifeDays = 30.0;
+    static constexpr size_t kMaxAuthorsPerViewer = 64;
+    static constexpr int kFlushIntervalSeconds = 60;
+
+    struct Score {
+        double value;
+        int64_t updatedAt;  // Epoch millis value was last set at
+
+        double at(int64_t nowMillis) const;
+    };
+
+    AffinityStore();
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, std::unordered_map<std::string, Score>> scores;  // Viewer -> author -> score
+    std::set<std::pair<std::string, std::string>> dirty;  // Pairs changed or evicted since the last flush
+    bool persistent;  // Until start() finds it can't write
+    uint64_t interactions;
+    uint64_t evictions;
+    uint64_t rowsWritten;
+
+    std::mutex flushMutex;  // Serializes flushes; guards writer
+    sqlite3* writer;
+
+    std::mutex runMutex;
+    std::condition_variable wake;
+    std::thread flusher;
+    bool running;
+
+    void load(sqlite3* db);
+    void disablePersistence();
+    void flushLoop();
+    void flush();
+};
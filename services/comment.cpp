@@ -1,29 +1,30 @@
 #include "Comment.h"
 #include <ctime>
+#include "../utils/time_utils.h"
 #include <string>
 #include <iostream>
 
 
-Comment::Comment() = default;
+Comment::Comment() : id(0), post_id(0), created_at(0) {}
 
-Comment::Comment(int id, int post_id, const std::string& user_name, const std::string& content, std::time_t created_at)
-    : id(id), post_id(post_id), user_name(user_name), content(content), created_at(created_at) {}
+Comment::Comment(int64_t id, int64_t post_id, std::string_view user_name, std::string content, std::time_t created_at)
+    : id(id), post_id(post_id), user_name(user_name), content(std::move(content)), created_at(created_at) {}
 
 // Getters
-int Comment::getId() const {
+int64_t Comment::getId() const {
     return id;
 }
 
-int Comment::getPostId() const {
+int64_t Comment::getPostId() const {
     return post_id;
 }
 
-std::string Comment::getUserName() const {
-    return user_name;
+std::string_view Comment::getUserName() const {
+    return user_name.view();
 }
 
-std::string Comment::getContent() const {
-    return content;
+std::string_view Comment::getContent() const {
+    return content.view();
 }
 
 std::time_t Comment::getCreatedAt() const {
@@ -31,26 +32,23 @@ std::time_t Comment::getCreatedAt() const {
 }
 
 std::string Comment::getTimestamp() const {
-    char buf[32];
-    std::tm* tm_info = std::localtime(&created_at);
-    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", tm_info);
-    return std::string(buf);
+    return time_utils::toIso8601(created_at);
 }
 
 // Setters
-void Comment::setContent(const std::string& new_content) {
-    content = new_content;
+void Comment::setContent(std::string new_content) {
+    content = SharedText(std::move(new_content));
 }
 void Comment::setCreatedAt(std::time_t new_created_at) {
     created_at = new_created_at;
 }
-void Comment::setId(int new_id) {
+void Comment::setId(int64_t new_id) {
     id = new_id;
 }
-void Comment::setPostId(int new_post_id) {
+void Comment::setPostId(int64_t new_post_id) {
     post_id = new_post_id;
 }
-void Comment::setUserName(const std::string& new_user_name) {
-    user_name = new_user_name;
+void Comment::setUserName(std::string_view new_user_name) {
+    user_name = Atom(new_user_name);
 }
 
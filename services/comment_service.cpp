@@ -1,10 +1,14 @@
 #include "comment_service.h"
+#include "../database/db_utils.h"
+#include "post_store.h"
+#include "affinity_store.h"
+#include "../utils/id_generator.h"
 #include <iostream>
 #include <string>
 
 #define DB_PATH "../database/users.db"
 
-static int createComment(sqlite3* db, int postId, const std::string& username, const std::string& comment){
+static int64_t createComment(sqlite3* db, int64_t postId, const std::string& username, const std::string& comment){
     std::string userIdQuery = "SELECT id FROM users WHERE username = ?;";
     sqlite3_stmt* userStmt;
     int userId = -1;
@@ -16,36 +20,44 @@ static int createComment(sqlite3* db, int postId, const std::string& username, c
         sqlite3_finalize(userStmt);
     }
     if (userId == -1) return -1;
-    std::string query = "INSERT INTO comments (post_id, user_id, content) VALUES (?, ?, ?);";
+    // The id is generated here rather than by SQLite so comments sort by id; created_at is the time it encodes
+    int64_t commentId = IdGenerator::comments().next();
+    std::string query = "INSERT INTO comments (id, post_id, user_id, content, created_at) VALUES (?, ?, ?, ?, ?);";
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
         return -1;
-    sqlite3_bind_int(stmt, 1, postId);
-    sqlite3_bind_int(stmt, 2, userId);
-    sqlite3_bind_text(stmt, 3, comment.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 1, commentId);
+    sqlite3_bind_int64(stmt, 2, postId);
+    sqlite3_bind_int(stmt, 3, userId);
+    sqlite3_bind_text(stmt, 4, comment.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 5, IdGenerator::millisOf(commentId));
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
     if (success) {
         std::string updateQuery = "UPDATE posts SET comment_count = comment_count + 1 WHERE id = ?;";
         sqlite3_stmt* updateStmt;
         if (sqlite3_prepare_v2(db, updateQuery.c_str(), -1, &updateStmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int(updateStmt, 1, postId);
+            sqlite3_bind_int64(updateStmt, 1, postId);
             sqlite3_step(updateStmt);
             sqlite3_finalize(updateStmt);
         }
-        return sqlite3_last_insert_rowid(db);
+        if (std::shared_ptr<const Post> post = PostStore::instance().get(db, postId)) {
+            AffinityStore::instance().record(username, std::string(post->getUserName()), AffinityStore::kCommentWeight);
+        }
+        PostStore::instance().invalidate(postId);
+        return commentId;
     }
     return -1;
 }
 
-static bool deleteComment(sqlite3* db, int commentId){
-    int postId = -1;
+static bool deleteComment(sqlite3* db, int64_t commentId){
+    int64_t postId = -1;
     std::string postIdQuery = "SELECT post_id FROM comments WHERE id = ?;";
     sqlite3_stmt* postStmt;
     if (sqlite3_prepare_v2(db, postIdQuery.c_str(), -1, &postStmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_int(postStmt, 1, commentId);
+        sqlite3_bind_int64(postStmt, 1, commentId);
         if (sqlite3_step(postStmt) == SQLITE_ROW) {
-            postId = sqlite3_column_int(postStmt, 0);
+            postId = sqlite3_column_int64(postStmt, 0);
         }
         sqlite3_finalize(postStmt);
     }
@@ -54,40 +66,41 @@ static bool deleteComment(sqlite3* db, int commentId){
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
         return false;
-    sqlite3_bind_int(stmt, 1, commentId);
+    sqlite3_bind_int64(stmt, 1, commentId);
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
     if (success) {
         std::string updateQuery = "UPDATE posts SET comment_count = comment_count - 1 WHERE id = ? AND comment_count > 0;";
         sqlite3_stmt* updateStmt;
         if (sqlite3_prepare_v2(db, updateQuery.c_str(), -1, &updateStmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int(updateStmt, 1, postId);
+            sqlite3_bind_int64(updateStmt, 1, postId);
             sqlite3_step(updateStmt);
             sqlite3_finalize(updateStmt);
         }
+        PostStore::instance().invalidate(postId);
     }
     return success;
 }
 
 
-std::vector<Comment> CommentService::getCommentsByPost(int post_id) {
+std::vector<Comment> CommentService::getCommentsByPost(int64_t post_id) {
     sqlite3* db;
     sqlite3_open(DB_PATH, &db);
     std::vector<Comment> comments;
     std::string query = "SELECT comments.id, comments.post_id, users.username, comments.content, comments.created_at "
                         "FROM comments JOIN users ON comments.user_id = users.id "
-                        "WHERE comments.post_id = ? ORDER BY comments.created_at ASC";
+                        "WHERE comments.post_id = ? ORDER BY comments.id ASC";
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_int(stmt, 1, post_id);
+        sqlite3_bind_int64(stmt, 1, post_id);
         while (sqlite3_step(stmt) == SQLITE_ROW) {
             Comment comment;
-            comment.setId(sqlite3_column_int(stmt, 0));
-            comment.setPostId(sqlite3_column_int(stmt, 1));
+            comment.setId(sqlite3_column_int64(stmt, 0));
+            comment.setPostId(sqlite3_column_int64(stmt, 1));
             comment.setUserName(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)));
             comment.setContent(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)));
-            comment.setCreatedAt(static_cast<std::time_t>(sqlite3_column_int64(stmt, 4)));
-            comments.push_back(comment);
+            comment.setCreatedAt(columnEpochSeconds(stmt, 4));
+            comments.push_back(std::move(comment));
         }
     } else {
         std::cerr << "Select failed: " << sqlite3_errmsg(db) << std::endl;
@@ -97,21 +110,21 @@ std::vector<Comment> CommentService::getCommentsByPost(int post_id) {
     return comments;
 }
 
-Comment* CommentService::getCommentById(int comment_id) {
+Comment* CommentService::getCommentById(int64_t comment_id) {
     sqlite3* db;
     sqlite3_open(DB_PATH, &db);
     std::string query = "SELECT id, post_id, user_name, content, created_at FROM comments WHERE id = ?";
     sqlite3_stmt* stmt;
     Comment* comment = nullptr;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_int(stmt, 1, comment_id);
+        sqlite3_bind_int64(stmt, 1, comment_id);
         if (sqlite3_step(stmt) == SQLITE_ROW) {
             comment = new Comment();
-            comment->setId(sqlite3_column_int(stmt, 0));
-            comment->setPostId(sqlite3_column_int(stmt, 1));
+            comment->setId(sqlite3_column_int64(stmt, 0));
+            comment->setPostId(sqlite3_column_int64(stmt, 1));
             comment->setUserName(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)));
             comment->setContent(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)));
-            comment->setCreatedAt(static_cast<std::time_t>(sqlite3_column_int64(stmt, 4)));
+            comment->setCreatedAt(columnEpochSeconds(stmt, 4));
         }
     } else {
         std::cerr << "Select failed: " << sqlite3_errmsg(db) << std::endl;
@@ -121,7 +134,7 @@ Comment* CommentService::getCommentById(int comment_id) {
     return comment;
 }
 
-bool CommentService::updateComment(int comment_id, const std::string& new_content) {
+bool CommentService::updateComment(int64_t comment_id, const std::string& new_content) {
     sqlite3* db;
     sqlite3_open(DB_PATH, &db);
     std::string query = "UPDATE comments SET content = ? WHERE id = ?";
@@ -129,7 +142,7 @@ bool CommentService::updateComment(int comment_id, const std::string& new_conten
     bool success = false;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
         sqlite3_bind_text(stmt, 1, new_content.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 2, comment_id);
+        sqlite3_bind_int64(stmt, 2, comment_id);
         success = (sqlite3_step(stmt) == SQLITE_DONE);
         if (!success) {
             std::cerr << "Update comment failed: " << sqlite3_errmsg(db) << std::endl;
@@ -142,11 +155,11 @@ bool CommentService::updateComment(int comment_id, const std::string& new_conten
     return success;
 }
 
-int CommentService::createComment(sqlite3* db, int postId, const std::string& username, const std::string& comment) {
+int64_t CommentService::createComment(sqlite3* db, int64_t postId, const std::string& username, const std::string& comment) {
     return ::createComment(db, postId, username, comment);
 }
 
-bool CommentService::deleteComment(sqlite3* db, int commentId) {
+bool CommentService::deleteComment(sqlite3* db, int64_t commentId) {
     return ::deleteComment(db, commentId);
 }
 
@@ -10,17 +10,17 @@ class CommentService {
 public:
 
     // Create a new comment on a post
-    static int createComment(sqlite3* db, int postId, const std::string& username, const std::string& comment);
+    static int64_t createComment(sqlite3* db, int64_t postId, const std::string& username, const std::string& comment);
 
     // Update a comment's content
-    static bool updateComment(int comment_id, const std::string& new_content);
+    static bool updateComment(int64_t comment_id, const std::string& new_content);
 
     // Delete a comment by its ID
-    static bool deleteComment(sqlite3* db, int commentId);
+    static bool deleteComment(sqlite3* db, int64_t commentId);
 
     // Get all comments for a post
-    static std::vector<Comment> getCommentsByPost(int post_id);
+    static std::vector<Comment> getCommentsByPost(int64_t post_id);
 
     // Get a comment by its ID
-    static Comment* getCommentById(int comment_id);
+    static Comment* getCommentById(int64_t comment_id);
 };
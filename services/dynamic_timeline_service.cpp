@@ -1,17 +1,69 @@
 #include "dynamic_timeline_service.h"
 #include "../database/db_utils.h"
+#include "affinity_store.h"
+#include "feed_log.h"
+#include "post_store.h"
+#include "timeline_ranker.h"
+#include "../utils/id_generator.h"
+#include "../utils/time_utils.h"
+#include <atomic>
+#include <cmath>
 #include <iostream>
-#include <nlohmann/json.hpp>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+    const size_t kMaxFetchThreads = 16;
+
+    std::mutex fetchPoolMutex;
+    std::shared_ptr<ThreadPool> sharedFetchPool;
+    size_t fetchPoolThreads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), kMaxFetchThreads));
+
+    // Callers hold the returned pointer until their tasks finish, so resizing never
+    // drops work that's already been submitted
+    std::shared_ptr<ThreadPool> fetchPool(size_t& threads) {
+        std::lock_guard<std::mutex> lock(fetchPoolMutex);
+        if (!sharedFetchPool) {
+            sharedFetchPool = std::make_shared<ThreadPool>(fetchPoolThreads);
+        }
+        threads = fetchPoolThreads;
+        return sharedFetchPool;
+    }
+
+    std::atomic<uint64_t> timelinesBuilt(0);
+    std::atomic<uint64_t> rowsFetched(0);
+    std::atomic<uint64_t> rowsReturned(0);
+    std::atomic<uint64_t> runRefills(0);
+
+    // Recent posting rate per author, in posts per hour, smoothed across fetches
+    const size_t kMaxTrackedAuthors = 100000;
+    std::mutex authorRateMutex;
+    std::unordered_map<std::string, double> authorRates;
+
+    // When post was made. Posts from before ids were generated carry it only in created_at.
+    int64_t createdMillis(const Post& post) {
+        return IdGenerator::isGenerated(post.getId()) ? IdGenerator::millisOf(post.getId())
+                                                      : (int64_t)post.getcreated_at() * 1000;
+    }
+}
 
 DynamicTimelineService::DynamicTimelineService(sqlite3* db) 
     : db(db), friendService(db) {}
 
-std::vector<Post> DynamicTimelineService::generateDynamicTimeline(const std::string& username, int limit) {
+std::vector<Post> DynamicTimelineService::generateDynamicTimeline(const std::string& username, int limit,
+                                                                  std::vector<std::string>* authors, int64_t beforeId) {
     std::cout << "=== GENERATING AVL-MANAGED DYNAMIC TIMELINE FOR: " << username << " ===" << std::endl;
     
     timelineTree.clear();
     
-    loadAllPostsIntoAVL(username);
+    std::vector<std::string> friends = loadAllPostsIntoAVL(username, limit, beforeId);
+    if (authors) {
+        *authors = std::move(friends);
+        authors->push_back(username);
+    }
     
     std::vector<Post> timeline = timelineTree.getTimelineInOrder(limit);
     std::cout << "Generated AVL timeline with " << timeline.size() << " posts" << std::endl;
@@ -21,26 +73,49 @@ std::vector<Post> DynamicTimelineService::generateDynamicTimeline(const std::str
     return timeline;
 }
 
-std::vector<std::string> DynamicTimelineService::loadFriendsFromAVL(const std::string& username) {
-    std::string jsonFriends = getFriendsList(db, username);
-    
+std::vector<Post> DynamicTimelineService::generateRankedTimeline(const std::string& username, int limit, int candidates) {
     std::vector<std::string> friends;
-    try {
-        nlohmann::json j = nlohmann::json::parse(jsonFriends);
-        for (const auto& friendName : j) {
-            friends.push_back(friendName.get<std::string>());
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "Error parsing friends JSON: " << e.what() << std::endl;
+    std::vector<std::shared_ptr<const Post>> pool = collectNewest(username, std::max(limit, candidates), 0, friends);
+
+    std::unordered_map<std::string, double> scores = AffinityStore::instance().scoresOf(username);
+    auto affinity = [&scores](std::string_view author) {
+        auto it = scores.find(std::string(author));
+        return it == scores.end() ? 0.0 : it->second;
+    };
+
+    std::vector<int64_t> ids;
+    ids.reserve(pool.size());
+    for (const auto& post : pool) {
+        ids.push_back(post->getId());
     }
-    return friends;
+    std::unordered_set<int64_t> seen = FeedLog::instance().seenAmong(db, username, ids);
+    std::vector<std::shared_ptr<const Post>> unseen;
+    std::vector<std::shared_ptr<const Post>> shown;
+    for (auto& post : pool) {
+        (seen.count(post->getId()) ? shown : unseen).push_back(std::move(post));
+    }
+
+    TimelineRanker& ranker = TimelineRanker::instance();
+    std::vector<Post> timeline;
+    timeline.reserve(limit);
+    for (const auto& post : ranker.topK(unseen, limit, affinity)) {
+        timeline.push_back(*post);
+    }
+    for (const auto& post : ranker.topK(shown, limit - timeline.size(), affinity)) {
+        timeline.push_back(*post);
+    }
+    return timeline;
+}
+
+std::vector<std::string> DynamicTimelineService::loadFriendsFromAVL(const std::string& username) {
+    return getFriendNames(db, username);
 }
 
 void DynamicTimelineService::addPostToTimeline(const Post& post) {
     timelineTree.insert(post);
 }
 
-void DynamicTimelineService::removePostFromTimeline(int postId) {
+void DynamicTimelineService::removePostFromTimeline(int64_t postId) {
     timelineTree.remove(postId);
 }
 
@@ -48,67 +123,238 @@ void DynamicTimelineService::clearTimeline() {
     timelineTree.clear();
 }
 
-void DynamicTimelineService::loadAllPostsIntoAVL(const std::string& username) {
+void DynamicTimelineService::setFetchThreads(size_t threads) {
+    std::lock_guard<std::mutex> lock(fetchPoolMutex);
+    fetchPoolThreads = std::max<size_t>(1, std::min(threads, kMaxFetchThreads));
+    sharedFetchPool.reset();
+}
+
+DynamicTimelineService::FetchStats DynamicTimelineService::fetchStats() {
+    return FetchStats{timelinesBuilt.load(), rowsFetched.load(), rowsReturned.load(), runRefills.load()};
+}
+
+double DynamicTimelineService::postingRate(const std::string& author) {
+    std::lock_guard<std::mutex> lock(authorRateMutex);
+    auto it = authorRates.find(author);
+    return it == authorRates.end() ? -1.0 : it->second;
+}
+
+std::vector<std::string> DynamicTimelineService::loadAllPostsIntoAVL(const std::string& username, int limit, int64_t beforeId) {
     std::cout << "Loading posts into AVL tree for user: " << username << std::endl;
-    loadUserPostsIntoAVL(username, 50);
-    std::vector<std::string> friends = loadFriendsFromAVL(username);
-    std::cout << "Loaded " << friends.size() << " friends from AVL tree" << std::endl;
-    loadFriendsPostsIntoAVL(friends, 20);
+    std::vector<std::string> friends;
+    for (const auto& post : collectNewest(username, limit, beforeId, friends)) {
+        timelineTree.insert(*post);
+    }
     std::cout << "Total posts in AVL tree: " << timelineTree.size() << std::endl;
+    return friends;
 }
 
-void DynamicTimelineService::loadUserPostsIntoAVL(const std::string& username, int limit) {
-    std::string userId = getUserIdFromUsername(username);
-    
-    if (userId.empty()) {
-        return;
+std::vector<std::shared_ptr<const Post>> DynamicTimelineService::collectNewest(const std::string& username, int limit,
+                                                                              int64_t beforeId, std::vector<std::string>& friends) {
+    friends = loadFriendsFromAVL(username);
+    std::cout << "Loaded " << friends.size() << " friends from AVL tree" << std::endl;
+
+    // runs[i] belongs to authors[i]: the friends, then the user. Friends' runs are fetched
+    // on the pool while this thread reads the user's own posts.
+    std::vector<std::string> authors = friends;
+    authors.push_back(username);
+    std::vector<int> budgets = planBudgets(authors, limit);
+    std::vector<AuthorRun> runs(authors.size());
+    std::shared_ptr<ThreadPool> pool;  // Kept alive until the fetches finish
+    std::vector<std::future<bool>> pending = loadFriendsPostRuns(friends, budgets, beforeId, runs, pool);
+    fetchAuthorRun(db, username, budgets.back(), beforeId, runs.back());
+    for (size_t t = 0; t < pending.size(); t++) {
+        if (!pending[t].get()) {
+            for (size_t i = t; i < friends.size(); i += pending.size()) {
+                fetchAuthorRun(db, friends[i], budgets[i], beforeId, runs[i]);
+            }
+        }
     }
-    
-    std::string query = R"(
-        SELECT p.id, p.content, p.user_id, p.created_at,
-               COALESCE(l.like_count, 0) as like_count,
-               COALESCE(c.comment_count, 0) as comment_count
-        FROM posts p
-        LEFT JOIN (
-            SELECT post_id, COUNT(*) as like_count 
-            FROM likes 
-            GROUP BY post_id
-        ) l ON p.id = l.post_id
-        LEFT JOIN (
-            SELECT post_id, COUNT(*) as comment_count 
-            FROM comments 
-            GROUP BY post_id
-        ) c ON p.id = c.post_id
-        WHERE p.user_id = ?
-        ORDER BY p.created_at DESC
-        LIMIT ?
-    )";
-    
+
+    // Only the newest `limit` posts can make the page
+    std::vector<std::shared_ptr<const Post>> merged = mergeNewestFirst(runs, authors, limit);
+    int64_t upperMillis = time_utils::nowMillis();
+    if (beforeId > 0 && IdGenerator::isGenerated(beforeId)) {
+        upperMillis = IdGenerator::millisOf(beforeId);
+    } else if (beforeId > 0) {
+        std::shared_ptr<const Post> cursorPost = PostStore::instance().get(db, beforeId);
+        if (cursorPost) {
+            upperMillis = createdMillis(*cursorPost);
+        }
+    }
+    noteAuthorRates(authors, runs, upperMillis);
+    timelinesBuilt++;
+    rowsReturned += merged.size();
+    return merged;
+}
+
+std::vector<std::future<bool>> DynamicTimelineService::loadFriendsPostRuns(const std::vector<std::string>& friendUsernames,
+                                                                           const std::vector<int>& budgets, int64_t beforeId,
+                                                                           std::vector<AuthorRun>& runs, std::shared_ptr<ThreadPool>& pool) {
+    std::vector<std::future<bool>> pending;
+    const char* path = sqlite3_db_filename(db, "main");
+    size_t threads = 0;
+    if (friendUsernames.size() >= kParallelMinFriends && path != nullptr && *path != '\0') {
+        pool = fetchPool(threads);
+    }
+
+    if (!pool) {
+        for (size_t i = 0; i < friendUsernames.size(); i++) {
+            fetchAuthorRun(db, friendUsernames[i], budgets[i], beforeId, runs[i]);
+        }
+        return pending;
+    }
+
+    // Task t fetches friends t, t + tasks, t + 2 * tasks, ... on its worker's own read
+    // connection. Every run slot has exactly one writer, so the tasks share no state.
+    size_t tasks = std::min(threads, friendUsernames.size());
+    std::string dbPath = path;
+    for (size_t t = 0; t < tasks; t++) {
+        auto task = std::make_shared<std::packaged_task<bool()>>([&friendUsernames, &budgets, &runs, beforeId, dbPath, t, tasks] {
+            sqlite3* reader = threadReadConnection(dbPath);
+            if (reader == nullptr) {
+                // db can't be shared with the caller, which is reading on it now
+                std::cerr << "Timeline fetch: no read connection on worker, leaving "
+                          << (friendUsernames.size() - t + tasks - 1) / tasks << " friends to the caller" << std::endl;
+                return false;
+            }
+            for (size_t i = t; i < friendUsernames.size(); i += tasks) {
+                fetchAuthorRun(reader, friendUsernames[i], budgets[i], beforeId, runs[i]);
+            }
+            return true;
+        });
+        pending.push_back(task->get_future());
+        pool->submit([task] { (*task)(); });
+    }
+    return pending;
+}
+
+void DynamicTimelineService::fetchAuthorRun(sqlite3* db, const std::string& username, int limit, int64_t beforeId,
+                                            AuthorRun& run) {
+    // Only the newest ids come from SQLite; the posts themselves come from the shared store
+    std::string query = "SELECT posts.id FROM posts JOIN users ON posts.user_id = users.id "
+                        "WHERE users.username = ? AND posts.id < ? ORDER BY posts.id DESC LIMIT ?";
+
+    std::vector<int64_t> postIds;
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, userId.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 2, limit);
-        
+        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, beforeId > 0 ? beforeId : std::numeric_limits<int64_t>::max());
+        sqlite3_bind_int(stmt, 3, limit);
+
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            int id = sqlite3_column_int(stmt, 0);
-            std::string content = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            std::string user_id = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-            std::time_t created_at = static_cast<std::time_t>(sqlite3_column_int64(stmt, 3));
-            int like_count = sqlite3_column_int(stmt, 4);
-            int comment_count = sqlite3_column_int(stmt, 5);
-            
-            Post post(id, username, content, "", created_at, like_count, comment_count);
-            timelineTree.insert(post);
+            postIds.push_back(sqlite3_column_int64(stmt, 0));
         }
         sqlite3_finalize(stmt);
     } else {
         std::cerr << "Error preparing user posts query: " << sqlite3_errmsg(db) << std::endl;
+        run.more = false;
+        return;
+    }
+    rowsFetched += postIds.size();
+    run.requested = limit;
+    run.more = (int)postIds.size() == limit;
+
+    for (auto& post : PostStore::instance().multiGet(db, postIds)) {
+        if (post) {  // Deleted after the id query otherwise
+            run.posts.push_back(std::move(post));
+        }
     }
 }
 
-void DynamicTimelineService::loadFriendsPostsIntoAVL(const std::vector<std::string>& friendUsernames, int postsPerFriend) {
-    for (const std::string& friendUsername : friendUsernames) {
-        loadUserPostsIntoAVL(friendUsername, postsPerFriend);
+std::vector<std::shared_ptr<const Post>> DynamicTimelineService::mergeNewestFirst(std::vector<AuthorRun>& runs,
+                                                                                 const std::vector<std::string>& authors, int limit) {
+    // K-way merge on the ids, which sort by creation time. The heap holds the head of each run.
+    using Head = std::pair<int64_t, std::pair<size_t, size_t>>;  // (post id, (run, position))
+    std::priority_queue<Head> heads;
+    for (size_t r = 0; r < runs.size(); r++) {
+        if (!runs[r].posts.empty()) {
+            heads.push(Head(runs[r].posts[0]->getId(), std::make_pair(r, 0)));
+        }
+    }
+
+    std::vector<std::shared_ptr<const Post>> merged;
+    merged.reserve(limit > 0 ? limit : 0);
+    while (!heads.empty() && (int)merged.size() < limit) {
+        size_t r = heads.top().second.first;
+        size_t pos = heads.top().second.second;
+        heads.pop();
+        AuthorRun& run = runs[r];
+        merged.push_back(run.posts[pos]);
+
+        // The author's next post could still outrank every other head, so the run can't
+        // simply end here. Fetch more, doubling each time but never past what the page needs.
+        int needed = limit - (int)merged.size();
+        if (pos + 1 == run.posts.size() && run.more && needed > 0) {
+            int chunk = std::min(needed, std::max(4, run.requested * 2));
+            fetchAuthorRun(db, authors[r], chunk, run.posts.back()->getId(), run);
+            runRefills++;
+        }
+        if (pos + 1 < run.posts.size()) {
+            heads.push(Head(run.posts[pos + 1]->getId(), std::make_pair(r, pos + 1)));
+        }
+    }
+    return merged;
+}
+
+std::vector<int> DynamicTimelineService::planBudgets(const std::vector<std::string>& authors, int limit) {
+    // Authors not seen yet are assumed to post at the average rate of those that have been
+    std::vector<double> rates(authors.size(), -1.0);
+    double knownTotal = 0.0;
+    size_t known = 0;
+    {
+        std::lock_guard<std::mutex> lock(authorRateMutex);
+        for (size_t i = 0; i < authors.size(); i++) {
+            auto it = authorRates.find(authors[i]);
+            if (it != authorRates.end()) {
+                rates[i] = it->second;
+                knownTotal += it->second;
+                known++;
+            }
+        }
+    }
+
+    std::vector<int> budgets(authors.size());
+    if (known == 0 || knownTotal <= 0.0) {
+        int even = (int)std::ceil(limit * kBudgetSlack / authors.size());
+        std::fill(budgets.begin(), budgets.end(), std::max(1, std::min(even, limit)));
+        return budgets;
+    }
+
+    // A page of limit posts spans about limit / (total rate) hours; each author's share of
+    // it is their rate times that span
+    double unknownRate = knownTotal / known;
+    double totalRate = knownTotal + unknownRate * (authors.size() - known);
+    double pageHours = limit / totalRate;
+    for (size_t i = 0; i < authors.size(); i++) {
+        double rate = rates[i] >= 0.0 ? rates[i] : unknownRate;
+        int budget = (int)std::ceil(rate * pageHours * kBudgetSlack);
+        budgets[i] = std::max(1, std::min(budget, limit));
+    }
+    return budgets;
+}
+
+void DynamicTimelineService::noteAuthorRates(const std::vector<std::string>& authors, const std::vector<AuthorRun>& runs,
+                                             int64_t upperMillis) {
+    // A run of n posts reaching back to time t says the author posted about n times between
+    // t and the page's upper bound. A short run reached back as far as the author goes.
+    std::lock_guard<std::mutex> lock(authorRateMutex);
+    if (authorRates.size() > kMaxTrackedAuthors) {
+        authorRates.clear();
+    }
+    for (size_t i = 0; i < authors.size(); i++) {
+        const PostRun& posts = runs[i].posts;
+        double rate = 0.0;
+        if (!posts.empty()) {
+            double hours = (upperMillis - createdMillis(*posts.back())) / 3600000.0;
+            rate = posts.size() / std::max(hours, 1.0 / 60);
+        }
+        auto it = authorRates.find(authors[i]);
+        if (it == authorRates.end()) {
+            authorRates.emplace(authors[i], rate);
+        } else {
+            it->second = 0.5 * it->second + 0.5 * rate;
+        }
     }
 }
 
@@ -3,30 +3,90 @@
 
 #include <vector>
 #include <string>
+#include <future>
+#include <memory>
 #include <sqlite3.h>
 #include <algorithm>
+#include <unordered_map>
 #include <unordered_set>
 #include "Post.h"
-#include "PostAVLTree.h"
+#include "timeline_index.h"
 #include "friend_suggestion_service.h"
+#include "../utils/thread_pool.h"
 
 class DynamicTimelineService {
 public:
     explicit DynamicTimelineService(sqlite3* db);
-    std::vector<Post> generateDynamicTimeline(const std::string& username, int limit = 50);
+    // If authors is given, it receives every user whose posts the timeline draws from.
+    // A nonzero beforeId pages back: only posts with smaller (older) ids are considered.
+    std::vector<Post> generateDynamicTimeline(const std::string& username, int limit = 50,
+                                              std::vector<std::string>* authors = nullptr, int64_t beforeId = 0);
+    // The limit best of the newest candidates posts by TimelineRanker's score, best first.
+    // Posts the user has already been shown (FeedLog) only fill places no unseen post takes.
+    std::vector<Post> generateRankedTimeline(const std::string& username, int limit = 50, int candidates = 500);
     void addPostToTimeline(const Post& post);
-    void removePostFromTimeline(int postId);
+    void removePostFromTimeline(int64_t postId);
     void clearTimeline();
 
+    // Threads used to fetch friends' posts in parallel (default: hardware threads, at most 16)
+    static void setFetchThreads(size_t threads);
+
+    // Process-wide counters for how many post rows timelines read per row they return
+    struct FetchStats {
+        uint64_t timelines;
+        uint64_t rowsFetched;
+        uint64_t rowsReturned;
+        uint64_t refills;       // Extra fetches for authors whose budget ran out mid-merge
+        double rowsPerReturned() const { return rowsReturned ? (double)rowsFetched / rowsReturned : 0.0; }
+    };
+    static FetchStats fetchStats();
+
+    // Posts per hour seen from author on recent fetches, smoothed; -1 if none were seen
+    static double postingRate(const std::string& author);
+
 private:
+    using PostRun = std::vector<std::shared_ptr<const Post>>;
+
+    // One author's posts, newest first, and whether the database may hold older ones
+    struct AuthorRun {
+        PostRun posts;
+        int requested = 0;  // Size of the last fetch
+        bool more = false;  // The last fetch came back full
+    };
+
+    // Below this many friends the fetch stays on the caller's thread
+    static const size_t kParallelMinFriends = 4;
+    // Budgets aim for this many times each author's expected share of the page
+    static constexpr double kBudgetSlack = 1.5;
+
     sqlite3* db;
     FriendSuggestionService friendService;
-    PostAVLTree timelineTree;  
+    TimelineIndex timelineTree;
     
     std::vector<std::string> loadFriendsFromAVL(const std::string& username);
-    void loadAllPostsIntoAVL(const std::string& username);
-    void loadUserPostsIntoAVL(const std::string& username, int limit = 100);
-    void loadFriendsPostsIntoAVL(const std::vector<std::string>& friendUsernames, int postsPerFriend = 20);
+    std::vector<std::string> loadAllPostsIntoAVL(const std::string& username, int limit, int64_t beforeId);
+    // The newest limit posts by username and their friends; friends receives the friends
+    std::vector<std::shared_ptr<const Post>> collectNewest(const std::string& username, int limit, int64_t beforeId,
+                                                           std::vector<std::string>& friends);
+    // Fills runs[i] with up to budgets[i] of friend i's newest posts. If the work went to the
+    // pool, pool is set and must outlive the returned futures; wait on them before reading runs.
+    // Future t is false if task t couldn't open a read connection: its friends, t, t + n,
+    // t + 2n, ... for n futures, are left for the caller to fetch on db.
+    std::vector<std::future<bool>> loadFriendsPostRuns(const std::vector<std::string>& friendUsernames,
+                                                       const std::vector<int>& budgets, int64_t beforeId,
+                                                       std::vector<AuthorRun>& runs, std::shared_ptr<ThreadPool>& pool);
+    // Appends up to limit of username's posts older than beforeId (0: no bound) to run
+    static void fetchAuthorRun(sqlite3* db, const std::string& username, int limit, int64_t beforeId, AuthorRun& run);
+    // The newest limit posts across runs. A run that runs out while it may still have older
+    // posts is topped up from the database first, so the result is exact whatever the budgets.
+    std::vector<std::shared_ptr<const Post>> mergeNewestFirst(std::vector<AuthorRun>& runs,
+                                                              const std::vector<std::string>& authors, int limit);
+    // How many posts to fetch up front from each author: their expected share of a page of
+    // limit posts, from the posting rates seen on earlier fetches
+    static std::vector<int> planBudgets(const std::vector<std::string>& authors, int limit);
+    // upperMillis is the time the page reaches up to: now, or when the cursor post was made
+    static void noteAuthorRates(const std::vector<std::string>& authors, const std::vector<AuthorRun>& runs,
+                                int64_t upperMillis);
     std::string getUserIdFromUsername(const std::string& username);
     std::string getUsernameFromUserId(const std::string& userId);
     void updatePostCounts(std::vector<Post>& posts);
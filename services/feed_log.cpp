@@ -0,0 +1,272 @@
+#include "feed_log.h"
+#include "../utils/time_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+FeedLog& FeedLog::instance() {
+    static FeedLog log;
+    return log;
+}
+
+FeedLog::FeedLog() : pendingRows(0), persistent(true), recorded(0), rowsWritten(0), flushes(0), writer(nullptr), running(false) {}
+
+void FeedLog::start(sqlite3* db) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) {
+        return;
+    }
+    const char* path = sqlite3_db_filename(db, "main");
+    if (path == nullptr || *path == '\0') {
+        std::cerr << "Feed log disabled: database has no file" << std::endl;
+        disablePersistenceLocked();
+        return;
+    }
+    std::lock_guard<std::mutex> flushLock(flushMutex);
+    if (sqlite3_open_v2(path, &writer, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        std::cerr << "Can't open " << path << " for feed writes: " << sqlite3_errmsg(writer) << std::endl;
+        sqlite3_close(writer);
+        writer = nullptr;
+        disablePersistenceLocked();
+        return;
+    }
+    sqlite3_busy_timeout(writer, 5000);
+    running = true;
+    flusher = std::thread(&FeedLog::flushLoop, this);
+}
+
+void FeedLog::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    wake.notify_all();
+    flusher.join();
+    flush();
+    std::lock_guard<std::mutex> flushLock(flushMutex);
+    sqlite3_close(writer);
+    writer = nullptr;
+}
+
+void FeedLog::disablePersistenceLocked() {
+    persistent = false;
+    pending.clear();
+    pendingRows = 0;
+}
+
+void FeedLog::recordShown(const std::string& username, const std::vector<int64_t>& postIds) {
+    if (postIds.empty()) {
+        return;
+    }
+    int64_t now = time_utils::nowMillis();
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        LastSeen& last = lastSeen[username];
+        last.postId = std::max(last.postId, *std::max_element(postIds.begin(), postIds.end()));
+        recorded += postIds.size();
+        if (!persistent) {
+            return;
+        }
+        auto& rows = pending[username];
+        for (int64_t postId : postIds) {
+            rows.push_back(Shown{postId, now});
+        }
+        pendingRows += postIds.size();
+        full = running && pendingRows >= kMaxPending;
+    }
+    if (full) {
+        wake.notify_all();
+    }
+}
+
+std::unordered_set<int64_t> FeedLog::seenAmong(sqlite3* db, const std::string& username,
+                                               const std::vector<int64_t>& postIds) {
+    std::unordered_set<int64_t> seen;
+    if (postIds.empty()) {
+        return seen;
+    }
+    std::unordered_set<int64_t> wanted(postIds.begin(), postIds.end());
+
+    // Buffer first: a row leaves it only after it is committed, so anything missed here is
+    // in the table by the time of the query below
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto* buffer : {&pending, &inFlight}) {
+            auto rows = buffer->find(username);
+            if (rows == buffer->end()) {
+                continue;
+            }
+            for (const Shown& row : rows->second) {
+                if (wanted.count(row.postId)) {
+                    seen.insert(row.postId);
+                }
+            }
+        }
+    }
+
+    auto [lowest, highest] = std::minmax_element(postIds.begin(), postIds.end());
+    const char* query =
+        "SELECT post_id FROM feed WHERE user_id = (SELECT id FROM users WHERE username = ?) "
+        "AND post_id BETWEEN ? AND ?";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing seen query: " << sqlite3_errmsg(db) << std::endl;
+        return seen;
+    }
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, *lowest);
+    sqlite3_bind_int64(stmt, 3, *highest);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int64_t postId = sqlite3_column_int64(stmt, 0);
+        if (wanted.count(postId)) {
+            seen.insert(postId);
+        }
+    }
+    sqlite3_finalize(stmt);
+    return seen;
+}
+
+int64_t FeedLog::lastSeenId(sqlite3* db, const std::string& username) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = lastSeen.find(username);
+        if (it != lastSeen.end() && it->second.loaded) {
+            return it->second.postId;
+        }
+    }
+
+    // Whatever was served since start is already in the entry; the table adds the rest
+    int64_t stored = 0;
+    const char* query = "SELECT MAX(post_id) FROM feed WHERE user_id = (SELECT id FROM users WHERE username = ?)";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing last seen query: " << sqlite3_errmsg(db) << std::endl;
+        return 0;
+    }
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        stored = sqlite3_column_int64(stmt, 0);  // 0 for NULL: never shown anything
+    }
+    sqlite3_finalize(stmt);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    LastSeen& last = lastSeen[username];
+    last.postId = std::max(last.postId, stored);
+    last.loaded = true;
+    return last.postId;
+}
+
+int FeedLog::unreadCount(sqlite3* db, const std::string& username) {
+    int64_t last = lastSeenId(db, username);
+    if (last == 0) {
+        return 0;
+    }
+    // Each friend's posts are an index range on idx_posts_user above the last seen id
+    const char* query =
+        "SELECT COUNT(*) FROM (SELECT 1 FROM posts WHERE id > ?2 AND user_id IN ("
+        "  SELECT addressee_id FROM friends WHERE status = 'accepted' AND requester_id = (SELECT id FROM users WHERE username = ?1)"
+        "  UNION"
+        "  SELECT requester_id FROM friends WHERE status = 'accepted' AND addressee_id = (SELECT id FROM users WHERE username = ?1)"
+        ") LIMIT ?3)";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing unread query: " << sqlite3_errmsg(db) << std::endl;
+        return 0;
+    }
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, last);
+    sqlite3_bind_int(stmt, 3, kMaxUnread);
+    int count = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+FeedLog::Stats FeedLog::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return Stats{recorded, rowsWritten, flushes, pendingRows};
+}
+
+void FeedLog::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        wake.wait_for(lock, std::chrono::seconds(kFlushIntervalSeconds),
+                      [this] { return !running || pendingRows >= kMaxPending; });
+        if (!running) {
+            break;
+        }
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+void FeedLog::flush() {
+    std::lock_guard<std::mutex> flushLock(flushMutex);
+    if (writer == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.empty()) {
+            return;
+        }
+        inFlight.swap(pending);
+        pendingRows = 0;
+    }
+
+    const char* userSql = "SELECT id FROM users WHERE username = ?";
+    const char* insertSql = "INSERT OR IGNORE INTO feed (user_id, post_id, shown_at) VALUES (?, ?, ?)";
+    sqlite3_stmt* userStmt = nullptr;
+    sqlite3_stmt* insert = nullptr;
+    bool ok = sqlite3_prepare_v2(writer, userSql, -1, &userStmt, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(writer, insertSql, -1, &insert, nullptr) == SQLITE_OK &&
+              sqlite3_exec(writer, "BEGIN", nullptr, nullptr, nullptr) == SQLITE_OK;
+    size_t rows = 0;
+    if (ok) {
+        // inFlight is only changed by flush(), which flushMutex keeps to one thread
+        for (const auto& [username, shown] : inFlight) {
+            sqlite3_bind_text(userStmt, 1, username.c_str(), -1, SQLITE_STATIC);
+            int64_t userId = sqlite3_step(userStmt) == SQLITE_ROW ? sqlite3_column_int64(userStmt, 0) : -1;
+            sqlite3_reset(userStmt);
+            if (userId == -1) {
+                continue;  // Account deleted since
+            }
+            for (const Shown& row : shown) {
+                sqlite3_bind_int64(insert, 1, userId);
+                sqlite3_bind_int64(insert, 2, row.postId);
+                sqlite3_bind_int64(insert, 3, row.shownAt);
+                ok = ok && sqlite3_step(insert) == SQLITE_DONE;
+                sqlite3_reset(insert);
+                rows++;
+            }
+        }
+        ok = ok && sqlite3_exec(writer, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    if (!ok) {
+        std::cerr << "Feed flush failed: " << sqlite3_errmsg(writer) << std::endl;
+        sqlite3_exec(writer, "ROLLBACK", nullptr, nullptr, nullptr);
+    }
+    sqlite3_finalize(userStmt);
+    sqlite3_finalize(insert);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ok) {
+        rowsWritten += rows;
+        flushes++;
+    } else {
+        // Keep the rows for the next flush
+        for (auto& [username, shown] : inFlight) {
+            auto& buffered = pending[username];
+            buffered.insert(buffered.end(), shown.begin(), shown.end());
+            pendingRows += shown.size();
+        }
+    }
+    inFlight.clear();
+}
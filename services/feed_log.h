@@ -0,0 +1,92 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Records which posts each user's timeline has served, in the feed table, so the server
+// knows what a user has seen: how many posts are new since their last visit, and which
+// candidates the ranked mode should skip.
+//
+// Serving a page only appends to an in-memory buffer; a flusher writes the buffer in one
+// transaction every kFlushIntervalSeconds, or sooner once kMaxPending rows are waiting, on
+// a connection of its own. (user_id, post_id) is unique in the table, so a post shown
+// twice keeps the time it was first shown. Reads consult the buffer as well as the table,
+// so a post counts as seen from the moment it is served. If start() can't write to the
+// database, nothing is buffered and only the newest post each user was shown is kept.
+class FeedLog {
+public:
+    static constexpr int kMaxUnread = 100;
+
+    struct Stats {
+        uint64_t recorded;     // Post ids handed to recordShown
+        uint64_t rowsWritten;  // Rows sent to the table (repeats are ignored there)
+        uint64_t flushes;
+        size_t pending;
+    };
+
+    static FeedLog& instance();
+
+    // Starts the flusher; writes go to db's file
+    void start(sqlite3* db);
+    // Stops the flusher after a final flush
+    void stop();
+
+    // username's timeline just served postIds
+    void recordShown(const std::string& username, const std::vector<int64_t>& postIds);
+
+    // The ids among postIds that username has been shown
+    std::unordered_set<int64_t> seenAmong(sqlite3* db, const std::string& username, const std::vector<int64_t>& postIds);
+
+    // Newest post username has been shown, 0 if none
+    int64_t lastSeenId(sqlite3* db, const std::string& username);
+
+    // Posts by username's friends newer than anything they've been shown, up to kMaxUnread.
+    // A user who has never been shown a post has nothing unread.
+    int unreadCount(sqlite3* db, const std::string& username);
+
+    Stats stats() const;
+
+private:
+    static constexpr int kFlushIntervalSeconds = 5;
+    static constexpr size_t kMaxPending = 20000;
+
+    struct Shown {
+        int64_t postId;
+        int64_t shownAt;  // Epoch millis
+    };
+
+    struct LastSeen {
+        int64_t postId = 0;   // Newest post served since start, or ever once loaded
+        bool loaded = false;  // Combined with what the table held at start
+    };
+
+    FeedLog();
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::vector<Shown>> pending;   // Not yet written
+    std::unordered_map<std::string, std::vector<Shown>> inFlight;  // Being written by flush()
+    size_t pendingRows;
+    bool persistent;  // Until start() finds it can't write
+    std::unordered_map<std::string, LastSeen> lastSeen;
+    uint64_t recorded;
+    uint64_t rowsWritten;
+    uint64_t flushes;
+
+    std::mutex flushMutex;  // Serializes flushes; guards writer
+    sqlite3* writer;
+
+    std::condition_variable wake;
+    std::thread flusher;
+    bool running;
+
+    void disablePersistenceLocked();
+    void flushLoop();
+    void flush();
+};
@@ -0,0 +1,343 @@
+#include "friend_graph.h"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+FriendGraph& FriendGraph::instance() {
+    static FriendGraph graph;
+    return graph;
+}
+
+FriendGraph::FriendGraph() : isLoaded(false), offsets(1, 0), addedFriendships(0), friendships(0), compactions(0) {}
+
+void FriendGraph::load(sqlite3* db) {
+    std::unordered_map<std::string, uint32_t> byName;
+    std::unordered_map<int64_t, uint32_t> byId;
+    std::vector<int64_t> ids;
+    std::vector<Atom> usernames;
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id, username FROM users", -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing friend graph users: " << sqlite3_errmsg(db) << std::endl;
+        return;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        if (name == nullptr) {
+            continue;
+        }
+        uint32_t index = (uint32_t)ids.size();
+        ids.push_back(sqlite3_column_int64(stmt, 0));
+        usernames.emplace_back(name);
+        byName.emplace(name, index);
+        byId.emplace(ids.back(), index);
+    }
+    sqlite3_finalize(stmt);
+
+    const char* edgeSql = "SELECT requester_id, addressee_id FROM friends WHERE status = 'accepted'";
+    if (sqlite3_prepare_v2(db, edgeSql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing friend graph edges: " << sqlite3_errmsg(db) << std::endl;
+        return;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto a = byId.find(sqlite3_column_int64(stmt, 0));
+        auto b = byId.find(sqlite3_column_int64(stmt, 1));
+        if (a != byId.end() && b != byId.end() && a->second != b->second) {
+            edges.emplace_back(a->second, b->second);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    indexByName = std::move(byName);
+    userIds = std::move(ids);
+    names = std::move(usernames);
+    build(edges);
+    isLoaded = true;
+}
+
+bool FriendGraph::loaded() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return isLoaded;
+}
+
+void FriendGraph::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    isLoaded = false;
+    indexByName.clear();
+    userIds.clear();
+    names.clear();
+    build({});
+}
+
+void FriendGraph::addFriendship(sqlite3* db, const std::string& a, const std::string& b) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (!isLoaded) {
+        return;
+    }
+    uint32_t x = indexOrAddLocked(db, a);
+    uint32_t y = indexOrAddLocked(db, b);
+    if (x == kNone || y == kNone || x == y || connected(x, y)) {
+        return;
+    }
+    // A friendship the CSR still holds only needs its removal forgotten
+    if (removed.erase(edgeKey(x, y)) == 0) {
+        added[x].push_back(y);
+        added[y].push_back(x);
+        addedFriendships++;
+    }
+    friendSets[x].add(y);
+    friendSets[y].add(x);
+    friendships++;
+    compactIfNeeded();
+    notify(lock, a, b);
+}
+
+void FriendGraph::removeFriendship(const std::string& a, const std::string& b) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    uint32_t x = indexOf(a);
+    uint32_t y = indexOf(b);
+    if (x == kNone || y == kNone || !connected(x, y)) {
+        return;
+    }
+    auto dropAdded = [this](uint32_t from, uint32_t to) {
+        auto it = added.find(from);
+        if (it == added.end()) {
+            return false;
+        }
+        auto pos = std::find(it->second.begin(), it->second.end(), to);
+        if (pos == it->second.end()) {
+            return false;
+        }
+        it->second.erase(pos);
+        if (it->second.empty()) {
+            added.erase(it);
+        }
+        return true;
+    };
+    if (dropAdded(x, y)) {
+        dropAdded(y, x);
+        addedFriendships--;
+    } else {
+        removed.insert(edgeKey(x, y));
+    }
+    friendSets[x].remove(y);
+    friendSets[y].remove(x);
+    friendships--;
+    compactIfNeeded();
+    notify(lock, a, b);
+}
+
+void FriendGraph::addChangeListener(std::function<void(const std::string&, const std::string&)> listener) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    listeners.push_back(std::move(listener));
+}
+
+bool FriendGraph::areFriends(const std::string& a, const std::string& b) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t x = indexOf(a);
+    uint32_t y = indexOf(b);
+    return x != kNone && y != kNone && connected(x, y);
+}
+
+std::vector<std::string> FriendGraph::friendsOf(const std::string& username) const {
+    std::vector<std::string> friends;
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t index = indexOf(username);
+    if (index != kNone) {
+        forEachFriend(index, [this, &friends](uint32_t other) { friends.push_back(names[other].str()); });
+    }
+    return friends;
+}
+
+std::vector<int64_t> FriendGraph::friendIdsOf(const std::string& username) const {
+    std::vector<int64_t> ids;
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t index = indexOf(username);
+    if (index != kNone) {
+        forEachFriend(index, [this, &ids](uint32_t other) { ids.push_back(userIds[other]); });
+    }
+    return ids;
+}
+
+std::vector<std::string> FriendGraph::mutualFriends(const std::string& a, const std::string& b) const {
+    std::vector<std::string> mutual;
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t x = indexOf(a);
+    uint32_t y = indexOf(b);
+    if (x == kNone || y == kNone) {
+        return mutual;
+    }
+    for (uint32_t index : friendSets[x].intersection(friendSets[y])) {
+        mutual.push_back(names[index].str());
+    }
+    std::sort(mutual.begin(), mutual.end());
+    return mutual;
+}
+
+size_t FriendGraph::mutualFriendCount(const std::string& a, const std::string& b) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t x = indexOf(a);
+    uint32_t y = indexOf(b);
+    return x == kNone || y == kNone ? 0 : friendSets[x].intersectionCount(friendSets[y]);
+}
+
+std::vector<std::pair<std::string, int>> FriendGraph::mutualFriendCounts(const std::string& username) const {
+    std::vector<std::pair<std::string, int>> counted;
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t self = indexOf(username);
+    if (self == kNone) {
+        return counted;
+    }
+    std::unordered_map<uint32_t, int> counts;
+    forEachFriend(self, [this, self, &counts](uint32_t friendIndex) {
+        forEachFriend(friendIndex, [this, self, &counts](uint32_t other) {
+            if (other != self) {
+                counts[other]++;
+            }
+        });
+    });
+    counted.reserve(counts.size());
+    for (const auto& [other, mutual] : counts) {
+        if (!connected(self, other)) {
+            counted.emplace_back(names[other].str(), mutual);
+        }
+    }
+    return counted;
+}
+
+FriendGraph::Stats FriendGraph::stats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return Stats{names.size(), friendships, addedFriendships + removed.size(), compactions};
+}
+
+uint64_t FriendGraph::edgeKey(uint32_t a, uint32_t b) {
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+uint32_t FriendGraph::indexOf(const std::string& username) const {
+    auto it = indexByName.find(username);
+    return it == indexByName.end() ? kNone : it->second;
+}
+
+uint32_t FriendGraph::indexOrAddLocked(sqlite3* db, const std::string& username) {
+    uint32_t index = indexOf(username);
+    if (index != kNone) {
+        return index;
+    }
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id FROM users WHERE username = ?", -1, &stmt, nullptr) != SQLITE_OK) {
+        return kNone;
+    }
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        index = (uint32_t)names.size();
+        userIds.push_back(sqlite3_column_int64(stmt, 0));
+        names.emplace_back(username);
+        friendSets.emplace_back();
+        indexByName.emplace(username, index);
+    }
+    sqlite3_finalize(stmt);
+    return index;
+}
+
+bool FriendGraph::inCsr(uint32_t a, uint32_t b) const {
+    if (a + 1 >= offsets.size()) {
+        return false;  // Joined after the last build
+    }
+    auto begin = adjacency.begin() + offsets[a];
+    auto end = adjacency.begin() + offsets[a + 1];
+    return std::binary_search(begin, end, b);
+}
+
+bool FriendGraph::connected(uint32_t a, uint32_t b) const {
+    if (inCsr(a, b)) {
+        return removed.empty() || removed.count(edgeKey(a, b)) == 0;
+    }
+    auto it = added.find(a);
+    return it != added.end() && std::find(it->second.begin(), it->second.end(), b) != it->second.end();
+}
+
+template <typename F>
+void FriendGraph::forEachFriend(uint32_t a, F f) const {
+    if (a + 1 < offsets.size()) {
+        for (uint32_t i = offsets[a]; i < offsets[a + 1]; i++) {
+            if (removed.empty() || removed.count(edgeKey(a, adjacency[i])) == 0) {
+                f(adjacency[i]);
+            }
+        }
+    }
+    auto it = added.find(a);
+    if (it != added.end()) {
+        for (uint32_t b : it->second) {
+            f(b);
+        }
+    }
+}
+
+void FriendGraph::build(const std::vector<std::pair<uint32_t, uint32_t>>& edges) {
+    size_t n = names.size();
+    std::vector<uint32_t> degree(n + 1, 0);
+    for (const auto& [a, b] : edges) {
+        degree[a + 1]++;
+        degree[b + 1]++;
+    }
+    for (size_t i = 1; i <= n; i++) {
+        degree[i] += degree[i - 1];
+    }
+    std::vector<uint32_t> slots(edges.size() * 2);
+    std::vector<uint32_t> next(degree.begin(), degree.end() - 1);
+    for (const auto& [a, b] : edges) {
+        slots[next[a]++] = b;
+        slots[next[b]++] = a;
+    }
+
+    // Sort each slice and drop repeats (a friendship can be stored in both directions)
+    offsets.assign(n + 1, 0);
+    adjacency.clear();
+    adjacency.reserve(slots.size());
+    for (size_t i = 0; i < n; i++) {
+        auto begin = slots.begin() + degree[i];
+        auto end = slots.begin() + degree[i + 1];
+        std::sort(begin, end);
+        adjacency.insert(adjacency.end(), begin, std::unique(begin, end));
+        offsets[i + 1] = (uint32_t)adjacency.size();
+    }
+    friendSets.clear();
+    friendSets.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        friendSets.emplace_back(adjacency.data() + offsets[i], adjacency.data() + offsets[i + 1]);
+    }
+    adjacency.shrink_to_fit();
+    added.clear();
+    addedFriendships = 0;
+    removed.clear();
+    friendships = adjacency.size() / 2;
+}
+
+void FriendGraph::compactIfNeeded() {
+    size_t delta = addedFriendships + removed.size();
+    if (delta < std::max(kMinCompactDelta, friendships / 16)) {
+        return;
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    edges.reserve(friendships);
+    for (uint32_t a = 0; a < names.size(); a++) {
+        forEachFriend(a, [a, &edges](uint32_t b) {
+            if (a < b) {
+                edges.emplace_back(a, b);
+            }
+        });
+    }
+    build(edges);
+    compactions++;
+}
+
+void FriendGraph::notify(std::unique_lock<std::shared_mutex>& lock, const std::string& a, const std::string& b) {
+    std::vector<std::function<void(const std::string&, const std::string&)>> toCall = listeners;
+    lock.unlock();
+    for (const auto& listener : toCall) {
+        listener(a, b);
+    }
+}
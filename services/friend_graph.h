@@ -0,0 +1,106 @@
+#pragma once
+
+#include "../utils/id_bitmap.h"
+#include "../utils/string_intern.h"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <sqlite3.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Every accepted friendship, in memory, so friend lists and "are these two friends" don't
+// go to SQLite.
+//
+// Users get dense indices in load order. Adjacency is compressed sparse row: the friends of
+// user i are adjacency[offsets[i] .. offsets[i + 1]), sorted, so a list is one contiguous
+// slice and a membership check is a binary search in it. Changes after the build go to a
+// small delta instead (friendships added, and removed ones that the CSR still holds); once
+// the delta outgrows kMinCompactDelta or a sixteenth of the edges, the CSR is rebuilt with
+// it folded in. Users created after the load get indices on first use, with an empty slice.
+//
+// Each user's friends are also kept as an IdBitmap of indices, so mutual friends of two
+// users are a bitmap intersection rather than a walk over both lists.
+//
+// load() runs at startup; FriendSearchService::acceptFriendRequest, removeFriend and
+// removefriend keep the graph in step with the friends table. Until load() has run,
+// loaded() is false and callers read the table.
+class FriendGraph {
+public:
+    struct Stats {
+        size_t users;
+        size_t friendships;
+        size_t delta;          // Friendships added or removed since the last compaction
+        uint64_t compactions;
+    };
+
+    static FriendGraph& instance();
+
+    // Reads users and accepted friendships; replaces whatever was loaded before
+    void load(sqlite3* db);
+    bool loaded() const;
+    // Forgets everything load() read; loaded() is false again until the next load()
+    void clear();
+
+    // The friends table just gained or lost an accepted row between a and b. db resolves
+    // users the graph hasn't seen yet.
+    void addFriendship(sqlite3* db, const std::string& a, const std::string& b);
+    void removeFriendship(const std::string& a, const std::string& b);
+
+    // Called with both users after every friendship added or removed, outside the graph's
+    // lock, so state derived from friendships (e.g. stored suggestions) can follow
+    void addChangeListener(std::function<void(const std::string&, const std::string&)> listener);
+
+    bool areFriends(const std::string& a, const std::string& b) const;
+    std::vector<std::string> friendsOf(const std::string& username) const;
+    // Same friends as users.id values
+    std::vector<int64_t> friendIdsOf(const std::string& username) const;
+
+    // Friends a and b have in common, sorted by name; or just how many
+    std::vector<std::string> mutualFriends(const std::string& a, const std::string& b) const;
+    size_t mutualFriendCount(const std::string& a, const std::string& b) const;
+
+    // Everyone two hops from username who isn't already a friend, with how many friends
+    // they share with username. Cost is the size of the two-hop neighbourhood.
+    std::vector<std::pair<std::string, int>> mutualFriendCounts(const std::string& username) const;
+
+    Stats stats() const;
+
+private:
+    static constexpr size_t kMinCompactDelta = 1024;
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    FriendGraph();
+
+    mutable std::shared_mutex mutex;
+    bool isLoaded;
+    std::unordered_map<std::string, uint32_t> indexByName;
+    std::vector<int64_t> userIds;  // Index -> users.id
+    std::vector<Atom> names;       // Index -> username
+
+    std::vector<uint32_t> offsets;    // Size: users at the last build + 1
+    std::vector<uint32_t> adjacency;  // Both directions of every friendship
+    std::unordered_map<uint32_t, std::vector<uint32_t>> added;  // Both directions
+    std::unordered_set<uint64_t> removed;  // edgeKey of CSR friendships since removed
+    size_t addedFriendships;
+    std::vector<IdBitmap> friendSets;  // Index -> friends' indices, current including the delta
+    size_t friendships;
+    uint64_t compactions;
+    std::vector<std::function<void(const std::string&, const std::string&)>> listeners;
+
+    static uint64_t edgeKey(uint32_t a, uint32_t b);
+    uint32_t indexOf(const std::string& username) const;
+    uint32_t indexOrAddLocked(sqlite3* db, const std::string& username);
+    bool inCsr(uint32_t a, uint32_t b) const;
+    bool connected(uint32_t a, uint32_t b) const;
+    // Calls f(index) for every friend of a; caller holds the lock
+    template <typename F>
+    void forEachFriend(uint32_t a, F f) const;
+    void build(const std::vector<std::pair<uint32_t, uint32_t>>& edges);
+    void compactIfNeeded();
+    void notify(std::unique_lock<std::shared_mutex>& lock, const std::string& a, const std::string& b);
+};
@@ -2,108 +2,36 @@
 #include "friend_search_service.h"        // Main header file defining the FriendSearchService class and structures
 #include "../handlers/login_handler.h"    // For session management functions (get_session_from_cookie, active_sessions)
 #include "../database/db_utils.h"         // Database utility functions for SQLite operations
+#include "friend_graph.h"                 // In-memory friendships for friend lists and checks
+#include "../utils/time_utils.h"        // nowMillis() for created_at values
 #include <algorithm>                      // STL algorithms like std::remove_if, std::transform for data manipulation
 #include <iostream>                       // Input/output stream operations for debugging and logging
 #include <sstream>                        // String stream operations for string manipulation
 #include <cctype>                         // Character classification functions like ::tolower for case conversion
 
-// Binary Search Tree (BST) Implementation for efficient user search operations
-// The BST is used to store and search users by username with O(log n) average complexity
+// User search index built on the shared BalancedTree (AVL) template
+// Usernames are ordered case-insensitively, so lookups stay O(log n) regardless of insertion order
 
-// Default constructor - initializes an empty BST with root pointer set to nullptr
-UserSearchBST::UserSearchBST() : root(nullptr) {}
-
-// Destructor - ensures proper cleanup of all nodes to prevent memory leaks
-UserSearchBST::~UserSearchBST() {
-    clear();  // Call clear() to recursively delete all nodes in the tree
+// Comparator for the search index - compares usernames character by character ignoring case
+// This ensures "Alice" and "alice" are treated as equivalent for ordering
+bool CaseInsensitiveLess::operator()(std::string_view a, std::string_view b) const {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+        [](unsigned char x, unsigned char y) {
+            return std::tolower(x) < std::tolower(y);  // Compare lowercase forms of each character
+        });
 }
 
-// Recursive helper function to insert a new user node into the BST
-// Parameters: node (current node in recursion), user (SearchUser object to insert)
-// Returns: shared_ptr to the node (for tree reconstruction during recursion)
-std::shared_ptr<BSTNode> UserSearchBST::insertNode(std::shared_ptr<BSTNode> node, const SearchUser& user) {
-    // Base case: if current node is null, create and return new node
-    if (!node) {
-        return std::make_shared<BSTNode>(user);  // Create new BSTNode with SearchUser data
-    }
-    
-    // Extract usernames for comparison - prepare for case-insensitive comparison
-    std::string nodeUsername = node->user.username;    // Username from current node
-    std::string insertUsername = user.username;        // Username from user to insert
-    
-    // Convert both usernames to lowercase for case-insensitive comparison
-    // This ensures "Alice" and "alice" are treated as equivalent for ordering
-    std::transform(nodeUsername.begin(), nodeUsername.end(), nodeUsername.begin(), ::tolower);
-    std::transform(insertUsername.begin(), insertUsername.end(), insertUsername.begin(), ::tolower);
-    
-    // BST insertion logic: compare usernames to determine left or right subtree placement
-    if (insertUsername < nodeUsername) {
-        // Insert username is lexicographically smaller - go to left subtree
-        node->left = insertNode(node->left, user);
-    } else if (insertUsername > nodeUsername) {
-        // Insert username is lexicographically larger - go to right subtree
-        node->right = insertNode(node->right, user);
-    }
-    // If usernames are equal (insertUsername == nodeUsername), don't insert duplicate
-    // The function implicitly handles duplicates by doing nothing in this case
-    
-    // Return the current node (unchanged) to maintain tree structure during recursion
-    return node;
-}
+// Default constructor - initializes an empty search index
+UserSearchBST::UserSearchBST() {}
 
-// Public interface method to insert a user into the BST
+// Public interface method to insert a user into the index
 // Parameter: user (SearchUser object containing user data to be inserted)
-// This method provides a clean interface by calling the recursive insertNode helper
+// Usernames that are equal ignoring case are not inserted twice (first one wins)
 void UserSearchBST::insert(const SearchUser& user) {
-    root = insertNode(root, user);  // Update root with result of recursive insertion
-}
-
-// Recursive inorder traversal function to retrieve all users in alphabetical order
-// Parameters: node (current node in traversal), result (vector to store users in sorted order)
-// Inorder traversal (Left -> Root -> Right) produces alphabetically sorted usernames
-void UserSearchBST::inorderTraversal(std::shared_ptr<BSTNode> node, std::vector<SearchUser>& result) {
-    if (!node) return;  // Base case: null node means end of this branch
-    
-    // Recursive inorder traversal pattern:
-    inorderTraversal(node->left, result);   // 1. Process left subtree first (smaller usernames)
-    result.push_back(node->user);           // 2. Process current node (add to result)
-    inorderTraversal(node->right, result);  // 3. Process right subtree last (larger usernames)
+    tree.insert(user.username.view(), user);  // Keyed by username, RejectDuplicates policy drops duplicates
 }
 
-// Recursive function to search for users whose usernames start with a given prefix
-// Parameters: node (current node), prefix (search prefix), result (vector to store matching users)
-// This implements a prefix search algorithm optimized for BST structure
-void UserSearchBST::prefixSearch(std::shared_ptr<BSTNode> node, const std::string& prefix, 
-                                std::vector<SearchUser>& result) {
-    if (!node) return;  // Base case: null node means end of this branch
-    
-    // Prepare strings for case-insensitive comparison
-    std::string nodeUsername = node->user.username;  // Username from current node
-    std::string searchPrefix = prefix;               // Search prefix from parameter
-    
-    // Convert both strings to lowercase for case-insensitive prefix matching
-    // This allows "al" to match "Alice", "ALICE", "alice", etc.
-    std::transform(nodeUsername.begin(), nodeUsername.end(), nodeUsername.begin(), ::tolower);
-    std::transform(searchPrefix.begin(), searchPrefix.end(), searchPrefix.begin(), ::tolower);
-    
-    // Check if current node's username starts with the search prefix
-    // substr(0, searchPrefix.length()) extracts the first N characters where N = prefix length
-    if (nodeUsername.substr(0, searchPrefix.length()) == searchPrefix) {
-        result.push_back(node->user);  // Add matching user to results
-    }
-    
-    // Recursively search both subtrees because prefix matches can exist in both directions
-    // Unlike exact search, prefix search requires checking both sides of the tree
-    // since "al" could match "alice" (left) and "alex" (right) relative to "bob"
-    if (searchPrefix <= nodeUsername) {
-        prefixSearch(node->left, prefix, result);   // Search left subtree for smaller usernames
-    }
-    if (searchPrefix >= nodeUsername.substr(0, searchPrefix.length())) {
-        prefixSearch(node->right, prefix, result);  // Search right subtree for larger usernames
-    }
-}
-
-// Public method to search for users by username prefix
+// Public method to search for users whose usernames start with a given prefix
 // Parameter: prefix (string that usernames should start with)
 // Returns: vector of SearchUser objects whose usernames begin with the prefix
 std::vector<SearchUser> UserSearchBST::searchByPrefix(const std::string& prefix) {
@@ -113,44 +41,50 @@ std::vector<SearchUser> UserSearchBST::searchByPrefix(const std::string& prefix)
         // This is useful for "browse all users" functionality
         return getAllUsers();
     }
-    // Call recursive prefix search starting from root node
-    prefixSearch(root, prefix, result);
+
+    // Convert the prefix to lowercase once for case-insensitive prefix matching
+    // This allows "al" to match "Alice", "ALICE", "alice", etc.
+    std::string searchPrefix = prefix;
+    std::transform(searchPrefix.begin(), searchPrefix.end(), searchPrefix.begin(), ::tolower);
+
+    // All usernames starting with the prefix form one contiguous run in sorted order,
+    // so start at the first username >= prefix and stop at the first one that doesn't match
+    for (auto it = tree.lowerBound(prefix); it != tree.end(); ++it) {
+        std::string_view username = it->key;
+        if (username.size() < searchPrefix.size()) break;  // Too short to start with the prefix
+        bool matches = std::equal(searchPrefix.begin(), searchPrefix.end(), username.begin(),
+            [](char p, char c) { return p == std::tolower(static_cast<unsigned char>(c)); });
+        if (!matches) break;  // Left the matching run - nothing further can match
+        result.push_back(it->value);  // Add matching user to results
+    }
     return result;  // Return vector containing all matching users
 }
 
-// Public method to retrieve all users stored in the BST in alphabetical order
+// Public method to retrieve all users stored in the index in alphabetical order
 // Returns: vector of all SearchUser objects sorted by username (case-insensitive)
 std::vector<SearchUser> UserSearchBST::getAllUsers() {
     std::vector<SearchUser> result;  // Initialize empty result vector
-    // Perform inorder traversal starting from root to get all users in sorted order
-    inorderTraversal(root, result);
+    result.reserve(tree.size());     // Exact size is known up front
+    // Iterative in-order walk produces users in sorted order
+    for (auto it = tree.begin(); it != tree.end(); ++it) {
+        result.push_back(it->value);
+    }
     return result;  // Return alphabetically sorted list of all users
 }
 
-// Recursive helper function to delete all nodes in the BST (post-order traversal)
-// Parameter: node (current node to delete)
-// Uses post-order traversal (Left -> Right -> Root) to safely delete all child nodes before parent
-void UserSearchBST::clearTree(std::shared_ptr<BSTNode> node) {
-    if (!node) return;  // Base case: null node means nothing to delete
-    clearTree(node->left);   // Recursively delete left subtree first
-    clearTree(node->right);  // Recursively delete right subtree second
-    // Node automatically deleted when shared_ptr goes out of scope (RAII)
-}
-
-// Public method to clear all nodes from the BST and reset to empty state
+// Public method to clear all nodes from the index and reset to empty state
 void UserSearchBST::clear() {
-    clearTree(root);     // Delete all nodes starting from root
-    root = nullptr;      // Reset root pointer to null (empty tree state)
+    tree.clear();
 }
 
-// Public method to rebuild the entire BST with a new set of users
+// Public method to rebuild the entire index with a new set of users
 // Parameter: users (vector of SearchUser objects to populate the tree)
 // This is useful for refreshing the search index when user data changes
 void UserSearchBST::rebuild(const std::vector<SearchUser>& users) {
     clear();  // First, remove all existing nodes from the tree
-    // Insert each user from the vector into the empty BST
+    // Insert each user from the vector into the empty index
     for (const auto& user : users) {
-        insert(user);  // Add user to BST using standard insertion method
+        insert(user);  // Add user using standard insertion method
     }
 }
 
@@ -174,89 +108,26 @@ SearchUser FriendSearchService::createUserFromRow(sqlite3_stmt* stmt) {
     
     // Extract username from column 1, handle potential NULL values
     const char* username = (char*)sqlite3_column_text(stmt, 1);
-    user.username = username ? username : "";  // Use empty string if NULL
+    user.username = Atom(username ? username : "");  // Interned; empty string if NULL
     
     // Set email to empty string since it doesn't exist in database
-    user.email = "";
+    user.email = SharedText();
     
     // Extract profile picture URL from column 2, handle potential NULL values
     const char* profile_pic = (char*)sqlite3_column_text(stmt, 2);
-    user.profile_pic = profile_pic ? profile_pic : "";  // Use empty string if NULL
+    user.profile_pic = SharedText(profile_pic ? profile_pic : "");  // Use empty string if NULL
     
     // Extract user bio from column 3, handle potential NULL values
     const char* bio = (char*)sqlite3_column_text(stmt, 3);
-    user.bio = bio ? bio : "";  // Use empty string if NULL
+    user.bio = SharedText(bio ? bio : "");  // Use empty string if NULL
     
     // Extract account creation timestamp from column 4, handle potential NULL values
     const char* created_at = (char*)sqlite3_column_text(stmt, 4);
-    user.created_at = created_at ? created_at : "";  // Use empty string if NULL
+    user.created_at = SharedText(created_at ? created_at : "");  // Use empty string if NULL
     
     return user;  // Return fully populated SearchUser object
 }
 
-// Method to determine and set friendship status between current user and target user
-// Parameters: user (SearchUser object to update), currentUsername (logged-in user's username)
-// This method queries the database to check if users are friends or have pending requests
-void FriendSearchService::setFriendshipStatus(SearchUser& user, const std::string& currentUsername) {
-    // SQL query to check if two users are friends (bidirectional friendship)
-    // Uses JOIN to connect friends table with users table to match usernames
-    // Checks both directions: (current->target) OR (target->current) with 'accepted' status
-    const char* friendQuery = R"(
-        SELECT COUNT(*) FROM friends f
-        JOIN users u1 ON f.requester_id = u1.id
-        JOIN users u2 ON f.addressee_id = u2.id
-        WHERE f.status = 'accepted' AND (
-            (u1.username = ? AND u2.username = ?) OR
-            (u1.username = ? AND u2.username = ?)
-        )
-    )";
-    
-    sqlite3_stmt* stmt;  // Prepared statement pointer
-    // Prepare the friendship check query
-    if (sqlite3_prepare_v2(db, friendQuery, -1, &stmt, NULL) == SQLITE_OK) {
-        // Bind parameters: check both directions of friendship
-        sqlite3_bind_text(stmt, 1, currentUsername.c_str(), -1, SQLITE_STATIC);  // u1.username = currentUsername
-        sqlite3_bind_text(stmt, 2, user.username.c_str(), -1, SQLITE_STATIC);   // u2.username = user.username
-        sqlite3_bind_text(stmt, 3, user.username.c_str(), -1, SQLITE_STATIC);   // u1.username = user.username
-        sqlite3_bind_text(stmt, 4, currentUsername.c_str(), -1, SQLITE_STATIC); // u2.username = currentUsername
-        
-        // Execute query and check result
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            // If COUNT(*) > 0, users are friends; otherwise they are not
-            user.is_friend = sqlite3_column_int(stmt, 0) > 0;
-        }
-        sqlite3_finalize(stmt);  // Clean up prepared statement
-    }
-    
-    // SQL query to check for pending friend requests between users
-    // Similar structure but checks for 'pending' status instead of 'accepted'
-    const char* pendingQuery = R"(
-        SELECT COUNT(*) FROM friends f
-        JOIN users u1 ON f.requester_id = u1.id
-        JOIN users u2 ON f.addressee_id = u2.id
-        WHERE f.status = 'pending' AND (
-            (u1.username = ? AND u2.username = ?) OR
-            (u1.username = ? AND u2.username = ?)
-        )
-    )";
-    
-    // Prepare the pending request check query
-    if (sqlite3_prepare_v2(db, pendingQuery, -1, &stmt, NULL) == SQLITE_OK) {
-        // Bind parameters: check both directions of pending requests
-        sqlite3_bind_text(stmt, 1, currentUsername.c_str(), -1, SQLITE_STATIC);  // current sent request to user
-        sqlite3_bind_text(stmt, 2, user.username.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, user.username.c_str(), -1, SQLITE_STATIC);   // user sent request to current
-        sqlite3_bind_text(stmt, 4, currentUsername.c_str(), -1, SQLITE_STATIC);
-        
-        // Execute query and check result
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            // If COUNT(*) > 0, there is a pending request between users
-            user.has_pending_request = sqlite3_column_int(stmt, 0) > 0;
-        }
-        sqlite3_finalize(stmt);  // Clean up prepared statement
-    }
-}
-
 // Public method to search for users by username prefix using the BST index
 // Parameters: prefix (string to search for), currentUsername (logged-in user), limit (max results)
 // Returns: vector of SearchUser objects matching the prefix with friendship status information
@@ -270,21 +141,18 @@ std::vector<SearchUser> FriendSearchService::searchUsersByPrefix(const std::stri
     // This prevents users from finding themselves in search results
     results.erase(std::remove_if(results.begin(), results.end(),
         [&currentUsername](const SearchUser& user) {
-            return user.username == currentUsername;  // Lambda function to identify current user
+            return user.username.view() == currentUsername;  // Lambda function to identify current user
         }), results.end());
     
-    // Set friendship status for each user in the results
-    // This adds is_friend and has_pending_request information to each SearchUser
-    for (auto& user : results) {
-        setFriendshipStatus(user, currentUsername);
-    }
-    
     // Limit the number of results to prevent overwhelming the UI
     // Only resize if we have more results than the requested limit
     if (results.size() > static_cast<size_t>(limit)) {
         results.resize(limit);  // Truncate to requested limit
     }
     
+    // Add is_friend and has_pending_request to the users actually returned
+    resolveRelationships(db, currentUsername, results);
+    
     return results;  // Return processed and limited search results
 }
 
@@ -314,12 +182,11 @@ std::vector<SearchUser> FriendSearchService::searchUsersByEmail(const std::strin
         
         // Execute query and process all matching rows
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            SearchUser user = createUserFromRow(stmt);          // Create SearchUser from row data
-            setFriendshipStatus(user, currentUsername);         // Add friendship status information
-            results.push_back(user);                            // Add to results vector
+            results.push_back(createUserFromRow(stmt));         // Create SearchUser from row data
         }
         sqlite3_finalize(stmt);  // Clean up prepared statement
     }
+    resolveRelationships(db, currentUsername, results);             // Add friendship status information
     
     return results;  // Return all matching users with friendship status
 }
@@ -335,21 +202,18 @@ std::vector<SearchUser> FriendSearchService::getAllUsers(const std::string& curr
     // This prevents the user from seeing themselves in the "all users" list
     results.erase(std::remove_if(results.begin(), results.end(),
         [&currentUsername](const SearchUser& user) {
-            return user.username == currentUsername;  // Filter out current user
+            return user.username.view() == currentUsername;  // Filter out current user
         }), results.end());
     
-    // Set friendship status for each user in the complete list
-    // This is computationally expensive for large user bases but provides complete information
-    for (auto& user : results) {
-        setFriendshipStatus(user, currentUsername);
-    }
-    
     // Apply limit to prevent overwhelming the client with too many results
     // Useful for pagination or initial page loads
     if (results.size() > static_cast<size_t>(limit)) {
         results.resize(limit);  // Truncate to requested limit
     }
     
+    // Friendship status for the page being returned, not the whole user base
+    resolveRelationships(db, currentUsername, results);
+    
     return results;  // Return limited list of all users with friendship status
 }
 
@@ -359,6 +223,43 @@ std::vector<SearchUser> FriendSearchService::getAllUsers(const std::string& curr
 std::vector<SearchUser> FriendSearchService::getFriends(const std::string& username) {
     std::vector<SearchUser> friends;  // Initialize empty friends vector
     
+    // With the friendship graph loaded, only the friends' own rows are read, by primary key,
+    // kMaxIdBatch ids per query
+    FriendGraph& graph = FriendGraph::instance();
+    if (graph.loaded()) {
+        std::vector<int64_t> ids = graph.friendIdsOf(username);
+        friends.reserve(ids.size());
+        for (size_t start = 0; start < ids.size(); start += kMaxIdBatch) {
+            size_t count = std::min(kMaxIdBatch, ids.size() - start);
+            std::ostringstream oss;
+            oss << "SELECT id, username, profile_pic, bio, created_at FROM users WHERE id IN (";
+            for (size_t i = 0; i < count; i++) {
+                oss << (i ? ",?" : "?");
+            }
+            oss << ")";
+
+            sqlite3_stmt* stmt;  // Prepared statement pointer
+            if (sqlite3_prepare_v2(db, oss.str().c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+                std::cerr << "Error preparing friends query: " << sqlite3_errmsg(db) << std::endl;
+                break;
+            }
+            for (size_t i = 0; i < count; i++) {
+                sqlite3_bind_int64(stmt, (int)i + 1, ids[start + i]);
+            }
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                SearchUser user = createUserFromRow(stmt);  // Same columns as the join below
+                user.is_friend = true;
+                friends.push_back(user);
+            }
+            sqlite3_finalize(stmt);
+        }
+        // Same order the query below returns
+        std::sort(friends.begin(), friends.end(), [](const SearchUser& a, const SearchUser& b) {
+            return a.username.view() < b.username.view();
+        });
+        return friends;
+    }
+    
     // Complex SQL query to find all accepted friendships for a user
     // Uses multiple JOINs to connect friends table with users table
     // Handles bidirectional friendship: user can be either requester or addressee
@@ -500,11 +401,12 @@ bool FriendSearchService::sendFriendRequest(const std::string& requester, const
     // Insert new friend request with 'pending' status
     // Uses subqueries to convert usernames to user IDs for foreign key relationships
     const char* insertSql = R"(
-        INSERT INTO friends (requester_id, addressee_id, status)
+        INSERT INTO friends (requester_id, addressee_id, status, created_at)
         VALUES (
             (SELECT id FROM users WHERE username = ?),
             (SELECT id FROM users WHERE username = ?),
-            'pending'
+            'pending',
+            ?
         )
     )";
     
@@ -512,6 +414,7 @@ bool FriendSearchService::sendFriendRequest(const std::string& requester, const
     if (sqlite3_prepare_v2(db, insertSql, -1, &stmt, NULL) == SQLITE_OK) {
         sqlite3_bind_text(stmt, 1, requester.c_str(), -1, SQLITE_STATIC);  // Requester username
         sqlite3_bind_text(stmt, 2, addressee.c_str(), -1, SQLITE_STATIC);  // Addressee username
+        sqlite3_bind_int64(stmt, 3, time_utils::nowMillis());              // created_at in epoch ms
         
         // Execute insertion and check if successful
         bool success = sqlite3_step(stmt) == SQLITE_DONE;
@@ -545,6 +448,9 @@ bool FriendSearchService::acceptFriendRequest(const std::string& requester, cons
         // SQLITE_DONE indicates successful execution (may or may not have updated rows)
         bool success = sqlite3_step(stmt) == SQLITE_DONE;
         sqlite3_finalize(stmt);  // Clean up statement
+        if (success && sqlite3_changes(db) > 0) {
+            FriendGraph::instance().addFriendship(db, requester, addressee);  // Keep the in-memory graph in step
+        }
         return success;          // Return true if query executed successfully
     }
     
@@ -608,6 +514,9 @@ bool FriendSearchService::removeFriend(const std::string& user1, const std::stri
         // Execute deletion and check if successful
         bool success = sqlite3_step(stmt) == SQLITE_DONE;
         sqlite3_finalize(stmt);  // Clean up statement
+        if (success && sqlite3_changes(db) > 0) {
+            FriendGraph::instance().removeFriendship(user1, user2);  // Keep the in-memory graph in step
+        }
         return success;          // Return true if deletion executed successfully
     }
     
@@ -646,11 +555,11 @@ crow::json::wvalue FriendSearchService::userToJson(const SearchUser& user) {
     
     // Convert all SearchUser fields to JSON key-value pairs
     json["id"] = user.id;                                    // User ID (integer)
-    json["username"] = user.username;                        // Username (string)
-    json["email"] = user.email;                              // Email address (string)
-    json["profile_pic"] = user.profile_pic;                  // Profile picture URL (string)
-    json["bio"] = user.bio;                                  // User biography (string)
-    json["created_at"] = user.created_at;                    // Account creation timestamp (string)
+    json["username"] = user.username.str();                  // Username (string)
+    json["email"] = user.email.str();                        // Email address (string)
+    json["profile_pic"] = user.profile_pic.str();            // Profile picture URL (string)
+    json["bio"] = user.bio.str();                            // User biography (string)
+    json["created_at"] = user.created_at.str();              // Account creation timestamp (string)
     json["is_friend"] = user.is_friend;                      // Friendship status (boolean)
     json["has_pending_request"] = user.has_pending_request;  // Pending request status (boolean)
     
@@ -1,54 +1,26 @@
 #pragma once
 #include <sqlite3.h>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <crow.h>
+#include "BalancedTree.h"
+#include "search_user.h"
 
-// User data structure for search results
-struct SearchUser {
-    int id;
-    std::string username;
-    std::string email;
-    std::string profile_pic;
-    std::string bio;
-    std::string created_at;
-    bool is_friend;
-    bool has_pending_request;
-    
-    SearchUser() : id(0), is_friend(false), has_pending_request(false) {}
-    
-    SearchUser(int _id, const std::string& _username, const std::string& _email,
-               const std::string& _profile_pic, const std::string& _bio, 
-               const std::string& _created_at)
-        : id(_id), username(_username), email(_email), profile_pic(_profile_pic),
-          bio(_bio), created_at(_created_at), is_friend(false), has_pending_request(false) {}
-};
-
-// BST Node for efficient prefix searching
-struct BSTNode {
-    SearchUser user;
-    std::shared_ptr<BSTNode> left;
-    std::shared_ptr<BSTNode> right;
-    
-    BSTNode(const SearchUser& _user) : user(_user), left(nullptr), right(nullptr) {}
+// Case-insensitive username ordering used by the search index
+struct CaseInsensitiveLess {
+    bool operator()(std::string_view a, std::string_view b) const;
 };
 
-// Binary Search Tree for user search
+// Balanced search tree for user search, keyed by username (case-insensitive)
 class UserSearchBST {
 private:
-    std::shared_ptr<BSTNode> root;
-    
-    // Helper functions
-    std::shared_ptr<BSTNode> insertNode(std::shared_ptr<BSTNode> node, const SearchUser& user);
-    void inorderTraversal(std::shared_ptr<BSTNode> node, std::vector<SearchUser>& result);
-    void prefixSearch(std::shared_ptr<BSTNode> node, const std::string& prefix, 
-                     std::vector<SearchUser>& result);
-    void clearTree(std::shared_ptr<BSTNode> node);
+    // Keys view the interned username held by each SearchUser, so names aren't stored twice
+    BalancedTree<std::string_view, SearchUser, CaseInsensitiveLess, NodePoolAllocator<SearchUser>> tree;
     
 public:
     UserSearchBST();
-    ~UserSearchBST();
     
     // Main operations
     void insert(const SearchUser& user);
@@ -61,12 +33,14 @@ public:
 // Friend Search Service
 class FriendSearchService {
 private:
+    // Ids bound per IN (...) query, well under SQLite's bound-parameter limit
+    static constexpr size_t kMaxIdBatch = 500;
+
     sqlite3* db;
     UserSearchBST searchTree;
     
     // Helper functions
     SearchUser createUserFromRow(sqlite3_stmt* stmt);
-    void setFriendshipStatus(SearchUser& user, const std::string& currentUsername);
     
 public:
     FriendSearchService(sqlite3* database);
@@ -1,22 +1,27 @@
 #include "friend_suggestion_service.h"
-#include "../database/db_utils.h"   // for getFriendsList, getAllUsersExcept, areFriends
-#include <nlohmann/json.hpp>
+#include "../database/db_utils.h"   // for getFriendNames, getAllUsersExcept, areFriends
+#include "affinity_store.h"
+#include "friend_graph.h"
+#include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
+#include <queue>
 
 FriendSuggestionService::FriendSuggestionService(sqlite3* db_) : db(db_) {}
 
 AVLTree FriendSuggestionService::loadFriendsAVL(const std::string& username) {
     AVLTree tree;
-    std::string jsonList = getFriendsList(db, username);
-    nlohmann::json j = nlohmann::json::parse(jsonList);
-    for (auto& friendname : j) {
+    for (const std::string& friendname : getFriendNames(db, username)) {
         tree.insert(friendname);
     }
     return tree;
 }
 
 std::vector<std::string> FriendSuggestionService::getMutualFriends(const std::string& user1, const std::string& user2) {
+    FriendGraph& graph = FriendGraph::instance();
+    if (graph.loaded()) {
+        return graph.mutualFriends(user1, user2);
+    }
     AVLTree friends1 = loadFriendsAVL(user1);
     AVLTree friends2 = loadFriendsAVL(user2);
     std::vector<std::string> f1 = friends1.inOrder();
@@ -47,6 +52,70 @@ std::vector<std::string> FriendSuggestionService::getNonFriendUsers(
 }
 
 std::vector<std::pair<std::string, int>> FriendSuggestionService::suggestFriends(const std::string& username, int maxResults) {
+    FriendGraph& graph = FriendGraph::instance();
+    if (!graph.loaded()) {
+        return scanSuggestions(username, maxResults);
+    }
+    if (maxResults <= 0) {
+        return {};
+    }
+
+    // Everyone sharing a friend, from one walk over friends of friends
+    std::vector<std::pair<std::string, int>> counted = graph.mutualFriendCounts(username);
+
+    // Descending by mutual friends, then by how much the user interacts with the
+    // candidate's posts, then lexically by username
+    std::unordered_map<std::string, double> affinity = AffinityStore::instance().scoresOf(username);
+    auto affinityOf = [&affinity](const std::string& candidate) {
+        auto it = affinity.find(candidate);
+        return it == affinity.end() ? 0.0 : it->second;
+    };
+    auto ranksBefore = [&affinityOf](const std::pair<std::string, int>& a, const std::pair<std::string, int>& b) {
+        if (a.second != b.second) return a.second > b.second;
+        double affinityA = affinityOf(a.first), affinityB = affinityOf(b.first);
+        if (affinityA != affinityB) return affinityA > affinityB;
+        return a.first < b.first;
+    };
+
+    // Keep the best maxResults in a heap with the weakest on top
+    std::priority_queue<std::pair<std::string, int>, std::vector<std::pair<std::string, int>>, decltype(ranksBefore)>
+        best(ranksBefore);
+    for (auto& candidate : counted) {
+        if ((int)best.size() < maxResults) {
+            best.push(std::move(candidate));
+        } else if (ranksBefore(candidate, best.top())) {
+            best.pop();
+            best.push(std::move(candidate));
+        }
+    }
+    std::vector<std::pair<std::string, int>> suggestions(best.size());
+    for (size_t i = suggestions.size(); i-- > 0;) {
+        suggestions[i] = best.top();
+        best.pop();
+    }
+
+    // Too few people share a friend: fill up with other users, as the scan did
+    if ((int)suggestions.size() < maxResults) {
+        std::unordered_set<std::string> taken;
+        for (const auto& suggestion : suggestions) {
+            taken.insert(suggestion.first);
+        }
+        std::vector<std::pair<std::string, int>> others;
+        for (const auto& user : getNonFriendUsers(username, graph.friendsOf(username), maxResults + (int)taken.size())) {
+            if (taken.count(user) == 0) {
+                others.emplace_back(user, 0);
+            }
+        }
+        std::sort(others.begin(), others.end(), ranksBefore);
+        for (auto& other : others) {
+            if ((int)suggestions.size() >= maxResults) break;
+            suggestions.push_back(std::move(other));
+        }
+    }
+    return suggestions;
+}
+
+std::vector<std::pair<std::string, int>> FriendSuggestionService::scanSuggestions(const std::string& username, int maxResults) {
     // Direct friends
     AVLTree userFriendsAVL = loadFriendsAVL(username);
     std::vector<std::string> directFriends = userFriendsAVL.inOrder();
@@ -75,9 +144,17 @@ std::vector<std::pair<std::string, int>> FriendSuggestionService::suggestFriends
         suggestions.emplace_back(candidate, mutualCount);
     }
 
-    // Sort descending by mutualCount, then lexically by username
-    std::sort(suggestions.begin(), suggestions.end(), [](auto& a, auto& b) {
+    // Sort descending by mutualCount, then by how much the user interacts with the
+    // candidate's posts, then lexically by username
+    std::unordered_map<std::string, double> affinity = AffinityStore::instance().scoresOf(username);
+    auto affinityOf = [&affinity](const std::string& candidate) {
+        auto it = affinity.find(candidate);
+        return it == affinity.end() ? 0.0 : it->second;
+    };
+    std::sort(suggestions.begin(), suggestions.end(), [&affinityOf](auto& a, auto& b) {
         if (a.second != b.second) return a.second > b.second;
+        double affinityA = affinityOf(a.first), affinityB = affinityOf(b.first);
+        if (affinityA != affinityB) return affinityA > affinityB;
         return a.first < b.first;
     });
 
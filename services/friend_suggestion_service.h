@@ -18,9 +18,15 @@ public:
     std::vector<std::string> getMutualFriends(const std::string& user1, const std::string& user2);
 
     // Suggest friends for 'username' based on 2nd-degree connections (not direct friends, but friends of friends)
-    // Returns suggestion pairs: (username, #mutual_friends)
+    // Returns suggestion pairs: (username, #mutual_friends). Walks FriendGraph, so the cost
+    // follows the size of the two-hop neighbourhood; users with no mutual friends only fill
+    // up a short list.
     std::vector<std::pair<std::string, int>> suggestFriends(const std::string& username, int maxResults = 10);
 
+    // suggestFriends before the graph is loaded: counts mutual friends of the first 500 other
+    // users by name, one friend list each. Same ranking, so the two can be compared.
+    std::vector<std::pair<std::string, int>> scanSuggestions(const std::string& username, int maxResults);
+
 private:
     sqlite3* db;
 
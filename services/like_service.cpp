@@ -1,8 +1,19 @@
 #include "like_service.h"
+#include "post_store.h"
+#include "affinity_store.h"
+#include "../utils/time_utils.h"
 #include <sqlite3.h>
 #include <iostream>
 
-bool LikeService::toggleLike(sqlite3* db, int post_id, const std::string& username) {
+// Looked up before the invalidation so the store's copy of the post can answer
+static void recordAffinity(sqlite3* db, int64_t post_id, const std::string& username, double weight) {
+    std::shared_ptr<const Post> post = PostStore::instance().get(db, post_id);
+    if (post) {
+        AffinityStore::instance().record(username, std::string(post->getUserName()), weight);
+    }
+}
+
+bool LikeService::toggleLike(sqlite3* db, int64_t post_id, const std::string& username) {
     // First, get the user_id from username
     const char* get_user_sql = "SELECT id FROM users WHERE username = ?";
     sqlite3_stmt* stmt;
@@ -27,7 +38,7 @@ bool LikeService::toggleLike(sqlite3* db, int post_id, const std::string& userna
     
     if (sqlite3_prepare_v2(db, check_like_sql, -1, &stmt, nullptr) == SQLITE_OK) {
         sqlite3_bind_int(stmt, 1, user_id);
-        sqlite3_bind_int(stmt, 2, post_id);
+        sqlite3_bind_int64(stmt, 2, post_id);
         if (sqlite3_step(stmt) == SQLITE_ROW) {
             already_liked = sqlite3_column_int(stmt, 0) > 0;
         }
@@ -39,41 +50,46 @@ bool LikeService::toggleLike(sqlite3* db, int post_id, const std::string& userna
         const char* delete_like_sql = "DELETE FROM likes WHERE user_id = ? AND post_id = ?";
         if (sqlite3_prepare_v2(db, delete_like_sql, -1, &stmt, nullptr) == SQLITE_OK) {
             sqlite3_bind_int(stmt, 1, user_id);
-            sqlite3_bind_int(stmt, 2, post_id);
+            sqlite3_bind_int64(stmt, 2, post_id);
             sqlite3_step(stmt);
             sqlite3_finalize(stmt);
         }
         
         const char* decrement_sql = "UPDATE posts SET like_count = like_count - 1 WHERE id = ?";
         if (sqlite3_prepare_v2(db, decrement_sql, -1, &stmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int(stmt, 1, post_id);
+            sqlite3_bind_int64(stmt, 1, post_id);
             sqlite3_step(stmt);
             sqlite3_finalize(stmt);
         }
         
+        recordAffinity(db, post_id, username, -AffinityStore::kLikeWeight);
+        PostStore::instance().invalidate(post_id);
         return true; // Successfully unliked
     } else {
         // Like: Add like and increment count
-        const char* insert_like_sql = "INSERT INTO likes (user_id, post_id) VALUES (?, ?)";
+        const char* insert_like_sql = "INSERT INTO likes (user_id, post_id, created_at) VALUES (?, ?, ?)";
         if (sqlite3_prepare_v2(db, insert_like_sql, -1, &stmt, nullptr) == SQLITE_OK) {
             sqlite3_bind_int(stmt, 1, user_id);
-            sqlite3_bind_int(stmt, 2, post_id);
+            sqlite3_bind_int64(stmt, 2, post_id);
+            sqlite3_bind_int64(stmt, 3, time_utils::nowMillis());
             sqlite3_step(stmt);
             sqlite3_finalize(stmt);
         }
         
         const char* increment_sql = "UPDATE posts SET like_count = like_count + 1 WHERE id = ?";
         if (sqlite3_prepare_v2(db, increment_sql, -1, &stmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int(stmt, 1, post_id);
+            sqlite3_bind_int64(stmt, 1, post_id);
             sqlite3_step(stmt);
             sqlite3_finalize(stmt);
         }
         
+        recordAffinity(db, post_id, username, AffinityStore::kLikeWeight);
+        PostStore::instance().invalidate(post_id);
         return true; // Successfully liked
     }
 }
 
-bool LikeService::isPostLikedByUser(sqlite3* db, int post_id, const std::string& username) {
+bool LikeService::isPostLikedByUser(sqlite3* db, int64_t post_id, const std::string& username) {
     // Get user_id from username
     const char* get_user_sql = "SELECT id FROM users WHERE username = ?";
     sqlite3_stmt* stmt;
@@ -95,7 +111,7 @@ bool LikeService::isPostLikedByUser(sqlite3* db, int post_id, const std::string&
     
     if (sqlite3_prepare_v2(db, check_like_sql, -1, &stmt, nullptr) == SQLITE_OK) {
         sqlite3_bind_int(stmt, 1, user_id);
-        sqlite3_bind_int(stmt, 2, post_id);
+        sqlite3_bind_int64(stmt, 2, post_id);
         if (sqlite3_step(stmt) == SQLITE_ROW) {
             is_liked = sqlite3_column_int(stmt, 0) > 0;
         }
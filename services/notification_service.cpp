@@ -4,10 +4,10 @@
 #include "../handlers/login_handler.h" // for session management
 // Include iostream for console output (std::cout, std::cerr)
 #include <iostream>
-// Include sstream for string stream operations (used in timestamp formatting)
-#include <sstream>
-// Include iomanip for input/output manipulations (std::put_time for timestamp formatting)
-#include <iomanip>
+// Include the shared time formatter (used for notification timestamps)
+#include "../utils/time_utils.h"
+// Include db_utils for reading epoch-millisecond created_at columns
+#include "../database/db_utils.h"
 
 // Constructor for NotificationService class - takes a SQLite database pointer as parameter
 // Uses member initializer list to set the db member variable to the passed database pointer
@@ -29,7 +29,7 @@ bool NotificationService::initializeDatabase() {
             type TEXT NOT NULL,                      -- Type of notification (friend_request, like, comment, etc.)
             content TEXT NOT NULL,                   -- Human-readable message content
             metadata TEXT DEFAULT '{}',              -- JSON string for additional data (default empty JSON object)
-            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,  -- When the notification was created
+            created_at INTEGER DEFAULT (CAST(ROUND((julianday('now') - 2440587.5) * 86400000) AS INTEGER)),  -- Epoch ms when created
             is_read BOOLEAN DEFAULT 0,               -- Whether notification has been read (0=false, 1=true)
             FOREIGN KEY (recipient_username) REFERENCES users(username),  -- Ensure recipient exists in users table
             FOREIGN KEY (sender_username) REFERENCES users(username)      -- Ensure sender exists in users table
@@ -63,17 +63,8 @@ bool NotificationService::initializeDatabase() {
 // Helper function to get the current timestamp in "YYYY-MM-DD HH:MM:SS" format
 // Returns a string representation of the current date and time
 std::string NotificationService::getCurrentTimestamp() {
-    // Get current time as time_t (seconds since Unix epoch)
-    auto t = std::time(nullptr);
-    // Convert to local time structure (tm) containing year, month, day, hour, minute, second
-    auto tm = *std::localtime(&t);
-    // Create output string stream for formatting
-    std::ostringstream oss;
-    // Format the time using put_time manipulator with specified format string
-    // %Y = 4-digit year, %m = month, %d = day, %H = hour (24h), %M = minute, %S = second
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    // Convert string stream to string and return
-    return oss.str();
+    // Shared formatter: no localtime/put_time, and the string is rebuilt at most once per second
+    return time_utils::nowString();
 }
 
 // Function to create a new notification in the database
@@ -84,8 +75,8 @@ bool NotificationService::createNotification(const std::string& recipient, const
                                            const std::string& metadata) {
     // SQL INSERT statement using prepared statement placeholders (?) for security
     const char* sql = R"(
-        INSERT INTO notifications (recipient_username, sender_username, type, content, metadata)
-        VALUES (?, ?, ?, ?, ?);
+        INSERT INTO notifications (recipient_username, sender_username, type, content, metadata, created_at)
+        VALUES (?, ?, ?, ?, ?, ?);
     )";
     
     // Pointer to hold the prepared SQL statement
@@ -106,6 +97,7 @@ bool NotificationService::createNotification(const std::string& recipient, const
     sqlite3_bind_text(stmt, 3, type.c_str(), -1, SQLITE_STATIC);       // Bind type to third ?
     sqlite3_bind_text(stmt, 4, content.c_str(), -1, SQLITE_STATIC);    // Bind content to fourth ?
     sqlite3_bind_text(stmt, 5, metadata.c_str(), -1, SQLITE_STATIC);   // Bind metadata to fifth ?
+    sqlite3_bind_int64(stmt, 6, time_utils::nowMillis());              // Bind creation time (epoch ms) to sixth ?
     // Note: -1 means SQLite will calculate string length, SQLITE_STATIC means string won't change
     
     // Execute the prepared statement
@@ -182,7 +174,7 @@ std::vector<Notification> NotificationService::getNotificationsForUser(const std
         const char* metadata = (char*)sqlite3_column_text(stmt, 5);                      // Column 5: metadata
         notification.metadata = metadata ? metadata : "{}";                              // Use empty JSON if NULL
         
-        notification.created_at = (char*)sqlite3_column_text(stmt, 6);                   // Column 6: created_at
+        notification.created_at = time_utils::toIso8601(columnEpochSeconds(stmt, 6), ' '); // Column 6: created_at (epoch ms)
         notification.is_read = sqlite3_column_int(stmt, 7) == 1;                         // Column 7: is_read (convert int to bool)
         
         // Add the completed notification object to results vector
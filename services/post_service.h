@@ -10,7 +10,7 @@ class PostService {
 public: 
 
     // Retrieve a post by its ID
-    static Post* getPostById(int post_id);
+    static Post* getPostById(int64_t post_id);
 
     // Get all posts by a user
     std::vector<Post> getPostsByUser(sqlite3* db, const std::string& username);
@@ -19,8 +19,8 @@ public:
     static std::vector<Post> getAllPosts();
 
     // Update a post's content, image, or privacy
-    static bool updatePost(int post_id, const std::string& new_content,
+    static bool updatePost(int64_t post_id, const std::string& new_content,
                           const std::string& new_image_url, const std::string& new_privacy);
 
-    static int createPost(const std::string& username, const std::string& content, const std::string& image_url);
+    static int64_t createPost(const std::string& username, const std::string& content, const std::string& image_url);
 };
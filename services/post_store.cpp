@@ -0,0 +1,189 @@
+#include "post_store.h"
+#include "../database/db_utils.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+PostStore& PostStore::instance() {
+    static PostStore store;
+    return store;
+}
+
+PostStore::PostStore()
+    : capacity(kDefaultCapacity), bytes(0), hits(0), misses(0), evictions(0) {}
+
+std::shared_ptr<const Post> PostStore::get(sqlite3* db, int64_t postId) {
+    return multiGet(db, std::vector<int64_t>{postId}).front();
+}
+
+std::vector<std::shared_ptr<const Post>> PostStore::multiGet(sqlite3* db, const std::vector<int64_t>& ids) {
+    std::vector<std::shared_ptr<const Post>> result(ids.size());
+    std::vector<int64_t> missing;
+    std::list<PendingFetch>::iterator fetching;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < ids.size(); i++) {
+            auto it = entries.find(ids[i]);
+            if (it == entries.end()) {
+                missing.push_back(ids[i]);
+                continue;
+            }
+            lru.splice(lru.begin(), lru, it->second);
+            result[i] = it->second->post;
+        }
+        hits += ids.size() - missing.size();
+        misses += missing.size();
+        if (missing.empty()) {
+            return result;
+        }
+        std::sort(missing.begin(), missing.end());
+        fetching = pending.insert(pending.end(), PendingFetch{&missing, {}, false});
+    }
+
+    // The query runs unlocked so a slow read doesn't stall cache hits on other threads
+    std::vector<std::shared_ptr<const Post>> loaded = fetch(db, missing);
+    std::unordered_map<int64_t, std::shared_ptr<const Post>> byId;
+    for (const auto& post : loaded) {
+        byId[post->getId()] = post;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // A post invalidated while we were reading may be stale, so don't cache it
+        if (!fetching->cleared) {
+            for (const auto& post : loaded) {
+                if (fetching->invalidated.count(post->getId()) == 0) {
+                    insertLocked(post);
+                }
+            }
+            evictLocked();
+        }
+        pending.erase(fetching);
+    }
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (!result[i]) {
+            auto it = byId.find(ids[i]);
+            if (it != byId.end()) {
+                result[i] = it->second;
+            }
+        }
+    }
+    return result;
+}
+
+void PostStore::invalidate(int64_t postId) {
+    std::vector<InvalidationListener> notify;
+    std::string_view author;  // Interned, so it outlives the entry
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (PendingFetch& fetch : pending) {
+            if (std::binary_search(fetch.ids->begin(), fetch.ids->end(), postId)) {
+                fetch.invalidated.insert(postId);
+            }
+        }
+        notify = listeners;
+        auto it = entries.find(postId);
+        if (it != entries.end()) {
+            author = it->second->post->getUserName();
+            bytes -= it->second->bytes;
+            lru.erase(it->second);
+            entries.erase(it);
+        }
+    }
+    for (const auto& listener : notify) {
+        listener(postId, author);
+    }
+}
+
+void PostStore::addInvalidationListener(InvalidationListener listener) {
+    std::lock_guard<std::mutex> lock(mutex);
+    listeners.push_back(std::move(listener));
+}
+
+void PostStore::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (PendingFetch& fetch : pending) {
+        fetch.cleared = true;
+    }
+    lru.clear();
+    entries.clear();
+    bytes = 0;
+}
+
+void PostStore::setCapacity(size_t maxEntries) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = maxEntries;
+    evictLocked();
+}
+
+PostStore::Stats PostStore::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return Stats{hits, misses, evictions, entries.size(), bytes};
+}
+
+void PostStore::insertLocked(const std::shared_ptr<const Post>& post) {
+    auto it = entries.find(post->getId());
+    if (it != entries.end()) {
+        bytes -= it->second->bytes;
+        lru.erase(it->second);
+        entries.erase(it);
+    }
+    size_t size = footprint(*post);
+    lru.push_front(Entry{post->getId(), post, size});
+    entries[post->getId()] = lru.begin();
+    bytes += size;
+}
+
+void PostStore::evictLocked() {
+    while (entries.size() > capacity) {
+        const Entry& victim = lru.back();
+        bytes -= victim.bytes;
+        entries.erase(victim.id);
+        lru.pop_back();
+        evictions++;
+    }
+}
+
+size_t PostStore::footprint(const Post& post) {
+    // Author names are interned and shared process-wide, so only the text buffers count
+    return sizeof(Post) + sizeof(Entry) + post.getContent().size() + post.getImageUrl().size();
+}
+
+std::vector<std::shared_ptr<const Post>> PostStore::fetch(sqlite3* db, const std::vector<int64_t>& ids) {
+    std::vector<std::shared_ptr<const Post>> posts;
+    posts.reserve(ids.size());
+
+    // One query per kMaxBatch ids keeps us under SQLite's bound-parameter limit
+    for (size_t start = 0; start < ids.size(); start += kMaxBatch) {
+        size_t count = std::min(kMaxBatch, ids.size() - start);
+
+        std::ostringstream oss;
+        oss << "SELECT posts.id, users.username, posts.content, posts.created_at, posts.like_count, posts.comment_count "
+               "FROM posts JOIN users ON posts.user_id = users.id WHERE posts.id IN (";
+        for (size_t i = 0; i < count; i++) {
+            oss << (i ? ",?" : "?");
+        }
+        oss << ");";
+
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, oss.str().c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "Error preparing post store query: " << sqlite3_errmsg(db) << std::endl;
+            return posts;
+        }
+        for (size_t i = 0; i < count; i++) {
+            sqlite3_bind_int64(stmt, (int)i + 1, ids[start + i]);
+        }
+
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* user_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            const char* content = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+            posts.push_back(std::make_shared<Post>(sqlite3_column_int64(stmt, 0), user_name ? user_name : "",
+                                                   content ? content : "", "", columnEpochSeconds(stmt, 3),
+                                                   sqlite3_column_int(stmt, 4), sqlite3_column_int(stmt, 5)));
+        }
+        sqlite3_finalize(stmt);
+    }
+    return posts;
+}
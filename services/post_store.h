@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Post.h"
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sqlite3.h>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Process-wide cache of Post records keyed by id, shared by the post, search and
+// timeline paths so a hot post is read from SQLite and built once.
+//
+// Entries are evicted least recently used first. Cached posts are immutable and
+// handed out as shared_ptr, so an eviction never invalidates a post a caller holds.
+// Any write that changes a post's row must call invalidate().
+class PostStore {
+public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        size_t entries;
+        size_t bytes;     // Approximate heap footprint of the cached posts
+        double hitRate() const { return hits + misses ? (double)hits / (hits + misses) : 0.0; }
+    };
+
+    static PostStore& instance();
+
+    // Returns the post, loading it on a miss, or nullptr if no such post exists
+    std::shared_ptr<const Post> get(sqlite3* db, int64_t postId);
+
+    // Returns one entry per id, in the same order (nullptr for ids that don't exist).
+    // Every miss is fetched in a single query.
+    std::vector<std::shared_ptr<const Post>> multiGet(sqlite3* db, const std::vector<int64_t>& ids);
+
+    void invalidate(int64_t postId);
+    void clear();
+
+    // Called with the id after every invalidate(), outside the store's lock, so caches built
+    // from posts (e.g. serialized responses) can drop what they derived from it. author is the
+    // post's author if the store held the post, and empty otherwise.
+    using InvalidationListener = std::function<void(int64_t postId, std::string_view author)>;
+    void addInvalidationListener(InvalidationListener listener);
+
+    void setCapacity(size_t maxEntries);
+    Stats stats() const;
+
+private:
+    static constexpr size_t kDefaultCapacity = 10000;
+    static constexpr size_t kMaxBatch = 500;
+
+    struct Entry {
+        int64_t id;
+        std::shared_ptr<const Post> post;
+        size_t bytes;
+    };
+
+    // A multiGet reading from SQLite. Ids invalidated while it reads may come back stale,
+    // so those are the ones it doesn't cache.
+    struct PendingFetch {
+        const std::vector<int64_t>* ids;  // Sorted
+        std::unordered_set<int64_t> invalidated;
+        bool cleared;  // clear() ran: cache none of it
+    };
+
+    PostStore();
+
+    mutable std::mutex mutex;
+    std::list<Entry> lru;  // Most recently used at the front
+    std::unordered_map<int64_t, std::list<Entry>::iterator> entries;
+    size_t capacity;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    std::list<PendingFetch> pending;
+    std::vector<InvalidationListener> listeners;
+
+    void insertLocked(const std::shared_ptr<const Post>& post);
+    void evictLocked();
+    static size_t footprint(const Post& post);
+    static std::vector<std::shared_ptr<const Post>> fetch(sqlite3* db, const std::vector<int64_t>& ids);
+};
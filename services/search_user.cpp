@@ -0,0 +1,43 @@
+#include "search_user.h"
+#include "friend_graph.h"
+#include <iostream>
+#include <unordered_set>
+
+// One query reads the viewer's pending (and, without FriendGraph, accepted) rows from both
+// sides of the friends table; each user is then a set lookup instead of two join queries
+void resolveRelationships(sqlite3* db, const std::string& viewer, std::vector<SearchUser>& users) {
+    if (users.empty()) {
+        return;
+    }
+    FriendGraph& graph = FriendGraph::instance();
+    bool fromGraph = graph.loaded();
+
+    // The other user of every request or friendship involving the viewer
+    const char* sql = R"(
+        SELECT addressee_id, status FROM friends
+        WHERE requester_id = (SELECT id FROM users WHERE username = ?1) AND status IN ('pending', ?2)
+        UNION ALL
+        SELECT requester_id, status FROM friends
+        WHERE addressee_id = (SELECT id FROM users WHERE username = ?1) AND status IN ('pending', ?2)
+    )";
+    std::unordered_set<int64_t> friendIds;   // Only filled without FriendGraph
+    std::unordered_set<int64_t> pendingIds;
+    sqlite3_stmt* stmt;  // Prepared statement pointer
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, viewer.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, fromGraph ? "pending" : "accepted", -1, SQLITE_STATIC);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* status = (const char*)sqlite3_column_text(stmt, 1);
+            bool pending = status != nullptr && std::string_view(status) == "pending";
+            (pending ? pendingIds : friendIds).insert(sqlite3_column_int64(stmt, 0));
+        }
+        sqlite3_finalize(stmt);  // Clean up prepared statement
+    } else {
+        std::cerr << "Error preparing relationship query: " << sqlite3_errmsg(db) << std::endl;
+    }
+
+    for (auto& user : users) {
+        user.is_friend = fromGraph ? graph.areFriends(viewer, user.username.str()) : friendIds.count(user.id) > 0;
+        user.has_pending_request = pendingIds.count(user.id) > 0;
+    }
+}
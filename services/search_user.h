@@ -0,0 +1,34 @@
+#pragma once
+#include <sqlite3.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../utils/string_intern.h"
+
+// Users as friend search returns them, and their relationship to the viewer. Apart from
+// friend_search_service.h so that code built without Crow (the checks) can use them.
+
+// User data structure for search results
+struct SearchUser {
+    int id;
+    Atom username;           // Interned - shared with the user's posts and comments
+    SharedText email;        // Text fields are shared buffers, so copying a result is cheap
+    SharedText profile_pic;
+    SharedText bio;
+    SharedText created_at;
+    bool is_friend;
+    bool has_pending_request;
+    
+    SearchUser() : id(0), is_friend(false), has_pending_request(false) {}
+    
+    SearchUser(int _id, std::string_view _username, std::string _email,
+               std::string _profile_pic, std::string _bio, 
+               std::string _created_at)
+        : id(_id), username(_username), email(std::move(_email)), profile_pic(std::move(_profile_pic)),
+          bio(std::move(_bio)), created_at(std::move(_created_at)), is_friend(false), has_pending_request(false) {}
+};
+
+// Sets is_friend and has_pending_request on every user for viewer in one pass: friendships
+// come from FriendGraph (or, before it is loaded, the same query as the requests), and
+// pending requests from a single query over viewer's rows in friends
+void resolveRelationships(sqlite3* db, const std::string& viewer, std::vector<SearchUser>& users);
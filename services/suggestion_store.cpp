@@ -0,0 +1,315 @@
+#include "suggestion_store.h"
+#include "friend_graph.h"
+#include "friend_suggestion_service.h"
+#include "../utils/time_utils.h"
+#include <algorithm>
+#include <iostream>
+
+SuggestionStore& SuggestionStore::instance() {
+    static SuggestionStore store;
+    return store;
+}
+
+SuggestionStore::SuggestionStore()
+    : changes(0), hits(0), misses(0), refreshes(0), coalesced(0), rowsWritten(0), writer(nullptr), running(false) {
+    FriendGraph::instance().addChangeListener(
+        [this](const std::string& a, const std::string& b) { friendshipChanged(a, b); });
+}
+
+void SuggestionStore::start(sqlite3* db) {
+    // Read before taking the lock, so no caller waits on SQLite behind it
+    std::unordered_map<std::string, List> stored = load(db);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) {
+        return;
+    }
+    // Replaces what a previous stop() left in memory
+    for (auto& [username, list] : stored) {
+        lists[username] = std::move(list);
+    }
+    const char* path = sqlite3_db_filename(db, "main");
+    if (path == nullptr || *path == '\0') {
+        std::cerr << "Suggestion refresh disabled: database has no file" << std::endl;
+        return;
+    }
+    if (sqlite3_open_v2(path, &writer, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        std::cerr << "Can't open " << path << " for suggestion writes: " << sqlite3_errmsg(writer) << std::endl;
+        sqlite3_close(writer);
+        writer = nullptr;
+        return;
+    }
+    sqlite3_busy_timeout(writer, 5000);
+    running = true;
+    refresher = std::thread(&SuggestionStore::refreshLoop, this);
+}
+
+void SuggestionStore::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    wake.notify_all();
+    refresher.join();
+
+    // Lists still queued are out of date: drop their rows so the next start builds them on
+    // request, and write the ones built on request since the last batch
+    std::vector<std::pair<std::string, List>> built;
+    std::vector<std::string> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::string& username : queue) {
+            lists.erase(username);
+            unsaved.erase(username);
+            dropped.push_back(username);
+        }
+        for (const std::string& username : unsaved) {
+            auto it = lists.find(username);
+            if (it != lists.end()) {
+                built.emplace_back(username, it->second);
+            }
+        }
+        queue.clear();
+        queued.clear();
+        unsaved.clear();
+    }
+    save(built, dropped);
+    sqlite3_close(writer);
+    writer = nullptr;
+}
+
+std::vector<std::pair<std::string, int>> SuggestionStore::suggestionsFor(sqlite3* db, const std::string& username,
+                                                                         int limit) {
+    if (limit <= 0) {
+        return {};
+    }
+    FriendGraph& graph = FriendGraph::instance();
+    if (limit > kStoredSuggestions || !graph.loaded()) {
+        // Longer than what is stored, or friendship changes aren't being reported yet
+        return FriendSuggestionService(db).suggestFriends(username, limit);
+    }
+
+    std::vector<std::pair<std::string, int>> stored;
+    bool found = false;
+    uint64_t startChanges;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = lists.find(username);
+        if (it != lists.end()) {
+            stored = it->second.suggestions;
+            found = true;
+            hits++;
+            if (time_utils::nowMillis() - it->second.builtAt >= kRefreshAfterSeconds * 1000) {
+                enqueueLocked(username);
+            }
+        } else {
+            misses++;
+        }
+        startChanges = changes;
+    }
+
+    if (!found) {
+        stored = FriendSuggestionService(db).suggestFriends(username, kStoredSuggestions);
+        std::lock_guard<std::mutex> lock(mutex);
+        lists[username] = List{stored, time_utils::nowMillis()};
+        if (running) {
+            unsaved.insert(username);
+        }
+        // A friendship changed while we were counting, so the list may already be stale
+        if (changes != startChanges) {
+            enqueueLocked(username);
+        }
+        wake.notify_one();
+    }
+
+    // Anyone befriended since the list was built is no longer a suggestion
+    std::vector<std::pair<std::string, int>> result;
+    for (auto& suggestion : stored) {
+        if ((int)result.size() >= limit) {
+            break;
+        }
+        if (!graph.areFriends(username, suggestion.first)) {
+            result.push_back(std::move(suggestion));
+        }
+    }
+    return result;
+}
+
+void SuggestionStore::friendshipChanged(const std::string& a, const std::string& b) {
+    // A user's counts only change if a or b is the user or one of their friends
+    FriendGraph& graph = FriendGraph::instance();
+    std::vector<std::string> affected = graph.friendsOf(a);
+    std::vector<std::string> friendsOfB = graph.friendsOf(b);
+    affected.insert(affected.end(), friendsOfB.begin(), friendsOfB.end());
+    affected.push_back(a);
+    affected.push_back(b);
+    // a and b are also in each other's friends when the friendship was added
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        changes++;
+        for (const std::string& username : affected) {
+            if (lists.count(username)) {
+                enqueueLocked(username);
+            }
+        }
+    }
+    wake.notify_one();
+}
+
+SuggestionStore::Stats SuggestionStore::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return Stats{lists.size(), hits, misses, refreshes, coalesced, rowsWritten, queue.size()};
+}
+
+std::unordered_map<std::string, SuggestionStore::List> SuggestionStore::load(sqlite3* db) {
+    const char* query =
+        "SELECT owner.username, suggested.username, s.mutual_friends, s.built_at FROM friend_suggestions AS s "
+        "JOIN users AS owner ON owner.id = s.user_id "
+        "JOIN users AS suggested ON suggested.id = s.suggested_id "
+        "ORDER BY s.user_id, s.rank";
+    std::unordered_map<std::string, List> stored;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing suggestion load: " << sqlite3_errmsg(db) << std::endl;
+        return stored;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        List& list = stored[reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))];
+        list.suggestions.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)),
+                                      sqlite3_column_int(stmt, 2));
+        list.builtAt = sqlite3_column_int64(stmt, 3);
+    }
+    sqlite3_finalize(stmt);
+    return stored;
+}
+
+void SuggestionStore::enqueueLocked(const std::string& username) {
+    if (!running) {
+        lists.erase(username);  // Nothing will rebuild it; the next request does
+        return;
+    }
+    if (!queued.insert(username).second) {
+        coalesced++;
+        return;
+    }
+    queue.push_back(username);
+}
+
+void SuggestionStore::refreshLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        wake.wait(lock, [this] { return !running || !queue.empty() || !unsaved.empty(); });
+        if (!running) {
+            break;
+        }
+
+        // Lists built on request go first, so a rebuild in this batch overwrites them
+        std::vector<std::pair<std::string, List>> built;
+        for (const std::string& username : unsaved) {
+            auto it = lists.find(username);
+            if (it != lists.end()) {
+                built.emplace_back(username, it->second);
+            }
+        }
+        unsaved.clear();
+        // Leaving queued before the rebuild means a change during it queues the user again
+        std::vector<std::string> batch;
+        while (!queue.empty() && batch.size() < kMaxBatch) {
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
+            queued.erase(batch.back());
+        }
+        lock.unlock();
+
+        size_t firstRebuilt = built.size();
+        FriendSuggestionService service(writer);
+        for (const std::string& username : batch) {
+            built.emplace_back(username, List{service.suggestFriends(username, kStoredSuggestions), time_utils::nowMillis()});
+        }
+
+        lock.lock();
+        for (size_t i = firstRebuilt; i < built.size(); i++) {
+            lists[built[i].first] = built[i].second;
+        }
+        refreshes += batch.size();
+        lock.unlock();
+        save(built, {});
+        lock.lock();
+    }
+}
+
+void SuggestionStore::save(const std::vector<std::pair<std::string, List>>& built,
+                           const std::vector<std::string>& dropped) {
+    if (writer == nullptr || (built.empty() && dropped.empty())) {
+        return;
+    }
+    const char* userSql = "SELECT id FROM users WHERE username = ?";
+    const char* deleteSql = "DELETE FROM friend_suggestions WHERE user_id = ?";
+    const char* insertSql =
+        "INSERT INTO friend_suggestions (user_id, rank, suggested_id, mutual_friends, built_at) "
+        "SELECT ?, ?, id, ?, ? FROM users WHERE username = ?";
+    sqlite3_stmt* userStmt = nullptr;
+    sqlite3_stmt* deleteStmt = nullptr;
+    sqlite3_stmt* insert = nullptr;
+    // IMMEDIATE takes the write lock up front, under the busy timeout: the first statement
+    // is a read, and a read transaction that then writes gets SQLITE_BUSY without waiting
+    bool ok = sqlite3_prepare_v2(writer, userSql, -1, &userStmt, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(writer, deleteSql, -1, &deleteStmt, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(writer, insertSql, -1, &insert, nullptr) == SQLITE_OK &&
+              sqlite3_exec(writer, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) == SQLITE_OK;
+
+    // Removes username's rows; -1 if the account is gone
+    auto clear = [&](const std::string& username) {
+        sqlite3_bind_text(userStmt, 1, username.c_str(), -1, SQLITE_STATIC);
+        int64_t userId = sqlite3_step(userStmt) == SQLITE_ROW ? sqlite3_column_int64(userStmt, 0) : -1;
+        sqlite3_reset(userStmt);
+        if (userId != -1) {
+            sqlite3_bind_int64(deleteStmt, 1, userId);
+            ok = ok && sqlite3_step(deleteStmt) == SQLITE_DONE;
+            sqlite3_reset(deleteStmt);
+        }
+        return userId;
+    };
+
+    size_t rows = 0;
+    if (ok) {
+        for (const auto& [username, list] : built) {
+            int64_t userId = clear(username);
+            if (userId == -1) {
+                continue;
+            }
+            for (size_t rank = 0; rank < list.suggestions.size(); rank++) {
+                sqlite3_bind_int64(insert, 1, userId);
+                sqlite3_bind_int(insert, 2, (int)rank);
+                sqlite3_bind_int(insert, 3, list.suggestions[rank].second);
+                sqlite3_bind_int64(insert, 4, list.builtAt);
+                sqlite3_bind_text(insert, 5, list.suggestions[rank].first.c_str(), -1, SQLITE_STATIC);
+                ok = ok && sqlite3_step(insert) == SQLITE_DONE;
+                sqlite3_reset(insert);
+                rows++;
+            }
+        }
+        for (const std::string& username : dropped) {
+            clear(username);
+        }
+        ok = ok && sqlite3_exec(writer, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    if (!ok) {
+        std::cerr << "Suggestion save failed: " << sqlite3_errmsg(writer) << std::endl;
+        sqlite3_exec(writer, "ROLLBACK", nullptr, nullptr, nullptr);
+    }
+    sqlite3_finalize(userStmt);
+    sqlite3_finalize(deleteStmt);
+    sqlite3_finalize(insert);
+
+    if (ok) {
+        // Otherwise the lists stay in memory only, until their next rebuild is saved
+        std::lock_guard<std::mutex> lock(mutex);
+        rowsWritten += rows;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Friend suggestions kept per user, so /api/friends/suggestions is a lookup instead of a
+// walk over friends of friends on every page load.
+//
+// A user's list (the top kStoredSuggestions of FriendSuggestionService::suggestFriends) is
+// built on their first request and kept. When a friendship between a and b changes, only
+// users within two hops of it can see different mutual-friend counts: a, b and their
+// friends. Those with a stored list are queued for a rebuild; a user already queued isn't
+// queued twice, so a burst of changes around one user costs one rebuild. A refresher thread
+// drains the queue on a connection of its own and writes the rebuilt lists to the
+// friend_suggestions table in one transaction per batch. start() reads them back.
+//
+// Until its rebuild runs a user is served the old list, minus anyone who has become a friend
+// since. Lists older than kRefreshAfterSeconds are rebuilt when served, which picks up
+// affinity drift and new users.
+class SuggestionStore {
+public:
+    static constexpr int kStoredSuggestions = 50;
+
+    struct Stats {
+        size_t lists;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t refreshes;  // Lists rebuilt by the refresher
+        uint64_t coalesced;  // Rebuilds asked for while one was already queued
+        uint64_t rowsWritten;
+        size_t queued;
+    };
+
+    static SuggestionStore& instance();
+
+    // Loads the stored lists and starts the refresher; writes go to db's file
+    void start(sqlite3* db);
+    // Stops the refresher; lists still waiting for a rebuild are dropped from the table
+    void stop();
+
+    // Up to limit suggestions for username as (username, mutual friends). Served from the
+    // stored list when there is one; otherwise computed on db and stored.
+    std::vector<std::pair<std::string, int>> suggestionsFor(sqlite3* db, const std::string& username, int limit);
+
+    // A friendship between a and b was added or removed
+    void friendshipChanged(const std::string& a, const std::string& b);
+
+    Stats stats() const;
+
+private:
+    static constexpr int64_t kRefreshAfterSeconds = 60 * 60;
+    static constexpr size_t kMaxBatch = 64;
+
+    struct List {
+        std::vector<std::pair<std::string, int>> suggestions;
+        int64_t builtAt;  // Epoch millis
+    };
+
+    SuggestionStore();
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, List> lists;
+    std::deque<std::string> queue;
+    std::unordered_set<std::string> queued;
+    std::unordered_set<std::string> unsaved;  // Built on request, not yet in the table
+    uint64_t changes;  // Bumped by every friendship change; lists built across one aren't kept
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t refreshes;
+    uint64_t coalesced;
+    uint64_t rowsWritten;
+
+    sqlite3* writer;  // Used by the refresher only, once started
+    std::condition_variable wake;
+    std::thread refresher;
+    bool running;
+
+    // The lists stored in friend_suggestions, by owner
+    static std::unordered_map<std::string, List> load(sqlite3* db);
+    void enqueueLocked(const std::string& username);
+    void refreshLoop();
+    void save(const std::vector<std::pair<std::string, List>>& built, const std::vector<std::string>& dropped);
+};
@@ -0,0 +1,93 @@
+#include "timeline_change_feed.h"
+#include "post_store.h"
+#include "../utils/id_generator.h"
+#include <algorithm>
+#include <ctime>
+#include <mutex>
+
+TimelineChangeFeed& TimelineChangeFeed::instance() {
+    static TimelineChangeFeed feed;
+    return feed;
+}
+
+TimelineChangeFeed::TimelineChangeFeed() {
+    startSeq = static_cast<uint64_t>(IdGenerator::firstIdAt(std::time(nullptr)));
+    lastSeq.store(startSeq);
+    PostStore::instance().addInvalidationListener([this](int64_t postId, std::string_view author) {
+        recordChange(postId, author);
+    });
+}
+
+void TimelineChangeFeed::recordPost(int64_t postId, const std::string& author) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    appendLocked(logs[author], postId, true);
+}
+
+void TimelineChangeFeed::recordChange(int64_t postId, std::string_view author) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    appendLocked(author.empty() ? unattributed : logs[std::string(author)], postId, false);
+}
+
+uint64_t TimelineChangeFeed::head() const {
+    return lastSeq.load();
+}
+
+bool TimelineChangeFeed::since(uint64_t cursor, const std::vector<std::string>& authors, std::vector<Event>& out,
+                               uint64_t& newHead) const {
+    // The idle poll: nothing happened, so don't even take the lock
+    newHead = lastSeq.load();
+    if (cursor == newHead) {
+        return true;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    newHead = lastSeq.load();
+    if (cursor < startSeq || cursor > newHead) {
+        return false;
+    }
+    size_t first = out.size();
+    if (!collect(unattributed, cursor, out)) {
+        return false;
+    }
+    for (const std::string& author : authors) {
+        auto it = logs.find(author);
+        if (it != logs.end() && !collect(it->second, cursor, out)) {
+            return false;
+        }
+    }
+    std::sort(out.begin() + first, out.end(), [](const Event& a, const Event& b) { return a.seq < b.seq; });
+    return true;
+}
+
+bool TimelineChangeFeed::collect(const Log& log, uint64_t cursor, std::vector<Event>& out) {
+    if (cursor < log.droppedThrough) {
+        return false;
+    }
+    auto after = std::upper_bound(log.events.begin(), log.events.end(), cursor,
+                                  [](uint64_t seq, const Event& event) { return seq < event.seq; });
+    out.insert(out.end(), after, log.events.end());
+    return true;
+}
+
+void TimelineChangeFeed::appendLocked(Log& log, int64_t postId, bool created) {
+    uint64_t seq = lastSeq.load() + 1;
+    log.events.push_back(Event{seq, postId, created});
+    order.emplace_back(seq, &log);
+    if (log.events.size() > kAuthorCapacity) {
+        dropOldest(log);
+    }
+    if (order.size() > kCapacity) {
+        // Logs are map values, so the pointers survive rehashing
+        Log* oldest = order.front().second;
+        if (!oldest->events.empty() && oldest->events.front().seq == order.front().first) {
+            dropOldest(*oldest);
+        }
+        order.pop_front();
+    }
+    lastSeq.store(seq);
+}
+
+void TimelineChangeFeed::dropOldest(Log& log) {
+    log.droppedThrough = log.events.front().seq;
+    log.events.pop_front();
+}
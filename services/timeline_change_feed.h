@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// In-memory log of recent post activity, kept per author, so polling timelines can ask "what
+// did these authors do since my cursor" without touching SQLite, at a cost that follows the
+// answer rather than everyone else's activity.
+//
+// Every new post and every change to an existing post (likes, comments, edits, deletes, via
+// PostStore's invalidation listener) is appended to its author's log with the next sequence
+// number; a cursor is simply the sequence number of the last event a client has seen. Post
+// ids can't serve as cursors because an id is taken before its insert commits, so posts can
+// become visible out of id order. Sequence numbers start from the clock at process start, so
+// cursors handed out by an earlier process are recognised as too old.
+//
+// Each author's log keeps their newest kAuthorCapacity events, and all logs together the
+// newest kCapacity. Losing an author's old events only fails cursors from before them, so a
+// slow poller has to reload only when one of its own authors has been busy or the whole
+// feed has turned over. A change to a post PostStore wasn't holding has no known author;
+// those go on a log that every poll reads.
+class TimelineChangeFeed {
+public:
+    struct Event {
+        uint64_t seq;
+        int64_t postId;
+        bool created;   // A new post rather than a change to an existing one
+    };
+
+    static TimelineChangeFeed& instance();
+
+    void recordPost(int64_t postId, const std::string& author);
+    // author is empty if it isn't known
+    void recordChange(int64_t postId, std::string_view author);
+
+    // Cursor a client starts from when it has just read everything
+    uint64_t head() const;
+
+    // Appends the events after cursor by any of authors, and the changes whose author isn't
+    // known, oldest first, and sets newHead to the cursor to poll with next. Returns false if
+    // the cursor wasn't handed out by this feed or events it hasn't seen have aged out; the
+    // client has to reload the timeline then.
+    bool since(uint64_t cursor, const std::vector<std::string>& authors, std::vector<Event>& events,
+               uint64_t& newHead) const;
+
+private:
+    static constexpr size_t kCapacity = 100000;
+    static constexpr size_t kAuthorCapacity = 500;
+
+    struct Log {
+        std::deque<Event> events;
+        uint64_t droppedThrough = 0;  // Sequence number of the newest event dropped from it
+    };
+
+    TimelineChangeFeed();
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Log> logs;  // By author; kept once made, for droppedThrough
+    Log unattributed;
+    // Every event still counted against kCapacity and its log, oldest first. An author's log
+    // may already have dropped it.
+    std::deque<std::pair<uint64_t, Log*>> order;
+    uint64_t startSeq;              // No cursor below this came from this feed
+    std::atomic<uint64_t> lastSeq;  // Sequence number of the newest event
+
+    void appendLocked(Log& log, int64_t postId, bool created);
+    static void dropOldest(Log& log);
+    // Appends log's events after cursor to out; false if some of them were dropped
+    static bool collect(const Log& log, uint64_t cursor, std::vector<Event>& out);
+};
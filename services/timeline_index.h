@@ -0,0 +1,24 @@
+#pragma once
+#include "PostAVLTree.h"
+#include "PostBlockIndex.h"
+
+// Containers that can back the timeline; both expose the same interface.
+// TimelineIndexOf<true> is the cache-friendly sorted-block index, TimelineIndexOf<false>
+// the pointer-based AVL tree.
+template <bool BlockIndex>
+struct TimelineIndexOf {
+    using type = PostAVLTree;
+};
+
+template <>
+struct TimelineIndexOf<true> {
+    using type = PostBlockIndex;
+};
+
+// The one the server uses. Build with -DTIMELINE_USE_BLOCK_INDEX=ON to swap the AVL tree
+// for the sorted-block index.
+#ifdef TIMELINE_USE_BLOCK_INDEX
+using TimelineIndex = TimelineIndexOf<true>::type;
+#else
+using TimelineIndex = TimelineIndexOf<false>::type;
+#endif
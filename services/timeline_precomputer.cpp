@@ -0,0 +1,246 @@
+#include "timeline_precomputer.h"
+#include "dynamic_timeline_service.h"
+#include "post_store.h"
+#include "../database/db_utils.h"
+#include <chrono>
+#include <iostream>
+
+std::atomic<int> TimelinePrecomputer::interactiveRequests(0);
+
+namespace {
+    double threadCpuSeconds() {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+}
+
+TimelinePrecomputer::InteractiveScope::InteractiveScope() {
+    interactiveRequests.fetch_add(1);
+}
+
+TimelinePrecomputer::InteractiveScope::~InteractiveScope() {
+    interactiveRequests.fetch_sub(1);
+}
+
+TimelinePrecomputer& TimelinePrecomputer::instance() {
+    static TimelinePrecomputer precomputer;
+    return precomputer;
+}
+
+TimelinePrecomputer::TimelinePrecomputer()
+    : hits(0), misses(0), precomputed(0), invalidations(0), stopping(false) {}
+
+void TimelinePrecomputer::start(sqlite3* db) {
+    const char* path = sqlite3_db_filename(db, "main");
+    if (path == nullptr || *path == '\0') {
+        std::cerr << "Timeline precomputation disabled: database has no file" << std::endl;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pool) {
+        return;
+    }
+    dbPath = path;
+    stopping = false;
+    pool.reset(new ThreadPool(kWorkerThreads, kWorkerNice));
+    scheduler = std::thread(&TimelinePrecomputer::scheduleLoop, this);
+}
+
+void TimelinePrecomputer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pool) {
+            return;
+        }
+        stopping = true;
+    }
+    wake.notify_all();
+    scheduler.join();
+    pool->discardPending();  // Nobody waits on a precompute; the next login queues it again
+    pool.reset();            // Lets the builds already running finish
+    std::lock_guard<std::mutex> lock(mutex);
+    queued.clear();
+}
+
+void TimelinePrecomputer::noteLogin(const std::string& username) {
+    std::lock_guard<std::mutex> lock(mutex);
+    lastActive[username] = std::time(nullptr);
+    enqueueLocked(username);
+}
+
+std::vector<Post> TimelinePrecomputer::firstPage(sqlite3* db, const std::string& username, uint64_t* version) {
+    std::vector<int64_t> ids;
+    bool cached = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::time_t now = std::time(nullptr);
+        lastActive[username] = now;
+        auto it = pages.find(username);
+        if (it != pages.end() && now - it->second.builtAt < kRefreshAfterSeconds) {
+            ids = it->second.ids;
+            cached = true;
+            hits++;
+            if (version) {
+                *version = versionLocked(username);
+            }
+        } else {
+            misses++;
+        }
+    }
+
+    if (!cached) {
+        return build(db, username, version);
+    }
+
+    std::vector<Post> posts;
+    posts.reserve(ids.size());
+    for (const auto& post : PostStore::instance().multiGet(db, ids)) {
+        if (post) {
+            posts.push_back(*post);  // Deleted since the page was built otherwise
+        }
+    }
+    return posts;
+}
+
+void TimelinePrecomputer::invalidateAuthor(const std::string& author) {
+    std::lock_guard<std::mutex> lock(mutex);
+    invalidations++;
+    for (Build& running : building) {
+        running.invalidatedAuthors.insert(author);
+    }
+    auto it = viewersByAuthor.find(author);
+    if (it == viewersByAuthor.end()) {
+        return;
+    }
+    for (const std::string& viewer : it->second) {
+        dropPageLocked(viewer);
+    }
+    viewersByAuthor.erase(it);
+}
+
+void TimelinePrecomputer::invalidateUser(const std::string& username) {
+    std::lock_guard<std::mutex> lock(mutex);
+    invalidations++;
+    for (Build& running : building) {
+        if (running.username == username) {
+            running.userInvalidated = true;
+        }
+    }
+    dropPageLocked(username);
+}
+
+uint64_t TimelinePrecomputer::version(const std::string& username) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return versionLocked(username);
+}
+
+TimelinePrecomputer::Stats TimelinePrecomputer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return Stats{hits, misses, precomputed, invalidations, pages.size()};
+}
+
+std::vector<Post> TimelinePrecomputer::build(sqlite3* db, const std::string& username, uint64_t* version) {
+    std::list<Build>::iterator running;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = building.insert(building.end(), Build{username, {}, false});
+    }
+
+    DynamicTimelineService service(db);
+    std::vector<std::string> authors;
+    std::vector<Post> posts = service.generateDynamicTimeline(username, kPageSize, &authors);
+
+    Page page;
+    page.ids.reserve(posts.size());
+    for (const Post& post : posts) {
+        page.ids.push_back(post.getId());
+    }
+    page.builtAt = std::time(nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // If the user's friends changed, or one of the authors we read posted, while we were
+    // reading, this page could already be stale. Invalidations of anyone else don't matter.
+    bool stale = running->userInvalidated;
+    for (size_t i = 0; i < authors.size() && !stale && !running->invalidatedAuthors.empty(); i++) {
+        stale = running->invalidatedAuthors.count(authors[i]) != 0;
+    }
+    building.erase(running);
+    if (!stale) {
+        for (const std::string& author : authors) {
+            viewersByAuthor[author].insert(username);
+        }
+        pages[username] = std::move(page);
+    }
+    if (version) {
+        *version = stale ? 0 : versionLocked(username);
+    }
+    return posts;
+}
+
+void TimelinePrecomputer::enqueueLocked(const std::string& username) {
+    if (!pool || stopping || !queued.insert(username).second) {
+        return;
+    }
+    pool->submit([this, username] { precompute(username); });
+}
+
+void TimelinePrecomputer::precompute(const std::string& username) {
+    // Let interactive requests finish first, but don't starve behind a steady stream of them
+    for (int i = 0; i < 40 && interactiveRequests.load() > 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    double cpuStart = threadCpuSeconds();
+    if (sqlite3* db = threadReadConnection(dbPath)) {
+        build(db, username);
+    }
+    double cpuUsed = threadCpuSeconds() - cpuStart;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.erase(username);
+        precomputed++;
+    }
+
+    // Duty cycle: idle long enough that this build was at most kMaxCpuShare of the time
+    double idle = cpuUsed * (1.0 - kMaxCpuShare) / kMaxCpuShare;
+    std::this_thread::sleep_for(std::chrono::duration<double>(idle));
+}
+
+void TimelinePrecomputer::scheduleLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        wake.wait_for(lock, std::chrono::seconds(kScheduleIntervalSeconds));
+        if (stopping) {
+            break;
+        }
+        std::time_t now = std::time(nullptr);
+        for (auto it = lastActive.begin(); it != lastActive.end();) {
+            if (now - it->second > kActiveWindowSeconds) {
+                dropPageLocked(it->first);
+                it = lastActive.erase(it);
+                continue;
+            }
+            // Refresh a little before a page goes stale, so active users keep hitting the cache
+            auto page = pages.find(it->first);
+            if (page == pages.end() || now - page->second.builtAt >= kRefreshAfterSeconds - kScheduleIntervalSeconds) {
+                enqueueLocked(it->first);
+            }
+            ++it;
+        }
+    }
+}
+
+void TimelinePrecomputer::dropPageLocked(const std::string& username) {
+    // viewersByAuthor may still name this user; a later invalidation through it is harmless
+    pages.erase(username);
+    auto it = versions.find(username);
+    if (it != versions.end()) {
+        it->second++;
+    }
+}
+
+uint64_t TimelinePrecomputer::versionLocked(const std::string& username) {
+    return versions.emplace(username, 1).first->second;
+}
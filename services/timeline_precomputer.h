@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Post.h"
+#include "../utils/thread_pool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Builds the first timeline page of recently active users ahead of time, so the page
+// load after login doesn't pay for the friend lookup and per-friend post queries.
+//
+// A cached page is just the ordered post ids; serving it reads the posts from the
+// shared PostStore, so like and comment counts are never older than the store's copy.
+// Pages are rebuilt on login, by a scheduler for users seen in the last few minutes,
+// and on demand after an invalidation. Background builds run on low-priority workers
+// with their own read-only connections, wait while interactive requests are in flight,
+// and sleep after each build so a worker uses at most kMaxCpuShare of a core.
+class TimelinePrecomputer {
+public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t precomputed;    // Pages built in the background
+        uint64_t invalidations;
+        size_t entries;
+    };
+
+    // Marks an interactive request; background builds hold off while any are open
+    class InteractiveScope {
+    public:
+        InteractiveScope();
+        ~InteractiveScope();
+        InteractiveScope(const InteractiveScope&) = delete;
+        InteractiveScope& operator=(const InteractiveScope&) = delete;
+    };
+
+    static TimelinePrecomputer& instance();
+
+    // Starts the workers and the scheduler; workers open db's file read-only
+    void start(sqlite3* db);
+    void stop();
+
+    // Marks the user active and queues a build of their first page
+    void noteLogin(const std::string& username);
+
+    // First page of username's timeline, newest first: the cached page if there is a fresh
+    // one, otherwise built on the caller's connection (and cached for the next request).
+    // If version is given it receives the version the page belongs to, or 0 if the page
+    // isn't tracked (a concurrent invalidation kept it out of the cache).
+    std::vector<Post> firstPage(sqlite3* db, const std::string& username, uint64_t* version = nullptr);
+
+    // Bumped whenever the set of posts username's timeline draws from changes: one of their
+    // authors posted, or their friends changed. Never 0.
+    uint64_t version(const std::string& username);
+
+    // Drops every cached page that includes posts by author (they just posted)
+    void invalidateAuthor(const std::string& author);
+    // Drops username's own page (their set of friends changed)
+    void invalidateUser(const std::string& username);
+
+    Stats stats() const;
+
+private:
+    static constexpr int kPageSize = 50;
+    static constexpr size_t kWorkerThreads = 2;
+    static constexpr int kWorkerNice = 10;
+    static constexpr double kMaxCpuShare = 0.25;
+    static constexpr std::time_t kActiveWindowSeconds = 15 * 60;
+    static constexpr std::time_t kRefreshAfterSeconds = 120;
+    static constexpr int kScheduleIntervalSeconds = 30;
+
+    struct Page {
+        std::vector<int64_t> ids;
+        std::time_t builtAt;
+    };
+
+    // A page being built. Invalidations that land meanwhile are recorded here, and the page
+    // isn't cached if any of them touched what the build read.
+    struct Build {
+        std::string username;
+        std::unordered_set<std::string> invalidatedAuthors;
+        bool userInvalidated;  // Their friends changed
+    };
+
+    TimelinePrecomputer();
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Page> pages;
+    std::unordered_map<std::string, std::unordered_set<std::string>> viewersByAuthor;  // Authors of a page -> its users
+    std::unordered_map<std::string, std::time_t> lastActive;
+    std::unordered_set<std::string> queued;
+    std::unordered_map<std::string, uint64_t> versions;
+    std::list<Build> building;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t precomputed;
+    uint64_t invalidations;
+
+    std::string dbPath;
+    std::unique_ptr<ThreadPool> pool;
+    std::thread scheduler;
+    std::condition_variable wake;
+    bool stopping;
+
+    static std::atomic<int> interactiveRequests;
+
+    std::vector<Post> build(sqlite3* db, const std::string& username, uint64_t* version = nullptr);
+    uint64_t versionLocked(const std::string& username);
+    void enqueueLocked(const std::string& username);
+    void precompute(const std::string& username);
+    void scheduleLoop();
+    void dropPageLocked(const std::string& username);
+};
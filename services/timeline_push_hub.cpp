@@ -0,0 +1,323 @@
+#include "timeline_push_hub.h"
+#include "post_store.h"
+#include "../database/db_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+TimelinePushHub& TimelinePushHub::instance() {
+    static TimelinePushHub hub;
+    return hub;
+}
+
+TimelinePushHub::TimelinePushHub()
+    : nextId(1), notified(0), messages(0), overflows(0), counterMessages(0), running(false) {
+    PostStore::instance().addInvalidationListener([this](int64_t postId, std::string_view) { postChanged(postId); });
+}
+
+void TimelinePushHub::start(sqlite3* db) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) {
+        return;
+    }
+    const char* path = sqlite3_db_filename(db, "main");
+    if (path == nullptr || *path == '\0') {
+        std::cerr << "Live counters disabled: database has no file" << std::endl;
+    } else {
+        dbPath = path;
+    }
+    running = true;
+    flusher = std::thread(&TimelinePushHub::flushLoop, this);
+}
+
+void TimelinePushHub::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    wake.notify_all();
+    flusher.join();
+}
+
+uint64_t TimelinePushHub::subscribe(sqlite3* db, const std::string& username, Send send) {
+    std::vector<std::string> friends = loadFriends(db, username);
+
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->username = username;
+    subscriber->send = std::move(send);
+    subscriber->closed = false;
+    subscriber->overflowed = false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    subscriber->id = nextId++;
+    subscribers[subscriber->id] = subscriber;
+    auto& sessions = byUser[username];
+    sessions.push_back(subscriber);
+    if (sessions.size() == 1) {
+        watchLocked(username, std::move(friends));
+    }
+    return subscriber->id;
+}
+
+void TimelinePushHub::unsubscribe(uint64_t subscription) {
+    std::shared_ptr<Subscriber> subscriber;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = subscribers.find(subscription);
+        if (it == subscribers.end()) {
+            return;
+        }
+        subscriber = it->second;
+        subscribers.erase(it);
+        dirty.erase(subscription);
+        countersDirty.erase(subscription);
+        unwatchPostsLocked(*subscriber);
+
+        auto& sessions = byUser[subscriber->username];
+        sessions.erase(std::remove(sessions.begin(), sessions.end(), subscriber), sessions.end());
+        if (sessions.empty()) {
+            byUser.erase(subscriber->username);
+            unwatchLocked(subscriber->username);
+        }
+    }
+    // Wait out a send in progress; the transport may free the connection once we return
+    std::lock_guard<std::mutex> sendLock(subscriber->sendMutex);
+    subscriber->closed = true;
+}
+
+void TimelinePushHub::notifyPost(const std::string& author, int64_t postId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = watchers.find(author);
+    if (it == watchers.end()) {
+        return;
+    }
+    for (const std::string& viewer : it->second) {
+        for (const auto& subscriber : byUser[viewer]) {
+            notified++;
+            if (subscriber->overflowed) {
+                continue;
+            }
+            if (subscriber->queued.size() >= kMaxQueued) {
+                // The client is far behind; one reload beats a long list of ids
+                subscriber->queued.clear();
+                subscriber->overflowed = true;
+                overflows++;
+            } else {
+                subscriber->queued.push_back(postId);
+            }
+            dirty.insert(subscriber->id);
+        }
+    }
+}
+
+void TimelinePushHub::reloadFriends(sqlite3* db, const std::string& username) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (byUser.find(username) == byUser.end()) {
+            return;
+        }
+    }
+    std::vector<std::string> friends = loadFriends(db, username);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (byUser.find(username) == byUser.end()) {
+        return;  // Disconnected meanwhile
+    }
+    unwatchLocked(username);
+    watchLocked(username, std::move(friends));
+}
+
+void TimelinePushHub::watchPosts(uint64_t subscription, std::vector<int64_t> postIds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = subscribers.find(subscription);
+    if (it == subscribers.end()) {
+        return;
+    }
+    Subscriber& subscriber = *it->second;
+    unwatchPostsLocked(subscriber);
+    if (postIds.size() > kMaxWatched) {
+        postIds.resize(kMaxWatched);
+    }
+    for (int64_t postId : postIds) {
+        watchersByPost[postId].insert(subscription);
+    }
+    subscriber.watching = std::move(postIds);
+}
+
+TimelinePushHub::Stats TimelinePushHub::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return Stats{subscribers.size(), byUser.size(), notified, messages, overflows, counterMessages, watchersByPost.size()};
+}
+
+std::vector<std::string> TimelinePushHub::loadFriends(sqlite3* db, const std::string& username) {
+    return getFriendNames(db, username);
+}
+
+void TimelinePushHub::watchLocked(const std::string& username, std::vector<std::string> friends) {
+    watchers[username].insert(username);  // Their own posts from another session
+    for (const std::string& friendName : friends) {
+        watchers[friendName].insert(username);
+    }
+    friendsOf[username] = std::move(friends);
+}
+
+void TimelinePushHub::unwatchLocked(const std::string& username) {
+    auto it = friendsOf.find(username);
+    if (it == friendsOf.end()) {
+        return;
+    }
+    it->second.push_back(username);
+    for (const std::string& author : it->second) {
+        auto viewers = watchers.find(author);
+        if (viewers != watchers.end()) {
+            viewers->second.erase(username);
+            if (viewers->second.empty()) {
+                watchers.erase(viewers);
+            }
+        }
+    }
+    friendsOf.erase(it);
+}
+
+void TimelinePushHub::unwatchPostsLocked(Subscriber& subscriber) {
+    for (int64_t postId : subscriber.watching) {
+        auto watchers = watchersByPost.find(postId);
+        if (watchers != watchersByPost.end()) {
+            watchers->second.erase(subscriber.id);
+            if (watchers->second.empty()) {
+                watchersByPost.erase(watchers);
+            }
+        }
+    }
+    subscriber.watching.clear();
+    subscriber.changed.clear();
+}
+
+void TimelinePushHub::postChanged(int64_t postId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto watchers = watchersByPost.find(postId);
+    if (watchers == watchersByPost.end()) {
+        return;
+    }
+    for (uint64_t id : watchers->second) {
+        auto it = subscribers.find(id);
+        if (it != subscribers.end()) {
+            it->second->changed.insert(postId);
+            countersDirty.insert(id);
+        }
+    }
+}
+
+void TimelinePushHub::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        wake.wait_for(lock, std::chrono::milliseconds(kFlushIntervalMs));
+        if (!running) {
+            break;
+        }
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+void TimelinePushHub::flush() {
+    std::vector<std::pair<std::shared_ptr<Subscriber>, std::string>> outgoing;
+    std::vector<std::pair<std::shared_ptr<Subscriber>, std::vector<int64_t>>> counterBatches;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        outgoing.reserve(dirty.size());
+        for (uint64_t id : dirty) {
+            auto it = subscribers.find(id);
+            if (it == subscribers.end()) {
+                continue;
+            }
+            Subscriber& subscriber = *it->second;
+            nlohmann::json message;
+            if (subscriber.overflowed) {
+                message = {{"type", "reload"}};
+            } else {
+                std::sort(subscriber.queued.begin(), subscriber.queued.end(), std::greater<int64_t>());
+                message = {{"type", "posts"}, {"post_ids", subscriber.queued}};
+            }
+            subscriber.queued.clear();
+            subscriber.overflowed = false;
+            outgoing.emplace_back(it->second, message.dump());
+        }
+        dirty.clear();
+        messages += outgoing.size();
+
+        // Connections that got counters within the last interval keep collecting
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = countersDirty.begin(); it != countersDirty.end();) {
+            auto subscriber = subscribers.find(*it);
+            if (subscriber == subscribers.end()) {
+                it = countersDirty.erase(it);
+                continue;
+            }
+            Subscriber& s = *subscriber->second;
+            if (now - s.countersSentAt < std::chrono::milliseconds(kCounterIntervalMs)) {
+                ++it;
+                continue;
+            }
+            counterBatches.emplace_back(subscriber->second, std::vector<int64_t>(s.changed.begin(), s.changed.end()));
+            s.changed.clear();
+            s.countersSentAt = now;
+            it = countersDirty.erase(it);
+        }
+        counterMessages += counterBatches.size();
+    }
+    flushCounters(counterBatches);
+
+    // Sent outside the hub's lock so a slow transport can't hold up notifyPost
+    for (auto& [subscriber, message] : outgoing) {
+        std::lock_guard<std::mutex> sendLock(subscriber->sendMutex);
+        if (!subscriber->closed) {
+            subscriber->send(message);
+        }
+    }
+}
+
+void TimelinePushHub::flushCounters(std::vector<std::pair<std::shared_ptr<Subscriber>, std::vector<int64_t>>>& batches) {
+    if (batches.empty() || dbPath.empty()) {
+        return;
+    }
+    sqlite3* db = threadReadConnection(dbPath);
+    if (db == nullptr) {
+        return;
+    }
+
+    // One lookup for every post any connection is about to hear about
+    std::vector<int64_t> ids;
+    for (const auto& batch : batches) {
+        ids.insert(ids.end(), batch.second.begin(), batch.second.end());
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    std::vector<std::shared_ptr<const Post>> posts = PostStore::instance().multiGet(db, ids);
+
+    std::unordered_map<int64_t, nlohmann::json> counters;
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (posts[i]) {
+            counters[ids[i]] = {{"id", ids[i]}, {"like_count", posts[i]->getLikeCount()},
+                                {"comment_count", posts[i]->getCommentCount()}};
+        } else {
+            counters[ids[i]] = {{"id", ids[i]}, {"deleted", true}};
+        }
+    }
+
+    for (auto& [subscriber, changed] : batches) {
+        nlohmann::json message = {{"type", "counters"}, {"posts", nlohmann::json::array()}};
+        for (int64_t postId : changed) {
+            message["posts"].push_back(counters[postId]);
+        }
+        std::string text = message.dump();
+        std::lock_guard<std::mutex> sendLock(subscriber->sendMutex);
+        if (!subscriber->closed) {
+            subscriber->send(text);
+        }
+    }
+}
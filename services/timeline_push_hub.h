@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Pushes "new posts on your timeline" notices and live like/comment counts to connected
+// clients, so they don't have to poll /api/timeline to find out.
+//
+// The hub knows nothing about the transport: a connection registers a send callback and
+// gets back a subscription id. Each subscription has a small bounded queue of post ids;
+// a burst of posts is coalesced into one message by a single flusher thread that only
+// visits subscriptions with something queued, so idle connections cost a registry entry
+// and no thread. A queue that overflows is replaced by one "reload" notice.
+//
+// A client also tells the hub which posts it has on screen. Changes to those posts arrive
+// through PostStore's invalidation listener and are collected per connection; at most once
+// per kCounterIntervalMs the flusher reads the current counts of everything that changed
+// (one batched PostStore lookup for all connections) and sends them.
+//
+// Messages are JSON: {"type":"posts","post_ids":[...]} (newest first), {"type":"reload"},
+// or {"type":"counters","posts":[{"id","like_count","comment_count"}, ...]}, where a deleted
+// post is {"id","deleted":true}.
+class TimelinePushHub {
+public:
+    using Send = std::function<void(const std::string&)>;
+
+    struct Stats {
+        size_t connections;
+        size_t users;
+        uint64_t notified;    // Post ids queued for delivery
+        uint64_t messages;    // Messages sent after coalescing
+        uint64_t overflows;
+        uint64_t counterMessages;
+        size_t watchedPosts;
+    };
+
+    static TimelinePushHub& instance();
+
+    // Starts the flusher; counter lookups use a read-only connection to db's file
+    void start(sqlite3* db);
+    void stop();
+
+    // Registers a connection for username; send is called from the flusher thread
+    uint64_t subscribe(sqlite3* db, const std::string& username, Send send);
+    void unsubscribe(uint64_t subscription);
+
+    // author just created postId: queue it for every connected friend (and the author's
+    // other connections)
+    void notifyPost(const std::string& author, int64_t postId);
+
+    // username's friends changed; re-reads them if username is connected
+    void reloadFriends(sqlite3* db, const std::string& username);
+
+    // Replaces the set of posts the subscription wants counter updates for (the posts on
+    // screen); only the first kMaxWatched are kept
+    void watchPosts(uint64_t subscription, std::vector<int64_t> postIds);
+
+    Stats stats() const;
+
+private:
+    static constexpr size_t kMaxQueued = 50;
+    static constexpr int kFlushIntervalMs = 200;
+    static constexpr size_t kMaxWatched = 200;
+    static constexpr int kCounterIntervalMs = 1000;
+
+    struct Subscriber {
+        uint64_t id;
+        std::string username;
+        Send send;
+        std::mutex sendMutex;  // Held while sending; closed is checked under it
+        bool closed;
+        // Guarded by the hub's mutex
+        std::vector<int64_t> queued;
+        bool overflowed;
+        std::vector<int64_t> watching;
+        std::unordered_set<int64_t> changed;  // Watched posts whose counters moved since the last send
+        std::chrono::steady_clock::time_point countersSentAt;
+    };
+
+    TimelinePushHub();
+
+    mutable std::mutex mutex;
+    uint64_t nextId;
+    std::unordered_map<uint64_t, std::shared_ptr<Subscriber>> subscribers;
+    std::unordered_map<std::string, std::vector<std::shared_ptr<Subscriber>>> byUser;
+    std::unordered_map<std::string, std::vector<std::string>> friendsOf;            // Connected users only
+    std::unordered_map<std::string, std::unordered_set<std::string>> watchers;      // Author -> connected viewers
+    std::unordered_map<int64_t, std::unordered_set<uint64_t>> watchersByPost;
+    std::unordered_set<uint64_t> dirty;          // Subscriptions with post ids queued
+    std::unordered_set<uint64_t> countersDirty;  // Subscriptions with changed counters
+    uint64_t notified;
+    uint64_t messages;
+    uint64_t overflows;
+    uint64_t counterMessages;
+
+    std::string dbPath;
+    std::thread flusher;
+    std::condition_variable wake;
+    bool running;
+
+    static std::vector<std::string> loadFriends(sqlite3* db, const std::string& username);
+    void watchLocked(const std::string& username, std::vector<std::string> friends);
+    void unwatchLocked(const std::string& username);
+    void unwatchPostsLocked(Subscriber& subscriber);
+    void postChanged(int64_t postId);
+    void flushLoop();
+    void flush();
+    void flushCounters(std::vector<std::pair<std::shared_ptr<Subscriber>, std::vector<int64_t>>>& batches);
+};
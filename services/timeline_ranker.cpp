@@ -0,0 +1,70 @@
+#include "timeline_ranker.h"
+#include "../utils/id_generator.h"
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+TimelineRanker& TimelineRanker::instance() {
+    static TimelineRanker ranker;
+    return ranker;
+}
+
+TimelineRanker::TimelineRanker() {
+    for (int n = 0; n < kLogTableSize; n++) {
+        log1pTable[n] = std::log1p((double)n);
+    }
+}
+
+std::vector<std::shared_ptr<const Post>> TimelineRanker::topK(const std::vector<std::shared_ptr<const Post>>& candidates,
+                                                              size_t k, const Affinity& affinity) const {
+    using Scored = std::pair<double, size_t>;  // (key, candidate index)
+    std::priority_queue<Scored, std::vector<Scored>, std::greater<Scored>> best;  // Worst kept on top
+    if (k == 0) {
+        return {};
+    }
+
+    Weights weights = this->weights();
+    const double decayPerMilli = std::log(2.0) / (weights.halfLifeHours * 3600000.0);
+
+    // Affinity is per author, and a page draws on few authors, so look each up once. Names
+    // are interned, so the text's address identifies the author.
+    std::unordered_map<const char*, double> affinityKeys;
+
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const Post& post = *candidates[i];
+        auto author = affinityKeys.find(post.getUserName().data());
+        if (author == affinityKeys.end()) {
+            double a = affinity ? std::max(0.0, affinity(post.getUserName())) : 0.0;
+            author = affinityKeys.emplace(post.getUserName().data(), std::log1p(weights.affinity * a)).first;
+        }
+        double engagement = 1.0 + weights.like * log1pCount(post.getLikeCount()) +
+                            weights.comment * log1pCount(post.getCommentCount());
+        // Posts from before ids were generated carry their age only in created_at
+        int64_t millis = IdGenerator::isGenerated(post.getId()) ? IdGenerator::millisOf(post.getId())
+                                                                : (int64_t)post.getcreated_at() * 1000;
+        double key = std::log(engagement) + author->second + millis * decayPerMilli;
+        if (best.size() < k) {
+            best.emplace(key, i);
+        } else if (key > best.top().first) {
+            best.pop();
+            best.emplace(key, i);
+        }
+    }
+
+    std::vector<std::shared_ptr<const Post>> ranked(best.size());
+    for (size_t i = ranked.size(); i-- > 0;) {
+        ranked[i] = candidates[best.top().second];
+        best.pop();
+    }
+    return ranked;
+}
+
+void TimelineRanker::setWeights(const Weights& weights) {
+    std::lock_guard<std::mutex> lock(mutex);
+    current = weights;
+}
+
+TimelineRanker::Weights TimelineRanker::weights() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current;
+}
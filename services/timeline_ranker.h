@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Post.h"
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Scores timeline candidates for the ranked mode and picks the best K.
+//
+//   score = (1 + like * ln(1 + likes) + comment * ln(1 + comments))
+//         * (1 + affinity * viewer's affinity for the author)
+//         * 2^(-age / halfLife)
+//
+// Ranking compares logarithms with the age measured from a fixed epoch rather than from
+// now: the decay term then shifts every post's key by the same amount as time passes, so a
+// key depends only on the post itself and changes only when its counters do. Candidates
+// come from PostStore, which drops a post on every like or comment, so a fresh count is
+// picked up by the next ranking with no rescoring of anything else.
+class TimelineRanker {
+public:
+    struct Weights {
+        double halfLifeHours = 6.0;
+        double like = 1.0;
+        double comment = 2.0;
+        double affinity = 1.0;
+    };
+
+    // Viewer's affinity for an author, >= 0 (0: no interaction)
+    using Affinity = std::function<double(std::string_view author)>;
+
+    static TimelineRanker& instance();
+
+    // The k best candidates, best first. O(n log k): a bounded heap, no full sort.
+    std::vector<std::shared_ptr<const Post>> topK(const std::vector<std::shared_ptr<const Post>>& candidates, size_t k,
+                                                  const Affinity& affinity) const;
+
+    void setWeights(const Weights& weights);
+    Weights weights() const;
+
+private:
+    TimelineRanker();
+
+    mutable std::mutex mutex;
+    Weights current;
+
+    // ln(1 + n) for small counts; the logs are most of the cost of scoring a candidate
+    static constexpr int kLogTableSize = 1024;
+    double log1pTable[kLogTableSize];
+
+    double log1pCount(int n) const { return n >= 0 && n < kLogTableSize ? log1pTable[n] : std::log1p((double)n); }
+};
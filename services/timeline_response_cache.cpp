@@ -0,0 +1,135 @@
+#include "timeline_response_cache.h"
+#include "post_store.h"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+TimelineResponseCache& TimelineResponseCache::instance() {
+    static TimelineResponseCache cache;
+    return cache;
+}
+
+TimelineResponseCache::TimelineResponseCache() : bytes(0), hits(0), misses(0), invalidations(0), raced(0) {
+    PostStore::instance().addInvalidationListener([this](int64_t postId, std::string_view) { invalidatePost(postId); });
+}
+
+TimelineResponseCache::BuildScope::BuildScope() {
+    TimelineResponseCache& cache = instance();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    invalidated = cache.building.emplace(cache.building.end());
+}
+
+TimelineResponseCache::BuildScope::~BuildScope() {
+    TimelineResponseCache& cache = instance();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.building.erase(invalidated);
+}
+
+size_t TimelineResponseCache::KeyHash::operator()(const Key& key) const {
+    return std::hash<std::string>()(key.username) * 31 + std::hash<int64_t>()(key.cursor);
+}
+
+std::shared_ptr<const TimelineResponseCache::Response> TimelineResponseCache::find(const std::string& username,
+                                                                                   int64_t cursor, uint64_t version) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(Key{username, cursor});
+    if (it == entries.end()) {
+        misses++;
+        return nullptr;
+    }
+    if (it->second->version != version) {
+        eraseLocked(it);  // The timeline's inputs changed since this was built
+        misses++;
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    hits++;
+    return it->second->response;
+}
+
+std::shared_ptr<const TimelineResponseCache::Response> TimelineResponseCache::store(
+    const BuildScope& build, const std::string& username, int64_t cursor, uint64_t version, std::string body,
+    const std::vector<int64_t>& postIds) {
+    auto response = std::make_shared<Response>();
+    response->etag = makeEtag(body);
+    response->body = std::move(body);
+    response->nextCursor = postIds.empty() ? 0 : postIds.back();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::unordered_set<int64_t>& changed = *build.invalidated;
+    if (!changed.empty() && std::any_of(postIds.begin(), postIds.end(),
+                                        [&changed](int64_t postId) { return changed.count(postId) != 0; })) {
+        raced++;  // The body may show the post as it was before the change
+        return response;
+    }
+    Key key{username, cursor};
+    auto existing = entries.find(key);
+    if (existing != entries.end()) {
+        eraseLocked(existing);
+    }
+    for (int64_t postId : postIds) {
+        pagesByPost[postId].push_back(key);
+    }
+    bytes += response->body.size();
+    lru.push_front(Entry{key, version, response, postIds});
+    entries.emplace(std::move(key), lru.begin());
+
+    while (entries.size() > kCapacity) {
+        eraseLocked(entries.find(lru.back().key));
+    }
+    return response;
+}
+
+void TimelineResponseCache::invalidatePost(int64_t postId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& invalidated : building) {
+        invalidated.insert(postId);
+    }
+    auto pages = pagesByPost.find(postId);
+    if (pages == pagesByPost.end()) {
+        return;
+    }
+    std::vector<Key> keys = std::move(pages->second);
+    pagesByPost.erase(pages);
+    for (const Key& key : keys) {
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            eraseLocked(it);
+            invalidations++;
+        }
+    }
+}
+
+TimelineResponseCache::Stats TimelineResponseCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return Stats{hits, misses, invalidations, raced, entries.size(), bytes};
+}
+
+std::string TimelineResponseCache::makeEtag(const std::string& body) {
+    // FNV-1a; only needs to tell versions of the same page apart
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : body) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    char etag[20];
+    std::snprintf(etag, sizeof(etag), "\"%016llx\"", static_cast<unsigned long long>(hash));
+    return etag;
+}
+
+void TimelineResponseCache::eraseLocked(std::unordered_map<Key, std::list<Entry>::iterator, KeyHash>::iterator it) {
+    const Entry& entry = *it->second;
+    for (int64_t postId : entry.postIds) {
+        auto pages = pagesByPost.find(postId);
+        if (pages == pagesByPost.end()) {
+            continue;
+        }
+        auto& keys = pages->second;
+        keys.erase(std::remove(keys.begin(), keys.end(), entry.key), keys.end());
+        if (keys.empty()) {
+            pagesByPost.erase(pages);
+        }
+    }
+    bytes -= entry.response->body.size();
+    lru.erase(it->second);
+    entries.erase(it);
+}
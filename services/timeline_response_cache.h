@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Serialized timeline responses, keyed by (user, cursor, version), so a repeat load or a
+// refresh click skips building and dumping the JSON and can be answered 304 by ETag.
+//
+// The version is TimelinePrecomputer's per-user version, which moves whenever the set of
+// posts a timeline draws from changes. Changes to a post already on a page (likes,
+// comments, edits, deletes) come through PostStore's invalidation listener and drop every
+// cached page containing that post. A page is built inside a BuildScope, so a change that
+// lands between reading its posts and storing it keeps the page out of the cache instead of
+// being missed. Entries are evicted least recently used first.
+class TimelineResponseCache {
+public:
+    struct Response {
+        std::string body;
+        std::string etag;      // Quoted strong validator, a hash of body
+        int64_t nextCursor;    // Id of the oldest post on the page, 0 if the page is empty
+    };
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t invalidations;
+        uint64_t raced;        // Pages not cached because one of their posts changed during the build
+        size_t entries;
+        size_t bytes;
+    };
+
+    // Open from before a page's posts are read until it is stored; every post invalidated
+    // meanwhile is noted against it
+    class BuildScope {
+    public:
+        BuildScope();
+        ~BuildScope();
+        BuildScope(const BuildScope&) = delete;
+        BuildScope& operator=(const BuildScope&) = delete;
+
+    private:
+        friend class TimelineResponseCache;
+        std::list<std::unordered_set<int64_t>>::iterator invalidated;
+    };
+
+    static TimelineResponseCache& instance();
+
+    // The cached response for this key, or nullptr
+    std::shared_ptr<const Response> find(const std::string& username, int64_t cursor, uint64_t version);
+
+    // Caches body, built from the posts postIds at the given version within build, and
+    // returns the entry. If one of postIds was invalidated during the build the response is
+    // returned without being cached.
+    std::shared_ptr<const Response> store(const BuildScope& build, const std::string& username, int64_t cursor,
+                                          uint64_t version, std::string body, const std::vector<int64_t>& postIds);
+
+    // Drops every cached page that contains postId
+    void invalidatePost(int64_t postId);
+
+    Stats stats() const;
+
+    static std::string makeEtag(const std::string& body);
+
+private:
+    static constexpr size_t kCapacity = 2048;
+
+    struct Key {
+        std::string username;
+        int64_t cursor;
+        bool operator==(const Key& other) const { return cursor == other.cursor && username == other.username; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Key key;
+        uint64_t version;
+        std::shared_ptr<const Response> response;
+        std::vector<int64_t> postIds;
+    };
+
+    TimelineResponseCache();
+
+    mutable std::mutex mutex;
+    std::list<Entry> lru;  // Most recently used at the front
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> entries;
+    std::unordered_map<int64_t, std::vector<Key>> pagesByPost;
+    std::list<std::unordered_set<int64_t>> building;  // Posts invalidated during each open BuildScope
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+    uint64_t raced;
+
+    void eraseLocked(std::unordered_map<Key, std::list<Entry>::iterator, KeyHash>::iterator it);
+};
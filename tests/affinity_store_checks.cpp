@@ -0,0 +1,29 @@
+#include "checks.h"
+#include "../services/affinity_store.h"
+
+// Taking back an interaction nobody tracked leaves no trace, and with nowhere to write them
+// changed pairs aren't kept for a flush
+CHECK_CASE(affinity_store_bookkeeping) {
+    AffinityStore& store = AffinityStore::instance();
+    AffinityStore::Stats before = store.stats();
+    store.record("aff_viewer", "aff_author", -AffinityStore::kLikeWeight);
+    CHECK_EQ(store.stats().viewers, before.viewers);
+
+    store.record("aff_viewer", "aff_author", AffinityStore::kLikeWeight);
+    store.record("aff_viewer", "aff_other", -AffinityStore::kLikeWeight);
+    CHECK_EQ(store.stats().viewers, before.viewers + 1);
+    CHECK_EQ(store.stats().pairs, before.pairs + 1);
+    CHECK(store.affinity("aff_viewer", "aff_author") > 0);
+    CHECK_EQ(store.stats().pending, before.pending + 1);
+
+    sqlite3* db = checks::openSchemaDb();  // No file, so no persistence
+    store.start(db);
+    CHECK_EQ(store.stats().pending, size_t(0));
+    for (int i = 0; i < 100; i++) {
+        store.record("aff_viewer" + std::to_string(i), "aff_author", AffinityStore::kCommentWeight);
+    }
+    CHECK_EQ(store.stats().pending, size_t(0));
+    CHECK_EQ(store.stats().viewers, before.viewers + 101);
+    store.stop();
+    sqlite3_close(db);
+}
@@ -0,0 +1,169 @@
+#include "checks.h"
+#include "../services/AVLtree.h"
+#include "../services/BST.h"
+#include "../services/BalancedTree.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <type_traits>
+
+namespace {
+    using IntTree = BalancedTree<int, int>;
+    static_assert(std::is_same<decltype(std::declval<const IntTree&>().find(0)), const IntTree::Node*>::value,
+                  "a const tree must not hand out mutable nodes");
+    static_assert(std::is_same<decltype(std::declval<IntTree&>().find(0)), IntTree::Node*>::value,
+                  "a non-const tree hands out mutable nodes");
+
+    template <typename Tree>
+    std::vector<int> keysOf(const Tree& tree) {
+        std::vector<int> keys;
+        for (auto it = tree.begin(); it != tree.end(); ++it) {
+            keys.push_back(it->key);
+        }
+        return keys;
+    }
+
+    // Short keys stay inside the small-string buffer, so allocations counted below are nodes
+    std::string keyFor(uint64_t n) {
+        return "u" + std::to_string(n % 100000000);
+    }
+
+    template <typename Tree>
+    void benchTree(const char* name, const std::vector<std::string>& keys) {
+        size_t n = keys.size();
+        double insert = 0, find = 0, erase = 0;
+        size_t allocationsBefore = checks::allocations();
+        {
+            Tree tree;
+            insert = checks::timePerCall(n, [&, i = size_t(0)]() mutable { tree.insert(keys[i++]); });
+            size_t hits = 0;
+            find = checks::timePerCall(n, [&, i = size_t(0)]() mutable { hits += tree.contains(keys[i++]); });
+            checks::keep(hits);
+            erase = checks::timePerCall(n, [&, i = size_t(0)]() mutable { tree.erase(keys[i++]); });
+        }
+        double allocsPerKey = double(checks::allocations() - allocationsBefore) / n;
+        std::cout << std::left << std::setw(14) << name << std::right << std::setw(10) << n << std::fixed
+                  << std::setprecision(3) << std::setw(12) << insert << std::setw(12) << find << std::setw(12)
+                  << erase << std::setprecision(2) << std::setw(12) << allocsPerKey << std::endl;
+    }
+
+    using PooledTree = BalancedTree<std::string, NoValue, std::less<std::string>, NodePoolAllocator<std::string>>;
+    using HeapTree = BalancedTree<std::string>;
+
+    // std::set with the same insert/contains/erase spelling, as the reference
+    struct StdSet {
+        std::set<std::string> keys;
+        void insert(const std::string& key) { keys.insert(key); }
+        bool contains(const std::string& key) const { return keys.count(key) != 0; }
+        void erase(const std::string& key) { keys.erase(key); }
+    };
+}
+
+// Each duplicate policy against std::multiset / std::map, through random inserts and erases,
+// with the AVL height bound and subtree sizes checked at the end
+CHECK_CASE(balanced_tree_policies) {
+    BalancedTree<int, int, std::less<int>, NodePoolAllocator<int>, RejectDuplicates, SubtreeSizeAugmentation> reject;
+    BalancedTree<int, int, std::less<int>, NodePoolAllocator<int>, ReplaceDuplicates> replace;
+    BalancedTree<int, int, std::less<int>, std::allocator<int>, AllowDuplicates> allow;
+    std::map<int, int> first, last;
+    std::multiset<int> all;
+    std::mt19937_64 rng(29);
+
+    for (int step = 0; step < 40000; step++) {
+        int key = (int)(rng() % 3000);
+        if (rng() % 4 == 0) {
+            CHECK_EQ(reject.erase(key), first.erase(key) == 1);
+            CHECK_EQ(replace.erase(key), last.erase(key) == 1);
+            auto it = all.find(key);
+            CHECK_EQ(allow.erase(key), it != all.end());
+            if (it != all.end()) {
+                all.erase(it);
+            }
+        } else {
+            CHECK_EQ(reject.insert(key, step).second, first.emplace(key, step).second);
+            replace.insert(key, step);
+            last[key] = step;
+            allow.insert(key, step);
+            all.insert(key);
+        }
+    }
+
+    CHECK_EQ(reject.size(), first.size());
+    CHECK_EQ(replace.size(), last.size());
+    CHECK_EQ(allow.size(), all.size());
+    CHECK(keysOf(allow) == std::vector<int>(all.begin(), all.end()));
+    for (const auto& entry : first) {
+        const auto& constReject = reject;
+        const auto* node = constReject.find(entry.first);
+        CHECK(node != nullptr);
+        CHECK_EQ(node->value, entry.second);
+    }
+    for (const auto& entry : last) {
+        CHECK_EQ(replace.find(entry.first)->value, entry.second);
+    }
+    CHECK(reject.find(-1) == nullptr);
+
+    // Writing through the non-const find is visible to later reads
+    replace.find(last.begin()->first)->value = -7;
+    CHECK_EQ(replace.find(last.begin()->first)->value, -7);
+
+    // AVL: height <= 1.44 log2(n + 2)
+    int height = reject.rootNode() ? reject.rootNode()->height : 0;
+    CHECK(height <= 1.45 * std::log2(double(reject.size()) + 2));
+    CHECK_EQ(reject.rootNode()->augment.count, reject.size());
+}
+
+// The string trees built on BalancedTree keep their old behaviour
+CHECK_CASE(balanced_tree_wrappers) {
+    AVLTree avl;
+    BST bst;
+    std::set<std::string> model;
+    std::mt19937_64 rng(290);
+    for (int step = 0; step < 5000; step++) {
+        std::string key = keyFor(rng() % 2000);
+        avl.insert(key);
+        bst.insert(key);
+        model.insert(key);
+        if (step % 5 == 0) {
+            std::string gone = keyFor(rng() % 2000);
+            avl.remove(gone);
+            CHECK(!avl.search(gone));
+        }
+    }
+    CHECK(bst.inOrder() == std::vector<std::string>(model.begin(), model.end()));
+    for (const char* prefix : {"u1", "u19", "u7", "u1999", "x", ""}) {
+        std::vector<std::string> expected;
+        for (const std::string& key : model) {
+            if (key.compare(0, std::strlen(prefix), prefix) == 0) {
+                expected.push_back(key);
+            }
+        }
+        CHECK(bst.prefixSearch(prefix) == expected);
+    }
+    std::vector<std::string> avlKeys = avl.inOrder();
+    CHECK(std::is_sorted(avlKeys.begin(), avlKeys.end()));
+    CHECK_EQ(avl.levelOrder().size(), avlKeys.size());
+}
+
+// Per-operation microseconds for n random string keys (default 1K, 100K and 1M): the pooled
+// tree that AVLTree, BST, PostAVLTree and UserSearchBST use, the same tree on
+// std::allocator (one heap node per key, as the hand-written trees had) and std::set.
+// allocs/key counts every heap allocation made while building, probing and emptying.
+BENCH_CASE(balanced_tree_bench) {
+    std::cout << "tree               keys   insert-us     find-us    erase-us  allocs/key" << std::endl;
+    for (size_t n : checks::sizes(args, {1000, 100000, 1000000})) {
+        std::mt19937_64 rng(n);
+        std::vector<std::string> keys(n);
+        for (std::string& key : keys) {
+            key = keyFor(rng());
+        }
+        benchTree<PooledTree>("pool", keys);
+        benchTree<HeapTree>("std::allocator", keys);
+        benchTree<StdSet>("std::set", keys);
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <sqlite3.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Correctness checks and benchmarks, all linked into the one `checks` binary.
+//
+// CHECK_CASE(name) defines a check: it runs under ctest and fails through CHECK/CHECK_EQ.
+// BENCH_CASE(name) defines a benchmark: it only runs when named on the command line,
+// and reads its sizes from the remaining arguments (see checks::sizes).
+//
+//   checks                      every check
+//   checks <name> [args...]     one check or benchmark
+//   checks --list               names of everything registered
+namespace checks {
+    using Args = std::vector<std::string>;
+
+    struct Case {
+        const char* name;
+        void (*run)(const Args& args);
+        bool bench;
+    };
+
+    std::vector<Case>& registry();
+
+    struct Registrar {
+        Registrar(const char* name, void (*run)(const Args& args), bool bench) {
+            registry().push_back(Case{name, run, bench});
+        }
+    };
+
+    // Thrown by CHECK; main reports it and moves on to the next case
+    struct Failure {
+        std::string message;
+    };
+
+    [[noreturn]] void fail(const char* file, int line, const std::string& message);
+
+    // Sizes given on the command line, or fallback if there are none
+    std::vector<size_t> sizes(const Args& args, std::vector<size_t> fallback);
+
+    // Microseconds since start
+    inline double micros(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Calls f() reps times and returns the mean microseconds per call
+    template <typename F>
+    double timePerCall(size_t reps, F f) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < reps; i++) {
+            f();
+        }
+        return micros(start) / (reps ? reps : 1);
+    }
+
+    // Heap allocations made by this thread so far (operator new is counted in checks_main.cpp)
+    size_t allocations();
+
+    // Bytes requested from operator new by this thread so far
+    size_t allocatedBytes();
+
+    // Fresh database with database/schema.sql applied, in memory unless a file path is given.
+    // Fails the case on error.
+    sqlite3* openSchemaDb(const std::string& path = ":memory:");
+
+    // Runs sql on db, failing the case on error
+    void exec(sqlite3* db, const std::string& sql);
+
+    // Runs action once, from inside the next SQLite statement executed on db: for code that
+    // reads with its lock released, a way to land a write in the middle of that read.
+    // action must not use db itself.
+    class DuringNextQuery {
+    public:
+        DuringNextQuery(sqlite3* db, std::function<void()> action) : db(db), action(std::move(action)) {
+            sqlite3_progress_handler(db, 1, &DuringNextQuery::fire, this);
+        }
+        ~DuringNextQuery() { sqlite3_progress_handler(db, 0, nullptr, nullptr); }
+
+    private:
+        sqlite3* db;
+        std::function<void()> action;
+
+        static int fire(void* self) {
+            auto* during = static_cast<DuringNextQuery*>(self);
+            if (during->action) {
+                std::function<void()> action = std::move(during->action);
+                during->action = nullptr;
+                action();
+            }
+            return 0;
+        }
+    };
+
+    // Keeps the optimizer from discarding a benchmark result
+    template <typename T>
+    inline void keep(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+}
+
+#define CHECK_CASE(name)                                                               \
+    static void check_##name(const checks::Args& args);                                \
+    static checks::Registrar registrar_##name(#name, check_##name, false);             \
+    static void check_##name([[maybe_unused]] const checks::Args& args)
+
+#define BENCH_CASE(name)                                                               \
+    static void bench_##name(const checks::Args& args);                                \
+    static checks::Registrar registrar_##name(#name, bench_##name, true);              \
+    static void bench_##name([[maybe_unused]] const checks::Args& args)
+
+#define CHECK(cond)                                                                    \
+    do {                                                                               \
+        if (!(cond)) checks::fail(__FILE__, __LINE__, #cond);                          \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                 \
+    do {                                                                               \
+        auto&& checkA_ = (a);                                                          \
+        auto&& checkB_ = (b);                                                          \
+        if (!(checkA_ == checkB_)) {                                                   \
+            std::ostringstream checkOut_;                                              \
+            checkOut_ << #a " == " #b " (" << checkA_ << " vs " << checkB_ << ")";     \
+            checks::fail(__FILE__, __LINE__, checkOut_.str());                         \
+        }                                                                              \
+    } while (0)
@@ -0,0 +1,124 @@
+#include "checks.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+namespace {
+    thread_local size_t allocationCount = 0;
+    thread_local size_t allocationBytes = 0;
+}
+
+// Counted so benchmarks can report allocations per operation
+void* operator new(size_t size) {
+    allocationCount++;
+    allocationBytes += size;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace checks {
+    std::vector<Case>& registry() {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    void fail(const char* file, int line, const std::string& message) {
+        throw Failure{std::string(file) + ":" + std::to_string(line) + ": " + message};
+    }
+
+    std::vector<size_t> sizes(const Args& args, std::vector<size_t> fallback) {
+        if (args.empty()) {
+            return fallback;
+        }
+        std::vector<size_t> given;
+        for (const std::string& arg : args) {
+            given.push_back(std::strtoull(arg.c_str(), nullptr, 10));
+        }
+        return given;
+    }
+
+    size_t allocations() {
+        return allocationCount;
+    }
+
+    size_t allocatedBytes() {
+        return allocationBytes;
+    }
+
+    void exec(sqlite3* db, const std::string& sql) {
+        char* error = nullptr;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+            std::string message = error ? error : "unknown error";
+            sqlite3_free(error);
+            fail(__FILE__, __LINE__, "SQL failed: " + message);
+        }
+    }
+
+    sqlite3* openSchemaDb(const std::string& path) {
+        std::ifstream schemaFile(CHECKS_SCHEMA_PATH);
+        std::stringstream schema;
+        schema << schemaFile.rdbuf();
+        if (schema.str().empty()) {
+            fail(__FILE__, __LINE__, "can't read " CHECKS_SCHEMA_PATH);
+        }
+        sqlite3* db = nullptr;
+        if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+            fail(__FILE__, __LINE__, "can't open " + path);
+        }
+        exec(db, schema.str());
+        return db;
+    }
+}
+
+static bool runCase(const checks::Case& c, const checks::Args& args) {
+    try {
+        c.run(args);
+    } catch (const checks::Failure& failure) {
+        std::cerr << "FAIL " << c.name << ": " << failure.message << std::endl;
+        return false;
+    } catch (const std::exception& e) {
+        std::cerr << "FAIL " << c.name << ": exception: " << e.what() << std::endl;
+        return false;
+    }
+    std::cout << "ok   " << c.name << std::endl;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--list") == 0) {
+        for (const checks::Case& c : checks::registry()) {
+            std::cout << (c.bench ? "bench " : "check ") << c.name << std::endl;
+        }
+        return 0;
+    }
+    if (argc > 1) {
+        checks::Args args(argv + 2, argv + argc);
+        for (const checks::Case& c : checks::registry()) {
+            if (std::strcmp(c.name, argv[1]) == 0) {
+                return runCase(c, args) ? 0 : 1;
+            }
+        }
+        std::cerr << "No check or benchmark named " << argv[1] << std::endl;
+        return 2;
+    }
+    int failed = 0;
+    for (const checks::Case& c : checks::registry()) {
+        if (!c.bench && !runCase(c, {})) {
+            failed++;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
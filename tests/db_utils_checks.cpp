@@ -0,0 +1,126 @@
+#include "checks.h"
+#include "../database/db_utils.h"
+#include <ctime>
+#include <iostream>
+
+namespace {
+    const int64_t kBaseMillis = 1709251200000;  // 2024-03-01 00:00:00 UTC
+    const int kPosts = 2500;                     // More than two of the migration's batches
+
+    std::string dateTime(int64_t millis) {
+        std::time_t seconds = static_cast<std::time_t>(millis / 1000);
+        std::tm tm{};
+        gmtime_r(&seconds, &tm);
+        char text[32];
+        std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &tm);
+        return text;
+    }
+
+    int64_t queryInt(sqlite3* db, const std::string& sql) {
+        sqlite3_stmt* stmt;
+        CHECK(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK);
+        int64_t value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+        sqlite3_finalize(stmt);
+        return value;
+    }
+
+    // The tables as the schema declared them before created_at held epoch milliseconds
+    void createLegacyTables(sqlite3* db) {
+        checks::exec(db, R"(
+            CREATE TABLE users (id INTEGER PRIMARY KEY, username TEXT UNIQUE, password_hash TEXT,
+                                profile_pic TEXT, bio TEXT, created_at DATETIME DEFAULT CURRENT_TIMESTAMP);
+            CREATE TABLE posts (id INTEGER PRIMARY KEY, user_id INTEGER, content TEXT, like_count INTEGER DEFAULT 0,
+                                comment_count INTEGER DEFAULT 0, created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                                FOREIGN KEY (user_id) REFERENCES users (id));
+            CREATE TABLE likes (user_id INTEGER, post_id INTEGER, created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                                PRIMARY KEY (user_id, post_id));
+            CREATE TABLE comments (id INTEGER PRIMARY KEY, post_id INTEGER, user_id INTEGER, content TEXT,
+                                   created_at DATETIME DEFAULT CURRENT_TIMESTAMP);
+            CREATE TABLE friends (id INTEGER PRIMARY KEY, requester_id INTEGER, addressee_id INTEGER,
+                                  status TEXT CHECK (status IN ('pending', 'accepted', 'declined')),
+                                  created_at DATETIME DEFAULT CURRENT_TIMESTAMP);
+            CREATE TABLE notifications (id INTEGER PRIMARY KEY, user_id INTEGER, type TEXT, reference_id INTEGER,
+                                        message TEXT, is_read BOOLEAN DEFAULT 0,
+                                        created_at DATETIME DEFAULT CURRENT_TIMESTAMP);
+        )");
+    }
+}
+
+// Text created_at rows across several batches become the epoch ms they name, the old
+// CURRENT_TIMESTAMP defaults are replaced, and the migration runs only once
+CHECK_CASE(db_utils_timestamp_migration) {
+    sqlite3* db;
+    CHECK(sqlite3_open(":memory:", &db) == SQLITE_OK);
+    createLegacyTables(db);
+
+    checks::exec(db, "BEGIN");
+    for (int i = 0; i < kPosts; i++) {
+        checks::exec(db, "INSERT INTO posts (id, user_id, content, created_at) VALUES (" + std::to_string(i + 1) +
+                             ", 1, 'p', '" + dateTime(kBaseMillis + i * 37000LL) + "')");
+    }
+    checks::exec(db, "COMMIT");
+    checks::exec(db, "INSERT INTO comments (id, post_id, user_id, content, created_at) VALUES (1, 1, 1, 'c', '" +
+                         dateTime(kBaseMillis) + "')");
+    checks::exec(db, "INSERT INTO friends (requester_id, addressee_id, status) VALUES (1, 2, 'accepted')");
+    checks::exec(db, "INSERT INTO likes (user_id, post_id, created_at) VALUES (1, 1, 'not a date')");
+    CHECK_EQ(queryInt(db, "PRAGMA user_version"), int64_t(0));
+
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    bool migrated = migrateTimestampsToEpochMillis(db);
+    std::cout.rdbuf(out);
+    CHECK(migrated);
+    CHECK_EQ(queryInt(db, "PRAGMA user_version"), int64_t(kSchemaVersionEpochMillis));
+
+    CHECK_EQ(queryInt(db, "SELECT COUNT(*) FROM posts WHERE typeof(created_at) != 'integer'"), int64_t(0));
+    sqlite3_stmt* stmt;
+    CHECK(sqlite3_prepare_v2(db, "SELECT id, created_at FROM posts ORDER BY id", -1, &stmt, nullptr) == SQLITE_OK);
+    int rows = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        CHECK_EQ(sqlite3_column_int64(stmt, 1), kBaseMillis + (sqlite3_column_int64(stmt, 0) - 1) * 37000);
+        rows++;
+    }
+    sqlite3_finalize(stmt);
+    CHECK_EQ(rows, kPosts);
+    CHECK_EQ(queryInt(db, "SELECT created_at FROM comments"), kBaseMillis);
+    CHECK_EQ(queryInt(db, "SELECT typeof(created_at) = 'integer' FROM friends"), int64_t(1));
+    CHECK_EQ(queryInt(db, "SELECT created_at IS NULL FROM likes"), int64_t(1));  // Unparseable
+
+    // Rows inserted without created_at now default to epoch ms; users keeps its text default
+    int64_t before = queryInt(db, "SELECT CAST((julianday('now') - 2440587.5) * 86400000 AS INTEGER)");
+    const char* tables[] = {"posts", "comments", "likes", "friends", "notifications"};
+    for (const char* table : tables) {
+        checks::exec(db, std::string("INSERT INTO ") + table + " DEFAULT VALUES");
+        std::string newest = std::string("SELECT created_at FROM ") + table + " ORDER BY rowid DESC LIMIT 1";
+        CHECK_EQ(queryInt(db, "SELECT typeof(created_at) = 'integer' FROM (" + newest + ")"), int64_t(1));
+        CHECK(queryInt(db, newest) >= before - 1000);
+    }
+    checks::exec(db, "INSERT INTO users (username) VALUES ('legacy')");
+    CHECK_EQ(queryInt(db, "SELECT typeof(created_at) = 'text' FROM users"), int64_t(1));
+    CHECK_EQ(queryInt(db, "SELECT COUNT(*) FROM pragma_quick_check WHERE quick_check != 'ok'"), int64_t(0));
+
+    // A second run sees the version and leaves even new text rows alone
+    checks::exec(db, "INSERT INTO comments (id, post_id, user_id, content, created_at) VALUES (100, 1, 1, 'c', '" +
+                         dateTime(kBaseMillis) + "')");
+    CHECK(migrateTimestampsToEpochMillis(db));
+    CHECK_EQ(queryInt(db, "SELECT typeof(created_at) = 'text' FROM comments WHERE id = 100"), int64_t(1));
+    CHECK_EQ(queryInt(db, "PRAGMA user_version"), int64_t(kSchemaVersionEpochMillis));
+    sqlite3_close(db);
+}
+
+// Integer epoch ms and legacy DATETIME text read back as the same seconds
+CHECK_CASE(db_utils_column_epoch_seconds) {
+    sqlite3* db = checks::openSchemaDb();
+    std::string sql = "SELECT " + std::to_string(kBaseMillis + 1999) + ", '" + dateTime(kBaseMillis + 1000) +
+                      "', -1, 'garbage', NULL, '" + dateTime(0) + "'";
+    sqlite3_stmt* stmt;
+    CHECK(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK);
+    CHECK(sqlite3_step(stmt) == SQLITE_ROW);
+    CHECK_EQ(columnEpochSeconds(stmt, 0), std::time_t(kBaseMillis / 1000 + 1));
+    CHECK_EQ(columnEpochSeconds(stmt, 1), std::time_t(kBaseMillis / 1000 + 1));
+    CHECK_EQ(columnEpochSeconds(stmt, 2), std::time_t(-1));  // Floors, not truncates
+    CHECK_EQ(columnEpochSeconds(stmt, 3), std::time_t(0));
+    CHECK_EQ(columnEpochSeconds(stmt, 4), std::time_t(0));
+    CHECK_EQ(columnEpochSeconds(stmt, 5), std::time_t(0));
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+}
@@ -0,0 +1,147 @@
+#include "checks.h"
+#include "../services/dynamic_timeline_service.h"
+#include "../services/post_store.h"
+#include <iomanip>
+#include <ctime>
+#include <iostream>
+#include <unistd.h>
+
+namespace {
+    // A file-backed database (the parallel fetch needs a path to open) with user 1, 'dt_user',
+    // befriended by users 2 to friends + 1, each with postsEach posts. Ids interleave authors.
+    sqlite3* openTimelineDb(const std::string& path, int friends, int postsEach) {
+        unlink(path.c_str());
+        sqlite3* db = checks::openSchemaDb(path);
+        checks::exec(db, "BEGIN;");
+        for (int u = 1; u <= friends + 1; u++) {
+            checks::exec(db, "INSERT INTO users (id, username) VALUES (" + std::to_string(u) + ", 'dt_user" +
+                                 (u == 1 ? std::string() : std::to_string(u)) + "');");
+            if (u > 1) {
+                checks::exec(db, "INSERT INTO friends (requester_id, addressee_id, status) VALUES (1, " +
+                                     std::to_string(u) + ", 'accepted');");
+            }
+        }
+        int64_t id = 1;
+        for (int p = 0; p < postsEach; p++) {
+            for (int u = 1; u <= friends + 1; u++) {
+                checks::exec(db, "INSERT INTO posts (id, user_id, content) VALUES (" + std::to_string(id++) + ", " +
+                                     std::to_string(u) + ", 'post');");
+            }
+        }
+        checks::exec(db, "COMMIT;");
+        return db;
+    }
+
+    std::vector<int64_t> newestIds(sqlite3* db, int limit) {
+        std::vector<int64_t> ids;
+        sqlite3_stmt* stmt;
+        sqlite3_prepare_v2(db, "SELECT id FROM posts ORDER BY id DESC LIMIT ?", -1, &stmt, nullptr);
+        sqlite3_bind_int(stmt, 1, limit);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            ids.push_back(sqlite3_column_int64(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+        return ids;
+    }
+
+    std::vector<int64_t> pageIds(DynamicTimelineService& service, int limit) {
+        std::streambuf* out = std::cout.rdbuf(nullptr);  // The service narrates every build
+        std::vector<Post> page = service.generateDynamicTimeline("dt_user", limit);
+        std::cout.rdbuf(out);
+        std::vector<int64_t> ids;
+        for (const Post& post : page) {
+            ids.push_back(post.getId());
+        }
+        return ids;
+    }
+}
+
+// Workers that can't open their own read connection leave their friends to the caller, who
+// fetches them on its connection: the page is the same as when every worker reads
+CHECK_CASE(dynamic_timeline_worker_fallback) {
+    std::string path = "/tmp/checks_dynamic_timeline_" + std::to_string(getpid()) + ".db";
+    sqlite3* db = openTimelineDb(path, 12, 5);
+    unlink(path.c_str());  // db stays usable; opening the path read-only now fails
+    DynamicTimelineService::setFetchThreads(4);
+    PostStore::instance().clear();
+
+    DynamicTimelineService service(db);
+    std::vector<int64_t> expected = newestIds(db, 30);
+    CHECK_EQ(expected.size(), size_t(30));
+    CHECK(pageIds(service, 30) == expected);
+
+    PostStore::instance().clear();
+    sqlite3_close(db);
+}
+
+// Posting rates for authors whose posts predate generated ids come from created_at, on a
+// first page and on a page behind a legacy cursor: one post an hour reads as about 1/hour
+CHECK_CASE(dynamic_timeline_legacy_rates) {
+    sqlite3* db = checks::openSchemaDb();
+    checks::exec(db, "INSERT INTO users (id, username) VALUES (1, 'dtl_reader'), (2, 'dtl_first'), (3, 'dtl_paged');"
+                     "INSERT INTO friends (requester_id, addressee_id, status) VALUES (1, 2, 'accepted'), "
+                     "(1, 3, 'accepted');");
+    int64_t now = (int64_t)std::time(nullptr) * 1000;
+    const int64_t kHour = 3600000;
+    // Rowids follow creation order. dtl_paged: ids 1-20, one an hour from 120 hours ago.
+    // dtl_first: ids 21-30, one an hour from 10 hours ago.
+    for (int k = 1; k <= 30; k++) {
+        int64_t createdAt = k <= 20 ? now - (121 - k) * kHour : now - (31 - k) * kHour;
+        checks::exec(db, "INSERT INTO posts (id, user_id, content, created_at) VALUES (" + std::to_string(k) + ", " +
+                             (k <= 20 ? "3" : "2") + ", 'p', " + std::to_string(createdAt) + ");");
+    }
+    PostStore::instance().clear();
+    DynamicTimelineService service(db);
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    std::vector<Post> first = service.generateDynamicTimeline("dtl_reader", 50);
+    std::cout.rdbuf(out);
+    CHECK_EQ(first.size(), size_t(30));
+    double rate = DynamicTimelineService::postingRate("dtl_first");
+    CHECK(rate > 0.5 && rate < 2.0);
+
+    // Behind id 11 (made 110 hours ago): ids 1-10, made 111 to 120 hours ago
+    DynamicTimelineService::FetchStats before = DynamicTimelineService::fetchStats();
+    out = std::cout.rdbuf(nullptr);
+    std::vector<Post> older = service.generateDynamicTimeline("dtl_reader", 50, nullptr, 11);
+    std::cout.rdbuf(out);
+    CHECK_EQ(older.size(), size_t(10));
+    CHECK_EQ(DynamicTimelineService::fetchStats().timelines, before.timelines + 1);
+    // Smoothed with the first page's 20 posts over 120 hours
+    rate = DynamicTimelineService::postingRate("dtl_paged");
+    CHECK(rate > 0.1 && rate < 2.0);
+
+    PostStore::instance().clear();
+    sqlite3_close(db);
+}
+
+// Microseconds per first page of 50 with its posts not yet cached, for a user with n friends
+// (default 300) of 40 posts each, with the friends fetched on 1 to 16 threads
+BENCH_CASE(dynamic_timeline_bench) {
+    std::cout << "friends  threads  cold-page-us  warm-page-us" << std::endl;
+    for (size_t n : checks::sizes(args, {300})) {
+        std::string path = "/tmp/checks_dynamic_timeline_bench_" + std::to_string(getpid()) + ".db";
+        sqlite3* db = openTimelineDb(path, (int)n, 40);
+        std::vector<int64_t> expected = newestIds(db, 50);
+        DynamicTimelineService service(db);
+        for (size_t threads : {1, 2, 4, 8, 16}) {
+            DynamicTimelineService::setFetchThreads(threads);
+            pageIds(service, 50);  // Opens the workers' read connections
+            const int kReps = 20;
+            double cold = 0;
+            for (int r = 0; r < kReps; r++) {
+                PostStore::instance().clear();
+                auto start = std::chrono::steady_clock::now();
+                if (pageIds(service, 50) != expected) {
+                    checks::fail(__FILE__, __LINE__, "wrong page on " + std::to_string(threads) + " threads");
+                }
+                cold += checks::micros(start);
+            }
+            double warm = checks::timePerCall(kReps, [&] { checks::keep(pageIds(service, 50).size()); });
+            std::cout << std::setw(7) << n << std::setw(9) << threads << std::fixed << std::setprecision(0)
+                      << std::setw(14) << cold / kReps << std::setw(14) << warm << std::endl;
+        }
+        PostStore::instance().clear();
+        sqlite3_close(db);
+        unlink(path.c_str());
+    }
+}
@@ -0,0 +1,24 @@
+#include "checks.h"
+#include "../services/feed_log.h"
+
+// With no file to write to, served pages aren't buffered, though the newest post each user
+// was shown is still known
+CHECK_CASE(feed_log_without_persistence) {
+    FeedLog& log = FeedLog::instance();
+    sqlite3* db = checks::openSchemaDb();
+    log.start(db);
+    FeedLog::Stats before = log.stats();
+    for (int64_t page = 0; page < 1000; page++) {
+        std::vector<int64_t> ids;
+        for (int64_t i = 0; i < 50; i++) {
+            ids.push_back(page * 50 + i + 1);
+        }
+        log.recordShown("feedlog_user" + std::to_string(page % 10), ids);
+    }
+    FeedLog::Stats after = log.stats();
+    CHECK_EQ(after.recorded, before.recorded + 50000);
+    CHECK_EQ(after.pending, size_t(0));
+    CHECK_EQ(log.lastSeenId(db, "feedlog_user9"), int64_t(50000));
+    log.stop();
+    sqlite3_close(db);
+}
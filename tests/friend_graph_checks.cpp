@@ -0,0 +1,157 @@
+#include "checks.h"
+#include "../services/friend_graph.h"
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+
+namespace {
+    std::string userName(int id) {
+        return "fg_user" + std::to_string(id);
+    }
+
+    void addUser(sqlite3* db, int id) {
+        checks::exec(db, "INSERT INTO users (id, username) VALUES (" + std::to_string(id) + ", '" + userName(id) + "')");
+    }
+
+    // Every query the graph answers, against the model for every user, and mutual friends
+    // for pairs of friends and of random users
+    void compare(const FriendGraph& graph, const std::map<int, std::set<int>>& model, int users, std::mt19937& rng) {
+        auto friendsIn = [&model](int id) {
+            auto it = model.find(id);
+            return it == model.end() ? std::set<int>() : it->second;
+        };
+        auto mutualIn = [&friendsIn](int a, int b) {
+            std::set<int> x = friendsIn(a), y = friendsIn(b);
+            std::vector<std::string> mutual;
+            for (int id : x) {
+                if (y.count(id)) {
+                    mutual.push_back(userName(id));
+                }
+            }
+            std::sort(mutual.begin(), mutual.end());
+            return mutual;
+        };
+
+        size_t edges = 0;
+        for (int id = 1; id <= users; id++) {
+            std::set<int> expected = friendsIn(id);
+            edges += expected.size();
+
+            std::vector<std::string> names = graph.friendsOf(userName(id));
+            std::vector<std::string> expectedNames;
+            for (int other : expected) {
+                expectedNames.push_back(userName(other));
+            }
+            std::sort(names.begin(), names.end());
+            std::sort(expectedNames.begin(), expectedNames.end());
+            CHECK(names == expectedNames);
+
+            std::vector<int64_t> ids = graph.friendIdsOf(userName(id));
+            std::sort(ids.begin(), ids.end());
+            CHECK((ids == std::vector<int64_t>(expected.begin(), expected.end())));
+
+            for (int other : expected) {
+                CHECK(graph.areFriends(userName(id), userName(other)));
+                CHECK(mutualIn(id, other) == graph.mutualFriends(userName(id), userName(other)));
+            }
+        }
+        CHECK_EQ(graph.stats().friendships, edges / 2);
+
+        std::uniform_int_distribution<int> pick(1, users);
+        for (int i = 0; i < 200; i++) {
+            int a = pick(rng), b = pick(rng);
+            CHECK_EQ(graph.areFriends(userName(a), userName(b)), a != b && friendsIn(a).count(b) > 0);
+            std::vector<std::string> mutual = mutualIn(a, b);
+            CHECK(mutual == graph.mutualFriends(userName(a), userName(b)));
+            CHECK_EQ(graph.mutualFriendCount(userName(a), userName(b)), mutual.size());
+        }
+    }
+}
+
+// Random adds and removes, some for users who joined after the load, agree with a set model
+// before and after the delta is folded into the CSR
+CHECK_CASE(friend_graph_model) {
+    std::mt19937 rng(46);
+    sqlite3* db = checks::openSchemaDb();
+    std::map<int, std::set<int>> model;
+
+    int users = 300;
+    for (int id = 1; id <= users; id++) {
+        addUser(db, id);
+    }
+    std::uniform_int_distribution<int> loaded(1, users);
+    for (int i = 0; i < 3000; i++) {
+        int a = loaded(rng), b = loaded(rng);
+        if (a == b || model[a].count(b)) {
+            continue;
+        }
+        // Both directions, and a pending row the graph must ignore
+        const char* status = i % 10 == 0 ? "pending" : "accepted";
+        checks::exec(db, "INSERT INTO friends (requester_id, addressee_id, status) VALUES (" + std::to_string(i % 2 ? a : b) +
+                             ", " + std::to_string(i % 2 ? b : a) + ", '" + status + "')");
+        if (i % 10 != 0) {
+            model[a].insert(b);
+            model[b].insert(a);
+        }
+    }
+
+    FriendGraph& graph = FriendGraph::instance();
+    graph.load(db);
+    CHECK(graph.loaded());
+    compare(graph, model, users, rng);
+
+    uint64_t compactionsBefore = graph.stats().compactions;
+    size_t delta = graph.stats().delta;
+    CHECK_EQ(delta, size_t(0));
+    for (int op = 0; op < 6000; op++) {
+        if (op % 500 == 499) {
+            addUser(db, ++users);  // The graph resolves them on their first friendship
+        }
+        std::uniform_int_distribution<int> pick(1, users);
+        int a = pick(rng), b = pick(rng);
+        if (op % 2 == 0) {
+            graph.addFriendship(db, userName(a), userName(b));
+            if (a != b) {
+                model[a].insert(b);
+                model[b].insert(a);
+            }
+        } else {
+            // Remove an existing friendship of a, so removals aren't mostly no-ops
+            if (!model[a].empty()) {
+                auto it = model[a].begin();
+                std::advance(it, std::uniform_int_distribution<size_t>(0, model[a].size() - 1)(rng));
+                b = *it;
+            }
+            graph.removeFriendship(userName(a), userName(b));
+            model[a].erase(b);
+            model[b].erase(a);
+        }
+        CHECK_EQ(graph.areFriends(userName(a), userName(b)), a != b && model[a].count(b) > 0);
+
+        FriendGraph::Stats stats = graph.stats();
+        size_t threshold = std::max<size_t>(1024, stats.friendships / 16);
+        if (stats.compactions != compactionsBefore) {
+            // Folded in exactly when this change took the delta to the threshold
+            CHECK_EQ(stats.compactions, compactionsBefore + 1);
+            CHECK_EQ(stats.delta, size_t(0));
+            CHECK(delta + 1 >= threshold);
+            compactionsBefore = stats.compactions;
+            compare(graph, model, users, rng);
+        } else {
+            CHECK(stats.delta < threshold);
+        }
+        delta = stats.delta;
+        if (op % 250 == 0) {
+            compare(graph, model, users, rng);
+        }
+    }
+    CHECK(graph.stats().compactions >= 2);
+    compare(graph, model, users, rng);
+
+    // Later checks read friendships from their own tables
+    graph.clear();
+    CHECK(!graph.loaded());
+    CHECK(graph.friendsOf(userName(1)).empty());
+    sqlite3_close(db);
+}
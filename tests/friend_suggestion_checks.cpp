@@ -0,0 +1,132 @@
+#include "checks.h"
+#include "../services/affinity_store.h"
+#include "../services/friend_graph.h"
+#include "../services/friend_suggestion_service.h"
+#include <algorithm>
+#include <map>
+#include <random>
+
+namespace {
+    using Suggestions = std::vector<std::pair<std::string, int>>;
+
+    // A database holding exactly these users and accepted friendships, with FriendGraph
+    // loaded from it
+    sqlite3* openGraph(const std::vector<std::string>& users, const std::vector<std::pair<std::string, std::string>>& friendships) {
+        sqlite3* db = checks::openSchemaDb();
+        checks::exec(db, "BEGIN");
+        std::map<std::string, int> ids;
+        for (const std::string& user : users) {
+            ids[user] = (int)ids.size() + 1;
+            checks::exec(db, "INSERT INTO users (id, username) VALUES (" + std::to_string(ids[user]) + ", '" + user + "')");
+        }
+        for (const auto& [a, b] : friendships) {
+            checks::exec(db, "INSERT INTO friends (requester_id, addressee_id, status) VALUES (" + std::to_string(ids[a]) +
+                                 ", " + std::to_string(ids[b]) + ", 'accepted')");
+        }
+        checks::exec(db, "COMMIT");
+        FriendGraph::instance().load(db);
+        return db;
+    }
+}
+
+// On a graph small enough for the scan to see every user, the two-hop walk ranks exactly as
+// the scan does, and mutualFriendCounts agrees with pairwise mutualFriendCount
+CHECK_CASE(friend_suggestion_matches_scan) {
+    std::mt19937 rng(47);
+    std::vector<std::string> users;
+    for (int i = 0; i < 30; i++) {
+        users.push_back("sug_u" + std::to_string(100 + i));
+    }
+    std::vector<std::pair<std::string, std::string>> friendships;
+    for (size_t a = 0; a < users.size(); a++) {
+        for (size_t b = a + 1; b < users.size(); b++) {
+            if (rng() % 100 < 12) {
+                friendships.emplace_back(users[a], users[b]);
+            }
+        }
+    }
+    sqlite3* db = openGraph(users, friendships);
+    FriendGraph& graph = FriendGraph::instance();
+    FriendSuggestionService service(db);
+
+    for (const std::string& viewer : users) {
+        Suggestions counted = graph.mutualFriendCounts(viewer);
+        std::map<std::string, int> expected;
+        for (const std::string& other : users) {
+            size_t mutual = graph.mutualFriendCount(viewer, other);
+            if (other != viewer && mutual > 0 && !graph.areFriends(viewer, other)) {
+                expected[other] = (int)mutual;
+            }
+        }
+        CHECK((std::map<std::string, int>(counted.begin(), counted.end()) == expected));
+        CHECK_EQ(counted.size(), expected.size());
+
+        // Affinity for some of the candidates, so ties on mutual friends break both ways
+        for (const auto& [candidate, mutual] : counted) {
+            if (rng() % 3 == 0) {
+                AffinityStore::instance().record(viewer, candidate, rng() % 2 ? AffinityStore::kLikeWeight
+                                                                               : AffinityStore::kCommentWeight);
+            }
+        }
+        size_t nonFriends = users.size() - 1 - graph.friendsOf(viewer).size();
+        for (size_t k : {1, 3, 5, 10, 40}) {
+            Suggestions walked = service.suggestFriends(viewer, (int)k);
+            CHECK(walked == service.scanSuggestions(viewer, (int)k));
+            CHECK_EQ(walked.size(), k < nonFriends ? k : nonFriends);
+        }
+    }
+    FriendGraph::instance().clear();
+    sqlite3_close(db);
+}
+
+// Equal mutual counts go to the candidate the viewer interacts with most, then by name, and
+// a short list is filled with users who share no friends, ranked the same way
+CHECK_CASE(friend_suggestion_ties_and_fill) {
+    sqlite3* db = openGraph({"tie_a", "tie_b", "tie_c", "tie_d", "tie_e", "tie_f1", "tie_f2", "tie_f3", "tie_v", "tie_y",
+                             "tie_z1", "tie_z2"},
+                            {{"tie_v", "tie_f1"}, {"tie_v", "tie_f2"}, {"tie_v", "tie_f3"},
+                             {"tie_a", "tie_f1"}, {"tie_a", "tie_f2"}, {"tie_b", "tie_f1"}, {"tie_b", "tie_f2"},
+                             {"tie_c", "tie_f1"}, {"tie_c", "tie_f2"}, {"tie_e", "tie_f3"}, {"tie_d", "tie_f3"}});
+    AffinityStore::instance().record("tie_v", "tie_c", AffinityStore::kCommentWeight);
+    AffinityStore::instance().record("tie_v", "tie_b", AffinityStore::kLikeWeight);
+    AffinityStore::instance().record("tie_v", "tie_z2", AffinityStore::kLikeWeight);
+    FriendSuggestionService service(db);
+
+    Suggestions expected = {{"tie_c", 2}, {"tie_b", 2}, {"tie_a", 2}, {"tie_d", 1}, {"tie_e", 1},
+                            {"tie_z2", 0}, {"tie_y", 0}, {"tie_z1", 0}};
+    CHECK(service.suggestFriends("tie_v", 10) == expected);
+    CHECK(service.scanSuggestions("tie_v", 10) == expected);
+    CHECK(service.suggestFriends("tie_v", 4) == Suggestions(expected.begin(), expected.begin() + 4));
+    CHECK(service.suggestFriends("tie_v", 6) == Suggestions(expected.begin(), expected.begin() + 6));
+    CHECK(service.suggestFriends("tie_v", 0).empty());
+    FriendGraph::instance().clear();
+    sqlite3_close(db);
+}
+
+// The scan only counted mutual friends for the first 500 users by name; the walk finds the
+// best candidate wherever their name sorts
+CHECK_CASE(friend_suggestion_beyond_alphabetic_scan) {
+    std::vector<std::string> users = {"far_f1", "far_f2", "far_f3", "far_v", "far_zed"};
+    for (int i = 0; i < 600; i++) {
+        users.push_back("far_m" + std::to_string(1000 + i));
+    }
+    sqlite3* db = openGraph(users, {{"far_v", "far_f1"}, {"far_v", "far_f2"}, {"far_v", "far_f3"},
+                                    {"far_zed", "far_f1"}, {"far_zed", "far_f2"}, {"far_zed", "far_f3"}});
+    FriendSuggestionService service(db);
+
+    Suggestions walked = service.suggestFriends("far_v", 5);
+    CHECK_EQ(walked.size(), size_t(5));
+    CHECK((walked.front() == std::pair<std::string, int>("far_zed", 3)));
+    for (size_t i = 1; i < walked.size(); i++) {
+        CHECK_EQ(walked[i].second, 0);
+    }
+
+    Suggestions scanned = service.scanSuggestions("far_v", 5);
+    CHECK_EQ(scanned.size(), size_t(5));
+    for (const auto& [candidate, mutual] : scanned) {
+        CHECK(candidate != "far_zed");
+        CHECK_EQ(mutual, 0);
+    }
+    FriendGraph::instance().clear();
+    sqlite3_close(db);
+}
@@ -0,0 +1,141 @@
+#include "checks.h"
+#include "../utils/id_bitmap.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+
+namespace {
+    // ids plus random ones below range until there are degree of them, ascending
+    std::vector<uint32_t> grow(std::vector<uint32_t> ids, size_t degree, uint32_t range, std::mt19937& rng) {
+        do {
+            for (size_t i = ids.size(); i < degree; i++) {
+                ids.push_back(rng() % range);
+            }
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        } while (ids.size() < degree);
+        return ids;
+    }
+
+    std::vector<uint32_t> expectedBoth(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+        std::vector<uint32_t> both;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(both));
+        return both;
+    }
+
+    // Output iterator that only counts, for std::set_intersection
+    struct Counter {
+        size_t* count;
+        Counter& operator*() { return *this; }
+        Counter& operator++() { return *this; }
+        Counter& operator=(uint32_t) {
+            ++*count;
+            return *this;
+        }
+    };
+
+    // Friend sets of the given degrees sharing a quarter of the smaller one. With 100K ids
+    // below 2^20 every container is a bitmap; sparser sets stay arrays.
+    struct Pair {
+        std::vector<uint32_t> a;
+        std::vector<uint32_t> b;
+    };
+
+    Pair randomPair(size_t degreeA, size_t degreeB, uint32_t range, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::vector<uint32_t> common = grow({}, std::min(degreeA, degreeB) / 4, range, rng);
+        return Pair{grow(common, degreeA, range, rng), grow(common, degreeB, range, rng)};
+    }
+}
+
+// Counts and intersections match std::set_intersection for every container pairing: arrays
+// merged or searched, arrays probed against bitmaps, and bitmaps ANDed (the AVX2 path when
+// built with FRIEND_SETS_AVX2), including after adds and removes convert containers
+CHECK_CASE(id_bitmap_matches_set_intersection) {
+    const std::pair<size_t, size_t> degrees[] = {{0, 10}, {10, 10}, {10, 1000}, {1000, 1000}, {10, 100000},
+                                                 {1000, 100000}, {100000, 100000}};
+    for (const auto& degree : degrees) {
+        for (uint32_t range : {uint32_t(1) << 20, uint32_t(1) << 22}) {
+            Pair pair = randomPair(degree.first, degree.second, range, (uint32_t)(degree.first * 7 + degree.second));
+            IdBitmap a(pair.a.data(), pair.a.data() + pair.a.size());
+            IdBitmap b(pair.b.data(), pair.b.data() + pair.b.size());
+            std::vector<uint32_t> both = expectedBoth(pair.a, pair.b);
+            CHECK_EQ(a.size(), pair.a.size());
+            CHECK_EQ(a.intersectionCount(b), both.size());
+            CHECK_EQ(b.intersectionCount(a), both.size());
+            CHECK(a.intersection(b) == both);
+            CHECK(b.intersection(a) == both);
+        }
+    }
+
+    // Bitmaps filled at every density, so all 1024 words and every popcount lane are used
+    for (uint32_t density : {1, 2, 8, 64}) {
+        std::mt19937 rng(density);
+        std::vector<uint32_t> x;
+        std::vector<uint32_t> y;
+        for (uint32_t id = 0; id < (uint32_t(1) << 18); id++) {
+            if (rng() % density == 0) {
+                x.push_back(id);
+            }
+            if (rng() % density == 0) {
+                y.push_back(id);
+            }
+        }
+        IdBitmap a(x.data(), x.data() + x.size());
+        IdBitmap b(y.data(), y.data() + y.size());
+        CHECK_EQ(a.intersectionCount(b), expectedBoth(x, y).size());
+    }
+
+    // Shrinking a bitmap container back into an array and growing it again
+    Pair pair = randomPair(20000, 1000, 1 << 17, 48);
+    IdBitmap a(pair.a.data(), pair.a.data() + pair.a.size());
+    IdBitmap b(pair.b.data(), pair.b.data() + pair.b.size());
+    std::vector<uint32_t> kept;
+    for (size_t i = 0; i < pair.a.size(); i++) {
+        if (i % 3 == 0) {
+            kept.push_back(pair.a[i]);
+        } else {
+            CHECK(a.remove(pair.a[i]));
+        }
+    }
+    CHECK(!a.remove(pair.a[1]));
+    CHECK(a.intersection(b) == expectedBoth(kept, pair.b));
+    for (uint32_t id : pair.b) {
+        a.add(id);
+        if (!std::binary_search(kept.begin(), kept.end(), id)) {
+            kept.insert(std::lower_bound(kept.begin(), kept.end(), id), id);
+        }
+    }
+    CHECK_EQ(a.size(), kept.size());
+    CHECK_EQ(a.intersectionCount(b), pair.b.size());
+    CHECK(a.contains(pair.b[0]) && !a.contains(1u << 30));
+}
+
+// Microseconds to count the mutual friends of two users of degree n (defaults 10, 1K and
+// 100K, ids below 2^20) with sorted vectors and std::set_intersection, and with IdBitmap
+// counting and materializing. Build with -DFRIEND_SETS_AVX2=ON for the AVX2 count.
+BENCH_CASE(id_bitmap_bench) {
+    std::cout << "bitmap/bitmap count: " << (IdBitmap::usesAvx2() ? "AVX2" : "scalar") << std::endl;
+    std::cout << "degree  set_intersection-us  bitmap-count-us  bitmap-intersection-us   bitmap-bytes" << std::endl;
+    for (size_t n : checks::sizes(args, {10, 1000, 100000})) {
+        Pair pair = randomPair(n, n, 1 << 20, (uint32_t)n);
+        IdBitmap a(pair.a.data(), pair.a.data() + pair.a.size());
+        IdBitmap b(pair.b.data(), pair.b.data() + pair.b.size());
+        size_t expected = expectedBoth(pair.a, pair.b).size();
+        if (a.intersectionCount(b) != expected || a.intersection(b).size() != expected) {
+            checks::fail(__FILE__, __LINE__, "bitmap disagrees with set_intersection");
+        }
+        size_t reps = std::max<size_t>(20, 2000000 / n);
+        double sorted = checks::timePerCall(reps, [&] {
+            size_t count = 0;
+            std::set_intersection(pair.a.begin(), pair.a.end(), pair.b.begin(), pair.b.end(), Counter{&count});
+            checks::keep(count);
+        });
+        double count = checks::timePerCall(reps, [&] { checks::keep(a.intersectionCount(b)); });
+        double both = checks::timePerCall(reps, [&] { checks::keep(a.intersection(b).size()); });
+        std::cout << std::setw(6) << n << std::fixed << std::setprecision(3) << std::setw(21) << sorted
+                  << std::setw(17) << count << std::setw(24) << both << std::setw(15) << a.bytes() << std::endl;
+    }
+}
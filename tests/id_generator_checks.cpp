@@ -0,0 +1,103 @@
+#include "checks.h"
+#include "../utils/id_generator.h"
+#include "../utils/time_utils.h"
+#include <algorithm>
+#include <thread>
+
+// Ids from several threads at once are unique, increase within each thread, and never carry
+// a millisecond the clock hasn't reached, however many are asked for in one millisecond
+CHECK_CASE(id_generator_threads) {
+    IdGenerator& generator = IdGenerator::posts();
+    const int kThreads = 4;
+    const int kPerThread = 20000;
+    std::vector<std::vector<int64_t>> ids(kThreads);
+    std::vector<int> ahead(kThreads, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&generator, &ids, &ahead, t] {
+            ids[t].reserve(kPerThread);
+            for (int i = 0; i < kPerThread; i++) {
+                ids[t].push_back(generator.next());
+                if (IdGenerator::millisOf(ids[t].back()) > time_utils::nowMillis()) {
+                    ahead[t]++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<int64_t> all;
+    for (int t = 0; t < kThreads; t++) {
+        CHECK(std::is_sorted(ids[t].begin(), ids[t].end()));
+        CHECK(std::adjacent_find(ids[t].begin(), ids[t].end()) == ids[t].end());
+        CHECK_EQ(ahead[t], 0);
+        all.insert(all.end(), ids[t].begin(), ids[t].end());
+    }
+    std::sort(all.begin(), all.end());
+    CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+    CHECK(IdGenerator::isGenerated(all.front()));
+    CHECK(generator.next() > all.back());
+}
+
+// With the last sequence number of the current millisecond taken, the next id waits for the
+// following millisecond instead of borrowing it early
+CHECK_CASE(id_generator_sequence_overflow) {
+    IdGenerator& generator = IdGenerator::posts();
+    for (int round = 0; round < 20; round++) {
+        int64_t millis = time_utils::nowMillis();
+        int64_t lastOfMillisecond = ((millis - IdGenerator::kEpochMillis) << IdGenerator::kSequenceBits) |
+                                    IdGenerator::kSequenceMask;
+        generator.seedAbove(lastOfMillisecond);
+        int64_t id = generator.next();
+        int64_t after = time_utils::nowMillis();
+        CHECK(id > lastOfMillisecond);
+        CHECK(IdGenerator::millisOf(id) > millis);
+        CHECK(IdGenerator::millisOf(id) <= after);
+    }
+}
+
+// Seeding with the largest stored id keeps every later id above it, and seeding lower never
+// moves the generator back
+CHECK_CASE(id_generator_seed_above) {
+    IdGenerator& generator = IdGenerator::comments();
+    int64_t stored = ((time_utils::nowMillis() + 50 - IdGenerator::kEpochMillis) << IdGenerator::kSequenceBits) + 7;
+    generator.seedAbove(stored);
+    int64_t previous = stored;
+    for (int i = 0; i < 10000; i++) {
+        int64_t id = generator.next();
+        CHECK(id > previous);
+        previous = id;
+    }
+    generator.seedAbove(stored - 1000);
+    generator.seedAbove(42);  // An autoincrement id from before the switch
+    CHECK(generator.next() > previous);
+}
+
+// An id's millisecond comes back out of it, and firstIdAt(t) is the boundary between ids
+// generated before epoch second t and at or after it
+CHECK_CASE(id_generator_round_trip) {
+    std::time_t epochSeconds = IdGenerator::kEpochMillis / 1000;
+    std::time_t firstGeneratedSecond =
+        (std::time_t)((IdGenerator::kFirstGeneratedId >> IdGenerator::kSequenceBits) / 1000 + 1) + epochSeconds;
+    std::time_t now = time_utils::nowMillis() / 1000;
+    for (std::time_t t : {firstGeneratedSecond, now, now + 86400 * 365 * 30}) {
+        int64_t first = IdGenerator::firstIdAt(t);
+        CHECK(IdGenerator::isGenerated(first));
+        CHECK_EQ(IdGenerator::millisOf(first), (int64_t)t * 1000);
+        CHECK_EQ(first & IdGenerator::kSequenceMask, int64_t(0));
+        CHECK_EQ(IdGenerator::millisOf(first - 1), (int64_t)t * 1000 - 1);
+        CHECK_EQ(IdGenerator::millisOf(first + IdGenerator::kSequenceMask), (int64_t)t * 1000);
+        CHECK(first < (int64_t(1) << 53));  // Exact as a JavaScript number
+    }
+    CHECK_EQ(IdGenerator::firstIdAt(epochSeconds - 60), int64_t(0));
+    CHECK(!IdGenerator::isGenerated(IdGenerator::firstIdAt(epochSeconds + 60)));
+    CHECK(!IdGenerator::isGenerated(123456));
+
+    int64_t before = time_utils::nowMillis();
+    int64_t id = IdGenerator::comments().next();
+    CHECK(IdGenerator::isGenerated(id));
+    CHECK(IdGenerator::millisOf(id) >= before);
+    CHECK(id >= IdGenerator::firstIdAt(before / 1000));
+}
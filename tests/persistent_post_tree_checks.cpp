@@ -0,0 +1,167 @@
+#include "checks.h"
+#include "../services/PersistentPostTree.h"
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+
+namespace {
+    std::string authorOf(int64_t id) {
+        return "author" + std::to_string(id % 16);
+    }
+
+    Post postFor(int64_t id) {
+        return Post(id, authorOf(id), "body " + std::to_string(id), "", 0, 0);
+    }
+}
+
+// Single-threaded: inserts, replacements and removals against a std::map, read back through
+// snapshots taken along the way, which must not change as later writes land
+CHECK_CASE(persistent_post_tree_model) {
+    PersistentPostTree tree;
+    std::map<int64_t, int> model;  // id -> version of its content
+    std::mt19937_64 rng(30);
+    auto snapshotIds = [](const PersistentPostTree::Snapshot& snapshot) {
+        std::vector<int64_t> ids;
+        for (auto it = snapshot.rbegin(); it != snapshot.rend(); ++it) {
+            ids.push_back(it->getId());
+        }
+        return ids;
+    };
+    auto modelIds = [&model] {
+        std::vector<int64_t> ids;
+        for (auto it = model.rbegin(); it != model.rend(); ++it) {
+            ids.push_back(it->first);
+        }
+        return ids;
+    };
+
+    for (int round = 0; round < 20; round++) {
+        PersistentPostTree::Snapshot before = tree.snapshot();
+        std::vector<int64_t> expected = modelIds();
+        for (int step = 0; step < 1000; step++) {
+            int64_t id = (int64_t)(rng() % 3000) + 1;
+            if (rng() % 3 == 0) {
+                tree.remove(id);
+                model.erase(id);
+            } else {
+                int version = step;
+                tree.insert(Post(id, authorOf(id), std::to_string(version), "", 0, 0));
+                model[id] = version;
+            }
+        }
+        CHECK(snapshotIds(before) == expected);
+        CHECK_EQ(before.size(), (int)expected.size());
+    }
+
+    PersistentPostTree::Snapshot snapshot = tree.snapshot();
+    CHECK(snapshotIds(snapshot) == modelIds());
+    CHECK_EQ(tree.size(), (int)model.size());
+    for (auto it = snapshot.rbegin(); it != snapshot.rend(); ++it) {
+        CHECK(it->getContent() == std::to_string(model[it->getId()]));
+    }
+    std::vector<Post> page = snapshot.before(1500, 20);
+    auto next = model.lower_bound(1500);
+    for (const Post& post : page) {
+        CHECK(next != model.begin());
+        --next;
+        CHECK_EQ(post.getId(), next->first);
+    }
+}
+
+// One writer, 32 readers. The writer inserts ids 1, 2, 3, ... and keeps only the newest
+// `window` of them, removing id - window after inserting id, and now and then replaces a
+// post in place. Every snapshot must therefore hold a run of consecutive ids, newest first,
+// as long as its size() says, ending at or after the last write the reader saw completed
+// before taking it. Build with -DCHECKS_TSAN=ON to run it under ThreadSanitizer.
+// Optional arguments: number of writes, then window size.
+CHECK_CASE(persistent_post_tree_stress) {
+    const int kReaders = 32;
+    std::vector<size_t> given = checks::sizes(args, {20000, 500});
+    const int64_t writes = (int64_t)given[0];
+    const int64_t window = given.size() > 1 ? (int64_t)given[1] : 500;
+
+    PersistentPostTree tree;
+    std::atomic<int64_t> completed(0);  // Newest id whose insert and window removal are done
+    std::atomic<bool> done(false);
+    std::atomic<int> started(0);
+    std::atomic<long> snapshots(0);
+    std::vector<std::string> errors(kReaders);
+
+    auto reader = [&](int index) {
+        std::string& error = errors[index];
+        started++;
+        // Keeps going until it has taken one snapshot after the writer finished
+        for (bool last = false; !last && error.empty();) {
+            last = done.load();
+            int64_t seen = completed.load();
+            PersistentPostTree::Snapshot snapshot = tree.snapshot();
+            int64_t newest = 0;
+            int64_t previous = 0;
+            int count = 0;
+            for (auto it = snapshot.rbegin(); it != snapshot.rend(); ++it) {
+                int64_t id = it->getId();
+                if (count == 0) {
+                    newest = id;
+                } else if (id != previous - 1) {
+                    error = "gap or disorder: " + std::to_string(id) + " after " + std::to_string(previous);
+                    break;
+                }
+                if (it->getUserName() != authorOf(id) || it->getContent() != "body " + std::to_string(id)) {
+                    error = "wrong post behind id " + std::to_string(id);
+                    break;
+                }
+                previous = id;
+                count++;
+            }
+            if (!error.empty()) {
+                break;
+            }
+            int64_t oldest = count ? previous : 0;
+            if (count != snapshot.size()) {
+                error = "size() " + std::to_string(snapshot.size()) + " but iterated " + std::to_string(count);
+            } else if (newest < seen) {
+                error = "snapshot ends at " + std::to_string(newest) + " after write " + std::to_string(seen);
+            } else if (count > 0 && oldest != std::max<int64_t>(1, newest - window + 1) &&
+                       oldest != std::max<int64_t>(1, newest - window)) {
+                error = "window " + std::to_string(oldest) + ".." + std::to_string(newest);
+            } else if (count > 1) {
+                std::vector<Post> page = snapshot.before(newest, 2);
+                if (page.empty() || page[0].getId() != newest - 1) {
+                    error = "before() disagrees with the iterator";
+                }
+            }
+            snapshots++;
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kReaders; i++) {
+        readers.emplace_back(reader, i);
+    }
+    while (started.load() < kReaders) {
+        std::this_thread::yield();
+    }
+    for (int64_t id = 1; id <= writes; id++) {
+        tree.insert(postFor(id));
+        if (id > window) {
+            tree.remove(id - window);
+        }
+        if (id % 7 == 0) {
+            tree.insert(postFor(id - 1));  // Same id and content, new node
+        }
+        completed.store(id);
+    }
+    done.store(true);
+    for (std::thread& thread : readers) {
+        thread.join();
+    }
+
+    for (const std::string& error : errors) {
+        if (!error.empty()) {
+            checks::fail(__FILE__, __LINE__, error);
+        }
+    }
+    CHECK(snapshots.load() >= kReaders);
+    CHECK_EQ(tree.size(), (int)std::min(writes, window));
+}
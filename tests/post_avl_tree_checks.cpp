@@ -0,0 +1,42 @@
+#include "checks.h"
+#include "../services/PostAVLTree.h"
+#include <map>
+#include <random>
+
+// Newest posts by an author come from the per-author index; compare against a brute-force
+// model through inserts, removals and re-inserts that change a post's author.
+CHECK_CASE(post_avl_tree_by_author) {
+    PostAVLTree tree;
+    std::map<int64_t, std::string> model;  // id -> author
+    std::mt19937_64 rng(26);
+    auto authorName = [](int a) { return "author" + std::to_string(a); };
+
+    for (int step = 0; step < 20000; step++) {
+        int64_t id = (int64_t)(rng() % 5000) + 1;
+        if (rng() % 4 == 0) {
+            tree.remove(id);
+            model.erase(id);
+        } else {
+            std::string author = authorName((int)(rng() % 12));
+            tree.insert(Post(id, author, "body", "", 0, 0));
+            model[id] = author;
+        }
+    }
+    CHECK_EQ(tree.size(), (int)model.size());
+
+    for (int a = 0; a < 13; a++) {  // author12 never posted
+        std::string author = authorName(a);
+        std::vector<int64_t> expected;
+        for (auto it = model.rbegin(); it != model.rend() && expected.size() < 25; ++it) {
+            if (it->second == author) {
+                expected.push_back(it->first);
+            }
+        }
+        std::vector<Post> posts = tree.getPostsByUser(author, 25);
+        CHECK_EQ(posts.size(), expected.size());
+        for (size_t i = 0; i < posts.size(); i++) {
+            CHECK_EQ(posts[i].getId(), expected[i]);
+            CHECK(posts[i].getUserName() == author);
+        }
+    }
+}
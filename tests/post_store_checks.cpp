@@ -0,0 +1,57 @@
+#include "checks.h"
+#include "../services/post_store.h"
+
+namespace {
+    // Hits and misses a multiGet of ids adds to the stats
+    std::pair<uint64_t, uint64_t> hitsAndMisses(sqlite3* db, const std::vector<int64_t>& ids) {
+        PostStore::Stats before = PostStore::instance().stats();
+        PostStore::instance().multiGet(db, ids);
+        PostStore::Stats after = PostStore::instance().stats();
+        return {after.hits - before.hits, after.misses - before.misses};
+    }
+}
+
+// An invalidation that lands while a multiGet is reading keeps only that post out of the
+// cache; the rest of the batch, and batches that didn't read it, are cached as usual
+CHECK_CASE(post_store_invalidation) {
+    sqlite3* db = checks::openSchemaDb();
+    checks::exec(db, "INSERT INTO users (id, username) VALUES (1, 'alice');");
+    for (int id = 1; id <= 10; id++) {
+        checks::exec(db, "INSERT INTO posts (id, user_id, content) VALUES (" + std::to_string(id) +
+                             ", 1, 'post " + std::to_string(id) + "');");
+    }
+    PostStore& store = PostStore::instance();
+    const std::vector<int64_t> batch = {1, 2, 3, 4, 5};
+    const std::vector<int64_t> rest = {1, 2, 4, 5};
+
+    // Invalidating a post the fetch is reading
+    store.clear();
+    {
+        checks::DuringNextQuery during(db, [&] { store.invalidate(3); });
+        auto posts = store.multiGet(db, batch);
+        CHECK_EQ(posts.size(), batch.size());
+        CHECK(posts[2] && posts[2]->getContent() == "post 3");
+    }
+    CHECK((hitsAndMisses(db, rest) == std::make_pair<uint64_t, uint64_t>(4, 0)));
+    CHECK((hitsAndMisses(db, {3}) == std::make_pair<uint64_t, uint64_t>(0, 1)));
+    CHECK((hitsAndMisses(db, {3}) == std::make_pair<uint64_t, uint64_t>(1, 0)));
+
+    // Invalidating an unrelated post doesn't cost the fetch anything
+    store.clear();
+    {
+        checks::DuringNextQuery during(db, [&] { store.invalidate(9); });
+        store.multiGet(db, batch);
+    }
+    CHECK((hitsAndMisses(db, batch) == std::make_pair<uint64_t, uint64_t>(5, 0)));
+
+    // clear() during a fetch keeps the whole batch out
+    store.clear();
+    {
+        checks::DuringNextQuery during(db, [&] { store.clear(); });
+        store.multiGet(db, batch);
+    }
+    CHECK_EQ(store.stats().entries, size_t(0));
+
+    store.clear();
+    sqlite3_close(db);
+}
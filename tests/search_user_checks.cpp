@@ -0,0 +1,92 @@
+#include "checks.h"
+#include "../services/friend_graph.h"
+#include "../services/search_user.h"
+#include <random>
+
+namespace {
+    // How search results were marked before resolveRelationships: two join queries per user
+    int countRows(sqlite3* db, const char* status, const std::string& a, const std::string& b) {
+        const char* sql = R"(
+            SELECT COUNT(*) FROM friends f
+            JOIN users u1 ON f.requester_id = u1.id
+            JOIN users u2 ON f.addressee_id = u2.id
+            WHERE f.status = ? AND ((u1.username = ? AND u2.username = ?) OR (u1.username = ? AND u2.username = ?))
+        )";
+        sqlite3_stmt* stmt;
+        CHECK(sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK);
+        sqlite3_bind_text(stmt, 1, status, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, a.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, b.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, b.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 5, a.c_str(), -1, SQLITE_STATIC);
+        int count = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+        sqlite3_finalize(stmt);
+        return count;
+    }
+
+    // Every viewer against every other user, as the old per-user queries marked them;
+    // returns how many of each relationship were compared
+    std::vector<int> compareAll(sqlite3* db, int users) {
+        std::vector<int> seen(3, 0);  // Friends, pending, neither
+        for (int v = 1; v <= users; v++) {
+            std::string viewer = "rel_u" + std::to_string(v);
+            std::vector<SearchUser> page;
+            for (int u = 1; u <= users; u++) {
+                if (u != v) {
+                    page.emplace_back(u, "rel_u" + std::to_string(u), "", "", "", "");
+                }
+            }
+            resolveRelationships(db, viewer, page);
+            for (const SearchUser& user : page) {
+                bool isFriend = countRows(db, "accepted", viewer, user.username.str()) > 0;
+                bool pending = countRows(db, "pending", viewer, user.username.str()) > 0;
+                CHECK_EQ(user.is_friend, isFriend);
+                CHECK_EQ(user.has_pending_request, pending);
+                seen[isFriend ? 0 : pending ? 1 : 2]++;
+            }
+        }
+        return seen;
+    }
+}
+
+// Accepted in either direction, requests sent and received, declined and no row at all come
+// out as the per-user queries had them, from the table and from FriendGraph
+CHECK_CASE(search_user_relationships) {
+    std::mt19937 rng(50);
+    sqlite3* db = checks::openSchemaDb();
+    const int kUsers = 40;
+    for (int u = 1; u <= kUsers; u++) {
+        checks::exec(db, "INSERT INTO users (id, username) VALUES (" + std::to_string(u) + ", 'rel_u" + std::to_string(u) + "')");
+    }
+    const char* statuses[] = {"accepted", "pending", "declined"};
+    for (int a = 1; a <= kUsers; a++) {
+        for (int b = a + 1; b <= kUsers; b++) {
+            if (rng() % 100 < 30) {
+                bool forward = rng() % 2;
+                checks::exec(db, "INSERT INTO friends (requester_id, addressee_id, status) VALUES (" +
+                                     std::to_string(forward ? a : b) + ", " + std::to_string(forward ? b : a) + ", '" +
+                                     statuses[rng() % 3] + "')");
+            }
+        }
+    }
+
+    FriendGraph& graph = FriendGraph::instance();
+    graph.clear();
+    std::vector<int> fromTable = compareAll(db, kUsers);
+    CHECK(fromTable[0] > 0 && fromTable[1] > 0 && fromTable[2] > 0);
+
+    graph.load(db);
+    CHECK(compareAll(db, kUsers) == fromTable);
+
+    // A friendship accepted after the load is seen through the graph
+    checks::exec(db, "DELETE FROM friends WHERE (requester_id = 1 AND addressee_id = 2) OR (requester_id = 2 AND addressee_id = 1);"
+                     "INSERT INTO friends (requester_id, addressee_id, status) VALUES (1, 2, 'accepted')");
+    graph.addFriendship(db, "rel_u1", "rel_u2");
+    compareAll(db, kUsers);
+
+    graph.clear();
+    std::vector<SearchUser> empty;
+    resolveRelationships(db, "rel_u1", empty);
+    CHECK(empty.empty());
+    sqlite3_close(db);
+}
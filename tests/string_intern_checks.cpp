@@ -0,0 +1,144 @@
+#include "checks.h"
+#include "../services/Post.h"
+#include "../utils/string_intern.h"
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace {
+    std::string paddedName(size_t i) {
+        return "member" + std::to_string(i) + std::string(i % 12, 'x');  // 7 to 21 characters
+    }
+
+    // Post as it was before usernames were interned and text was shared: every field owned
+    struct PlainPost {
+        int64_t id;
+        std::string user_name;
+        std::string content;
+        std::string image_url;
+        std::time_t created_at;
+        int like_count;
+        int comment_count;
+        std::vector<Comment> comments;
+    };
+
+    struct Cost {
+        double micros;
+        size_t allocations;
+        size_t bytes;
+    };
+
+    template <typename F>
+    Cost measure(F f) {
+        size_t allocations = checks::allocations();
+        size_t bytes = checks::allocatedBytes();
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return Cost{checks::micros(start), checks::allocations() - allocations, checks::allocatedBytes() - bytes};
+    }
+
+    void report(const char* name, size_t n, const Cost& build, const Cost& copy) {
+        std::cout << std::left << std::setw(8) << name << std::right << std::setw(9) << n << std::fixed
+                  << std::setprecision(0) << std::setw(11) << build.micros << std::setw(12) << build.allocations
+                  << std::setw(13) << build.bytes << std::setw(10) << copy.micros << std::setw(12)
+                  << copy.allocations << std::setw(13) << copy.bytes << std::endl;
+    }
+}
+
+CHECK_CASE(string_intern_atoms) {
+    Atom::TableStats before = Atom::tableStats();
+    Atom first("intern-check-alice");
+    Atom again(std::string("intern-check-") + "alice");
+    CHECK(first == again);
+    CHECK(first.c_str() == again.c_str());
+    CHECK(Atom("") == Atom());
+    CHECK(Atom("intern-check-bob") != first);
+    CHECK_EQ(Atom::tableStats().atoms, before.atoms + 2);
+
+    // Views stay valid while the table grows
+    std::string_view view = first.view();
+    const char* address = view.data();
+    for (int i = 0; i < 20000; i++) {
+        Atom("intern-check-grow-" + std::to_string(i));
+    }
+    CHECK_EQ(Atom::tableStats().atoms, before.atoms + 2 + 20000);
+    CHECK(Atom("intern-check-alice").c_str() == address);
+    CHECK(view == "intern-check-alice");
+    CHECK(Atom::tableStats().bytes > before.bytes);
+
+    // Threads interning the same names at once all get the one copy
+    const int kThreads = 8;
+    const int kNames = 2000;
+    std::vector<std::vector<const char*>> seen(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([t, &seen] {
+            seen[t].resize(kNames);
+            for (int i = 0; i < kNames; i++) {
+                int name = (i * 7 + t * 131) % kNames;
+                seen[t][name] = Atom("intern-check-thread-" + std::to_string(name)).c_str();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (int t = 1; t < kThreads; t++) {
+        CHECK(seen[t] == seen[0]);
+    }
+    CHECK_EQ(Atom::tableStats().atoms, before.atoms + 2 + 20000 + kNames);
+
+    // Copies of a post share its text
+    Post post(1, "intern-check-alice", std::string(200, 'c'), "", 0, 0);
+    Post copy = post;
+    CHECK(copy.getContent().data() == post.getContent().data());
+    CHECK(copy.getUserName().data() == address);
+}
+
+// Building n posts from rows (1 author per 50 posts, names 7 to 21 characters, 120-byte
+// bodies) and copying them all out, as a timeline response does, with the interned Post
+// and with the old all-owned layout. Default 1K and 100K posts.
+BENCH_CASE(string_intern_bench) {
+    std::cout << "layout      posts   build-us build-allocs  build-bytes   copy-us copy-allocs   copy-bytes"
+              << std::endl;
+    for (size_t n : checks::sizes(args, {1000, 100000})) {
+        size_t authors = std::max<size_t>(20, n / 50);
+        std::vector<std::string> names(authors);
+        for (size_t a = 0; a < authors; a++) {
+            names[a] = paddedName(a);
+        }
+        std::string body(120, 'b');
+
+        {
+            std::vector<PlainPost> posts;
+            std::vector<PlainPost> copy;
+            Cost build = measure([&] {
+                posts.reserve(n);
+                for (size_t i = 0; i < n; i++) {
+                    posts.push_back(PlainPost{(int64_t)i, names[i % authors], body, "", 0, 0, 0, {}});
+                }
+            });
+            Cost copied = measure([&] { copy = posts; });
+            checks::keep(copy.size());
+            report("owned", n, build, copied);
+        }
+        {
+            for (const std::string& name : names) {
+                Atom(name.c_str());  // The server has seen these users before
+            }
+            std::vector<Post> posts;
+            std::vector<Post> copy;
+            Cost build = measure([&] {
+                posts.reserve(n);
+                for (size_t i = 0; i < n; i++) {
+                    posts.emplace_back((int64_t)i, names[i % authors], body, "", 0, 0);
+                }
+            });
+            Cost copied = measure([&] { copy = posts; });
+            checks::keep(copy.size());
+            report("interned", n, build, copied);
+        }
+    }
+    Atom::TableStats table = Atom::tableStats();
+    std::cout << "atom table: " << table.atoms << " atoms, " << table.bytes << " bytes" << std::endl;
+}
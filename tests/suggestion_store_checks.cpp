@@ -0,0 +1,177 @@
+#include "checks.h"
+#include "../services/friend_graph.h"
+#include "../services/suggestion_store.h"
+#include "../utils/time_utils.h"
+#include <set>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    using Suggestions = std::vector<std::pair<std::string, int>>;
+
+    // Polls done() for up to five seconds
+    template <typename F>
+    bool waitFor(F done) {
+        for (int i = 0; i < 5000; i++) {
+            if (done()) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return done();
+    }
+
+    // Users with rows in friend_suggestions built at or after since
+    std::set<std::string> savedSince(sqlite3* db, int64_t since) {
+        std::set<std::string> users;
+        sqlite3_stmt* stmt;
+        const char* sql = "SELECT DISTINCT users.username FROM friend_suggestions JOIN users ON users.id = user_id "
+                          "WHERE built_at >= ?";
+        CHECK(sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK);
+        sqlite3_bind_int64(stmt, 1, since);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            users.insert(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        }
+        sqlite3_finalize(stmt);
+        return users;
+    }
+
+    // username's stored list, in rank order
+    Suggestions savedList(sqlite3* db, const std::string& username) {
+        Suggestions list;
+        sqlite3_stmt* stmt;
+        const char* sql = "SELECT suggested.username, s.mutual_friends FROM friend_suggestions AS s "
+                          "JOIN users AS owner ON owner.id = s.user_id JOIN users AS suggested ON suggested.id = s.suggested_id "
+                          "WHERE owner.username = ? ORDER BY s.rank";
+        CHECK(sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK);
+        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            list.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), sqlite3_column_int(stmt, 1));
+        }
+        sqlite3_finalize(stmt);
+        return list;
+    }
+}
+
+// A friendship change between a and b re-queues exactly a, b and their friends that have a
+// list; changes while they wait coalesce; a list built across a change is queued again; and
+// the lists come back from friend_suggestions after stop() and start().
+//
+// The refresher is held in a batch by a second connection keeping the write lock (the file
+// is in WAL mode, so reads go on): whatever is queued meanwhile stays queued.
+CHECK_CASE(suggestion_store_refresh) {
+    std::string path = "/tmp/checks_suggestion_store_" + std::to_string(getpid()) + ".db";
+    unlink(path.c_str());
+    sqlite3* db = checks::openSchemaDb(path);
+    checks::exec(db, "PRAGMA journal_mode = WAL");
+    const char* users[] = {"ss_a", "ss_b", "ss_a1", "ss_a2", "ss_b1", "ss_f", "ss_x", "ss_x1", "ss_p", "ss_q", "ss_o1", "ss_o2"};
+    for (int i = 0; i < 12; i++) {
+        checks::exec(db, "INSERT INTO users (id, username) VALUES (" + std::to_string(i + 1) + ", '" + users[i] + "')");
+    }
+    // a - a1, a - a2, b - b1, a1 - f, x - x1
+    checks::exec(db, "INSERT INTO friends (requester_id, addressee_id, status) VALUES "
+                     "(1, 3, 'accepted'), (1, 4, 'accepted'), (2, 5, 'accepted'), (3, 6, 'accepted'), (7, 8, 'accepted')");
+    sqlite3* blocker;
+    CHECK(sqlite3_open(path.c_str(), &blocker) == SQLITE_OK);
+    sqlite3_busy_timeout(blocker, 5000);  // The refresher may be mid-save when it locks
+    // Also on a failed CHECK: release the lock, then the refresher, which must not outlive main
+    struct Cleanup {
+        sqlite3* db;
+        sqlite3* blocker;
+        std::string path;
+        ~Cleanup() {
+            sqlite3_close(blocker);
+            SuggestionStore::instance().stop();
+            FriendGraph::instance().clear();
+            sqlite3_close(db);
+            unlink(path.c_str());
+            unlink((path + "-wal").c_str());
+            unlink((path + "-shm").c_str());
+        }
+    } cleanup{db, blocker, path};
+
+    FriendGraph& graph = FriendGraph::instance();
+    graph.load(db);
+    SuggestionStore& store = SuggestionStore::instance();
+    store.start(db);
+
+    // Lists for everyone but a2, saved by the refresher
+    std::vector<std::string> listed = {"ss_a", "ss_b", "ss_a1", "ss_b1", "ss_f"};
+    Suggestions fList;
+    for (const std::string& user : listed) {
+        Suggestions list = store.suggestionsFor(db, user, SuggestionStore::kStoredSuggestions);
+        CHECK(!list.empty());
+        if (user == "ss_f") {
+            fList = list;
+        }
+    }
+    CHECK(waitFor([&] { return savedSince(db, 0).size() == listed.size(); }));
+    CHECK(savedList(db, "ss_f") == fList);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    // a and b become friends: a, b, a1 and b1 are rebuilt (a2 has no list, f is three hops out)
+    int64_t changedAt = time_utils::nowMillis();
+    SuggestionStore::Stats before = store.stats();
+    checks::exec(blocker, "BEGIN IMMEDIATE");
+    graph.addFriendship(db, "ss_a", "ss_b");
+    CHECK(waitFor([&] { return store.stats().refreshes == before.refreshes + 4; }));
+    CHECK_EQ(store.stats().queued, size_t(0));
+
+    // Held in that batch's save: undoing and redoing the friendship queues the same four
+    // once, and the second change coalesces into the first
+    graph.removeFriendship("ss_a", "ss_b");
+    CHECK_EQ(store.stats().queued, size_t(4));
+    CHECK_EQ(store.stats().coalesced, before.coalesced);
+    graph.addFriendship(db, "ss_a", "ss_b");
+    CHECK_EQ(store.stats().queued, size_t(4));
+    CHECK_EQ(store.stats().coalesced, before.coalesced + 4);
+    int64_t releasedAt = time_utils::nowMillis();
+    checks::exec(blocker, "COMMIT");
+    CHECK(waitFor([&] { return store.stats().refreshes == before.refreshes + 8 && store.stats().queued == 0; }));
+    std::set<std::string> changed = {"ss_a", "ss_a1", "ss_b", "ss_b1"};
+    CHECK(waitFor([&] { return savedSince(db, releasedAt) == changed; }));
+    CHECK(savedSince(db, changedAt) == changed);
+    CHECK(savedList(db, "ss_f") == fList);
+
+    // x's list is counted while p and q become friends: it may have missed the change, so it
+    // is rebuilt (p and q themselves have no lists)
+    before = store.stats();
+    {
+        checks::DuringNextQuery during(db, [&] { graph.addFriendship(blocker, "ss_p", "ss_q"); });
+        CHECK(!store.suggestionsFor(db, "ss_x", 10).empty());
+    }
+    CHECK(graph.areFriends("ss_p", "ss_q"));
+    CHECK(waitFor([&] { return store.stats().refreshes == before.refreshes + 1; }));
+    CHECK_EQ(store.stats().misses, before.misses + 1);
+
+    // Stopped with the four queued again: their rows are dropped, the rest stay as served
+    checks::exec(blocker, "BEGIN IMMEDIATE");
+    before = store.stats();
+    graph.removeFriendship("ss_a", "ss_b");
+    CHECK(waitFor([&] { return store.stats().refreshes == before.refreshes + 4; }));
+    graph.addFriendship(db, "ss_a", "ss_b");
+    CHECK_EQ(store.stats().queued, size_t(4));
+    std::thread release([blocker] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        checks::exec(blocker, "COMMIT");
+    });
+    store.stop();
+    release.join();
+    for (const std::string& user : changed) {
+        CHECK(savedList(db, user).empty());
+    }
+    CHECK(savedList(db, "ss_f") == fList);
+    CHECK(!savedList(db, "ss_x").empty());
+
+    // start() serves what the table holds, edited here to tell it from the copy in memory
+    checks::exec(db, "UPDATE friend_suggestions SET mutual_friends = 99 WHERE rank = 0 AND user_id = 6");
+    store.start(db);
+    before = store.stats();
+    Suggestions reloaded = store.suggestionsFor(db, "ss_f", SuggestionStore::kStoredSuggestions);
+    CHECK_EQ(store.stats().hits, before.hits + 1);
+    CHECK_EQ(reloaded.size(), fList.size());
+    CHECK_EQ(reloaded[0].second, 99);
+    CHECK((Suggestions(reloaded.begin() + 1, reloaded.end()) == Suggestions(fList.begin() + 1, fList.end())));
+    store.suggestionsFor(db, "ss_a", 10);
+    CHECK_EQ(store.stats().misses, before.misses + 1);
+}
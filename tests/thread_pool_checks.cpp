@@ -0,0 +1,62 @@
+#include "checks.h"
+#include "../utils/thread_pool.h"
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+
+// Destroying the pool runs everything already submitted, so futures of queued
+// packaged_tasks get their values instead of broken_promise
+CHECK_CASE(thread_pool_drains_on_destroy) {
+    std::vector<std::future<int>> results;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::thread releaser;
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 2; i++) {
+            pool.submit([released] { released.wait(); });  // Keep both workers busy
+        }
+        for (int i = 0; i < 100; i++) {
+            auto task = std::make_shared<std::packaged_task<int()>>([i] { return i * i; });
+            results.push_back(task->get_future());
+            pool.submit([task] { (*task)(); });
+        }
+        CHECK(pool.pending() >= 100);
+        // Let the workers go only once the destructor has started
+        releaser = std::thread([&release] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            release.set_value();
+        });
+    }
+    releaser.join();
+    for (int i = 0; i < 100; i++) {
+        CHECK_EQ(results[i].get(), i * i);
+    }
+}
+
+// discardPending drops only what hasn't started
+CHECK_CASE(thread_pool_discard_pending) {
+    std::atomic<int> ran(0);
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    size_t discarded;
+    {
+        ThreadPool pool(1);
+        pool.submit([&started, released, &ran] {
+            started.set_value();
+            released.wait();
+            ran++;
+        });
+        started.get_future().wait();
+        for (int i = 0; i < 10; i++) {
+            pool.submit([&ran] { ran++; });
+        }
+        discarded = pool.discardPending();
+        CHECK_EQ(pool.pending(), size_t(0));
+        release.set_value();
+    }
+    CHECK_EQ(discarded, size_t(10));
+    CHECK_EQ(ran.load(), 1);
+}
@@ -0,0 +1,146 @@
+#include "checks.h"
+#include "../utils/time_utils.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+namespace {
+    // Sets TZ for the process until destroyed. The offset cache is per thread, so each zone
+    // has to be exercised on a thread started after the switch.
+    struct ZoneScope {
+        std::string previous;
+        bool hadPrevious;
+
+        explicit ZoneScope(const char* zone) {
+            const char* current = std::getenv("TZ");
+            hadPrevious = current != nullptr;
+            previous = current ? current : "";
+            setenv("TZ", zone, 1);
+            tzset();
+        }
+        ~ZoneScope() {
+            if (hadPrevious) {
+                setenv("TZ", previous.c_str(), 1);
+            } else {
+                unsetenv("TZ");
+            }
+            tzset();
+        }
+    };
+
+    template <typename F>
+    void onFreshThread(F f) {
+        std::thread thread(f);
+        thread.join();
+    }
+
+    // What the formatter replaced
+    size_t strftimeFormat(std::time_t t, char* out) {
+        std::tm local;
+        localtime_r(&t, &local);
+        return std::strftime(out, time_utils::kIsoBufferSize, "%Y-%m-%dT%H:%M:%S", &local);
+    }
+
+    // Offset lookup as it was: a per-thread cache of 64 direct-mapped quarter-hour slots
+    long quarterHourOffset(std::time_t t) {
+        struct Cache {
+            int64_t bucket[64];
+            long offset[64];
+            Cache() {
+                for (int i = 0; i < 64; i++) {
+                    bucket[i] = INT64_MIN;
+                    offset[i] = 0;
+                }
+            }
+        };
+        thread_local Cache cache;
+        int64_t bucket = (t >= 0 ? t : t - 899) / 900;
+        int slot = static_cast<int>(bucket & 63);
+        if (cache.bucket[slot] != bucket) {
+            std::tm local;
+            localtime_r(&t, &local);
+            cache.bucket[slot] = bucket;
+            cache.offset[slot] = local.tm_gmtoff;
+        }
+        return cache.offset[slot];
+    }
+}
+
+// Offsets and formatted output match localtime_r/strftime in zones with DST, half-hour and
+// 45-minute offsets and none at all: every 13 minutes over 2019-2025, then random instants
+// from 1950 to 2100 in no particular order so the interval cache keeps missing
+CHECK_CASE(time_utils_matches_strftime) {
+    const char* zones[] = {"America/New_York", "Australia/Lord_Howe", "Asia/Kathmandu", "Africa/Cairo",
+                           "Europe/London", "UTC"};
+    for (const char* zone : zones) {
+        ZoneScope scope(zone);
+        std::string error;
+        onFreshThread([&error] {
+            char expected[time_utils::kIsoBufferSize];
+            char actual[time_utils::kIsoBufferSize];
+            auto compare = [&](std::time_t t) {
+                std::tm local;
+                localtime_r(&t, &local);
+                strftimeFormat(t, expected);
+                time_utils::formatIso8601(t, actual);
+                if (time_utils::utcOffsetSeconds(t) != local.tm_gmtoff || std::strcmp(expected, actual) != 0) {
+                    error = std::to_string(t) + ": " + actual + " vs " + expected;
+                }
+                return error.empty();
+            };
+            for (std::time_t t = 1546300800; t < 1767225600 && compare(t); t += 780) {
+            }
+            std::mt19937_64 rng(33);
+            for (int i = 0; i < 50000 && error.empty(); i++) {
+                compare(static_cast<std::time_t>(-631152000 + (int64_t)(rng() % 4733510400ULL)));
+            }
+        });
+        if (!error.empty()) {
+            checks::fail(__FILE__, __LINE__, std::string(zone) + " " + error);
+        }
+    }
+}
+
+// Nanoseconds per timestamp in America/New_York for n timestamps (default 1M) spread
+// uniformly over windows from an hour to ten years ending 2025-01-01. Formatting: strftime
+// (the original path) against formatIso8601. Offset lookup alone: the old 64-slot
+// quarter-hour cache against the current DST-interval cache.
+BENCH_CASE(time_utils_bench) {
+    ZoneScope scope("America/New_York");
+    const int64_t kEnd = 1735689600;
+    const std::pair<const char*, int64_t> windows[] = {
+        {"1 hour", 3600}, {"16 hours", 57600}, {"1 day", 86400}, {"30 days", 30 * 86400},
+        {"1 year", 365 * 86400}, {"10 years", 3652 * 86400}};
+    std::cout << "window        strftime-ns  format-ns  offset-quarter-hour-ns  offset-interval-ns" << std::endl;
+    for (size_t n : checks::sizes(args, {1000000})) {
+        for (const auto& window : windows) {
+            std::mt19937_64 rng(n);
+            std::vector<std::time_t> instants(n);
+            for (std::time_t& t : instants) {
+                t = static_cast<std::time_t>(kEnd - (int64_t)(rng() % window.second));
+            }
+            double nanos[4];
+            onFreshThread([&] {
+                char out[time_utils::kIsoBufferSize];
+                nanos[0] = checks::timePerCall(n, [&, i = size_t(0)]() mutable {
+                    checks::keep(strftimeFormat(instants[i++], out));
+                }) * 1000;
+                nanos[1] = checks::timePerCall(n, [&, i = size_t(0)]() mutable {
+                    checks::keep(time_utils::formatIso8601(instants[i++], out));
+                }) * 1000;
+                nanos[2] = checks::timePerCall(n, [&, i = size_t(0)]() mutable {
+                    checks::keep(quarterHourOffset(instants[i++]));
+                }) * 1000;
+                nanos[3] = checks::timePerCall(n, [&, i = size_t(0)]() mutable {
+                    checks::keep(time_utils::utcOffsetSeconds(instants[i++]));
+                }) * 1000;
+            });
+            std::cout << std::left << std::setw(12) << window.first << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(13) << nanos[0] << std::setw(11) << nanos[1]
+                      << std::setw(24) << nanos[2] << std::setw(20) << nanos[3] << std::endl;
+        }
+    }
+}
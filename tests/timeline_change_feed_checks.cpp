@@ -0,0 +1,129 @@
+#include "checks.h"
+#include "../services/post_store.h"
+#include "../services/timeline_change_feed.h"
+#include <iomanip>
+#include <iostream>
+#include <unordered_set>
+
+namespace {
+    std::vector<int64_t> postIds(const std::vector<TimelineChangeFeed::Event>& events) {
+        std::vector<int64_t> ids;
+        for (const auto& event : events) {
+            ids.push_back(event.postId);
+        }
+        return ids;
+    }
+
+    // Events after cursor by authors; fails the case if the feed wants a reload
+    std::vector<TimelineChangeFeed::Event> since(uint64_t cursor, const std::vector<std::string>& authors) {
+        std::vector<TimelineChangeFeed::Event> events;
+        uint64_t head;
+        if (!TimelineChangeFeed::instance().since(cursor, authors, events, head)) {
+            checks::fail(__FILE__, __LINE__, "cursor " + std::to_string(cursor) + " rejected");
+        }
+        if (head != TimelineChangeFeed::instance().head()) {
+            checks::fail(__FILE__, __LINE__, "stale head");
+        }
+        return events;
+    }
+
+    // The feed as it was: one log for everyone, copied from the cursor on and filtered by author
+    struct GlobalFeed {
+        struct Event {
+            int64_t postId;
+            std::string author;
+        };
+        std::deque<Event> events;
+
+        size_t since(size_t cursor, const std::vector<std::string>& authors) const {
+            std::vector<Event> copy(events.begin() + cursor, events.end());
+            std::unordered_set<std::string> wanted(authors.begin(), authors.end());
+            size_t found = 0;
+            for (const Event& event : copy) {
+                found += wanted.count(event.author);
+            }
+            return found;
+        }
+    };
+}
+
+// Each poll sees only its own authors' events (and changes nobody could attribute), in order;
+// a busy author ages out only the cursors of those who follow them
+CHECK_CASE(timeline_change_feed_per_author) {
+    TimelineChangeFeed& feed = TimelineChangeFeed::instance();
+    uint64_t start = feed.head();
+    feed.recordPost(101, "feed_alice");
+    feed.recordPost(102, "feed_bob");
+    feed.recordChange(101, "feed_alice");
+    feed.recordChange(900, "");
+    feed.recordPost(103, "feed_alice");
+    CHECK_EQ(feed.head(), start + 5);
+
+    std::vector<TimelineChangeFeed::Event> events = since(start, {"feed_alice", "feed_carol"});
+    CHECK((postIds(events) == std::vector<int64_t>{101, 101, 900, 103}));
+    CHECK(events[0].created && !events[1].created && events[3].created);
+    CHECK_EQ(events[3].seq, start + 5);
+    CHECK((postIds(since(start + 2, {"feed_bob"})) == std::vector<int64_t>{900}));
+    CHECK(since(feed.head(), {"feed_alice"}).empty());
+
+    // PostStore passes on the author of a post it holds
+    sqlite3* db = checks::openSchemaDb();
+    checks::exec(db, "INSERT INTO users (id, username) VALUES (1, 'feed_dave');"
+                     "INSERT INTO posts (id, user_id, content) VALUES (104, 1, 'd');");
+    PostStore::instance().clear();
+    PostStore::instance().get(db, 104);
+    uint64_t beforeLike = feed.head();
+    PostStore::instance().invalidate(104);
+    CHECK((postIds(since(beforeLike, {"feed_dave"})) == std::vector<int64_t>{104}));
+    CHECK(since(beforeLike, {"feed_alice"}).empty());
+    PostStore::instance().clear();
+    sqlite3_close(db);
+
+    // Enough activity by one author to push everything older out of the feed
+    uint64_t slow = feed.head();
+    feed.recordPost(105, "feed_alice");
+    for (int i = 0; i < 25000; i++) {
+        feed.recordChange(200000 + i, "feed_busy");
+    }
+    CHECK((postIds(since(slow, {"feed_alice", "feed_bob"})) == std::vector<int64_t>{105}));
+    std::vector<TimelineChangeFeed::Event> out;
+    uint64_t head;
+    CHECK(!feed.since(slow, {"feed_busy"}, out, head));
+    CHECK_EQ(head, feed.head());
+    CHECK(!feed.since(start - 1000000, {"feed_bob"}, out, head));  // Before this process
+    CHECK(!feed.since(feed.head() + 1, {"feed_bob"}, out, head));  // Never handed out
+}
+
+// Microseconds per poll by a viewer following 200 authors who posted 5 times among n events
+// by 10K other users (default 1K and 20K): the per-author feed against the global log it
+// replaced, which copied every event after the cursor and filtered them by author
+BENCH_CASE(timeline_change_feed_bench) {
+    TimelineChangeFeed& feed = TimelineChangeFeed::instance();
+    std::vector<std::string> authors;
+    for (int a = 0; a < 200; a++) {
+        authors.push_back("bench_friend" + std::to_string(a));
+    }
+    std::cout << "events  per-author-us  global-us" << std::endl;
+    for (size_t n : checks::sizes(args, {1000, 20000})) {
+        uint64_t cursor = feed.head();
+        GlobalFeed global;
+        for (size_t i = 0; i < n; i++) {
+            std::string author = i % (n / 5) == 0 ? authors[i % 200] : "bench_other" + std::to_string(i % 10000);
+            feed.recordPost((int64_t)i, author);
+            global.events.push_back(GlobalFeed::Event{(int64_t)i, author});
+        }
+        std::vector<TimelineChangeFeed::Event> events;
+        uint64_t head;
+        const size_t kReps = 2000;
+        double perAuthor = checks::timePerCall(kReps, [&] {
+            events.clear();
+            feed.since(cursor, authors, events, head);
+        });
+        if (events.size() != 5 || global.since(0, authors) != 5) {
+            checks::fail(__FILE__, __LINE__, "expected 5 events");
+        }
+        double old = checks::timePerCall(kReps, [&] { checks::keep(global.since(0, authors)); });
+        std::cout << std::setw(6) << n << std::fixed << std::setprecision(2) << std::setw(15) << perAuthor
+                  << std::setw(11) << old << std::endl;
+    }
+}
@@ -0,0 +1,135 @@
+#include "checks.h"
+#include "../services/timeline_index.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+namespace {
+    using AvlIndex = TimelineIndexOf<false>::type;
+    using BlockIndex = TimelineIndexOf<true>::type;
+
+    template <typename Index>
+    std::vector<int64_t> newestFirst(const Index& index) {
+        std::vector<int64_t> ids;
+        for (auto it = index.rbegin(); it != index.rend(); ++it) {
+            ids.push_back(it->getId());
+        }
+        return ids;
+    }
+
+    template <typename Range>
+    std::vector<int64_t> idsOf(const Range& range) {
+        std::vector<int64_t> ids;
+        for (const Post& post : range) {
+            ids.push_back(post.getId());
+        }
+        return ids;
+    }
+
+    // Builds an index of n posts by appending ascending ids, as new posts arrive. Ids are
+    // even so odd ids can be inserted between them later. Posts share one content buffer.
+    template <typename Index>
+    double appendPosts(Index& index, size_t n) {
+        Post prototype(0, "author0", "benchmark post body", "", 0, 0);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; i++) {
+            Post post = prototype;
+            post.setId((int64_t)(2 * i + 2));
+            index.insert(post);
+        }
+        return checks::micros(start) / n;
+    }
+
+    template <typename Index>
+    void benchOne(const char* name, size_t n) {
+        const size_t kOps = std::min<size_t>(10000, n);
+        std::mt19937_64 rng(n);
+        Index index;
+        size_t allocationsBefore = checks::allocations();
+        double append = appendPosts(index, n);
+        double allocsPerPost = double(checks::allocations() - allocationsBefore) / n;
+
+        // Inserts landing between existing posts (late-arriving or backfilled posts)
+        Post prototype(0, "author1", "benchmark post body", "", 0, 0);
+        std::vector<int64_t> middle(kOps);
+        for (int64_t& id : middle) {
+            id = (int64_t)(2 * (rng() % n) + 1);
+        }
+        double insertMiddle = checks::timePerCall(kOps, [&, i = size_t(0)]() mutable {
+            Post post = prototype;
+            post.setId(middle[i++]);
+            index.insert(post);
+        });
+
+        auto scan = [&index](size_t count) {
+            int64_t sum = 0;
+            size_t seen = 0;
+            for (auto it = index.rbegin(); it != index.rend() && seen < count; ++it, ++seen) {
+                sum += it->getId();
+            }
+            checks::keep(sum);
+        };
+        double top50 = checks::timePerCall(2000, [&] { scan(50); });
+        double top1000 = checks::timePerCall(200, [&] { scan(1000); });
+
+        std::vector<int64_t> victims(kOps);
+        for (int64_t& id : victims) {
+            id = (int64_t)(2 * (rng() % n) + 2);
+        }
+        double remove = checks::timePerCall(kOps, [&, i = size_t(0)]() mutable { index.remove(victims[i++]); });
+
+        std::cout << std::left << std::setw(12) << name << std::right << std::setw(10) << n << std::fixed
+                  << std::setprecision(3) << std::setw(12) << append << std::setw(12) << insertMiddle
+                  << std::setw(12) << top50 << std::setw(12) << top1000 << std::setw(12) << remove
+                  << std::setprecision(1) << std::setw(10) << allocsPerPost << std::endl;
+    }
+}
+
+// The AVL tree and the block index must agree on every read through random inserts,
+// replacements and removals
+CHECK_CASE(timeline_index_agree) {
+    AvlIndex avl;
+    BlockIndex blocks;
+    std::mt19937_64 rng(28);
+    for (int step = 0; step < 30000; step++) {
+        int64_t id = (int64_t)(rng() % 8000) + 1;
+        if (rng() % 3 == 0) {
+            avl.remove(id);
+            blocks.remove(id);
+        } else {
+            Post post(id, "author" + std::to_string(rng() % 7), "body", "", 0, 0);
+            avl.insert(post);
+            blocks.insert(post);
+        }
+    }
+    CHECK_EQ(avl.size(), blocks.size());
+    std::vector<int64_t> all = newestFirst(avl);
+    CHECK(std::is_sorted(all.rbegin(), all.rend()));
+    CHECK(all == newestFirst(blocks));
+    for (int64_t cursor : {int64_t(1), int64_t(500), int64_t(4000), int64_t(9000)}) {
+        CHECK(idsOf(avl.before(cursor, 100)) == idsOf(blocks.before(cursor, 100)));
+    }
+    for (int a = 0; a < 7; a++) {
+        std::string author = "author" + std::to_string(a);
+        std::vector<Post> fromAvl = avl.getPostsByUser(author, 40);
+        std::vector<Post> fromBlocks = blocks.getPostsByUser(author, 40);
+        CHECK_EQ(fromAvl.size(), fromBlocks.size());
+        for (size_t i = 0; i < fromAvl.size(); i++) {
+            CHECK_EQ(fromAvl[i].getId(), fromBlocks[i].getId());
+        }
+    }
+}
+
+// Per-operation microseconds for both containers at each size (default 1K and 100K; pass
+// 10000000 for 10M). append: building the index newest-last; insert-mid and remove: 10K
+// operations at random positions; topN: scanning the newest N posts.
+BENCH_CASE(timeline_index_bench) {
+    std::cout << "container         posts   append-us   insert-mid   top50-us  top1000-us   remove-us allocs/post"
+              << std::endl;
+    for (size_t n : checks::sizes(args, {1000, 100000})) {
+        benchOne<AvlIndex>("avl", n);
+        benchOne<BlockIndex>("block", n);
+    }
+}
@@ -0,0 +1,66 @@
+#include "checks.h"
+#include "../services/timeline_precomputer.h"
+
+namespace {
+    // Whether username's first page is served from the cache
+    bool cached(sqlite3* db, const std::string& username) {
+        TimelinePrecomputer& precomputer = TimelinePrecomputer::instance();
+        uint64_t hits = precomputer.stats().hits;
+        precomputer.firstPage(db, username);
+        return precomputer.stats().hits == hits + 1;
+    }
+}
+
+// A page built while someone posts is cached unless that someone is one of the authors the
+// build read, and isn't cached if the user's own friends changed meanwhile
+CHECK_CASE(timeline_precomputer_invalidation) {
+    sqlite3* db = checks::openSchemaDb();
+    checks::exec(db, "INSERT INTO users (id, username) VALUES (1, 'pc_alice'), (2, 'pc_bob'), (3, 'pc_carol'), "
+                     "(4, 'pc_stranger');"
+                     "INSERT INTO friends (requester_id, addressee_id, status) VALUES (1, 2, 'accepted'), "
+                     "(3, 1, 'accepted');"
+                     "INSERT INTO posts (id, user_id, content) VALUES (10, 1, 'a'), (11, 2, 'b'), (12, 3, 'c'), "
+                     "(13, 4, 'd');");
+    TimelinePrecomputer& precomputer = TimelinePrecomputer::instance();
+    precomputer.invalidateUser("pc_alice");
+
+    uint64_t version = 0;
+    {
+        checks::DuringNextQuery during(db, [&] { precomputer.invalidateAuthor("pc_stranger"); });
+        std::vector<Post> page = precomputer.firstPage(db, "pc_alice", &version);
+        CHECK_EQ(page.size(), size_t(3));
+    }
+    CHECK(version != 0);
+    CHECK(cached(db, "pc_alice"));
+
+    for (const char* author : {"pc_bob", "pc_alice"}) {
+        precomputer.invalidateUser("pc_alice");
+        {
+            checks::DuringNextQuery during(db, [&] { precomputer.invalidateAuthor(author); });
+            precomputer.firstPage(db, "pc_alice", &version);
+        }
+        CHECK_EQ(version, uint64_t(0));
+        CHECK(!cached(db, "pc_alice"));  // Builds and caches it again
+        CHECK(cached(db, "pc_alice"));
+    }
+
+    precomputer.invalidateUser("pc_alice");
+    {
+        checks::DuringNextQuery during(db, [&] { precomputer.invalidateUser("pc_alice"); });
+        precomputer.firstPage(db, "pc_alice", &version);
+    }
+    CHECK_EQ(version, uint64_t(0));
+    CHECK(!cached(db, "pc_alice"));
+
+    // Another user's friends changing doesn't matter
+    precomputer.invalidateUser("pc_alice");
+    {
+        checks::DuringNextQuery during(db, [&] { precomputer.invalidateUser("pc_carol"); });
+        precomputer.firstPage(db, "pc_alice", &version);
+    }
+    CHECK(version != 0);
+    CHECK(cached(db, "pc_alice"));
+
+    precomputer.invalidateUser("pc_alice");
+    sqlite3_close(db);
+}
@@ -0,0 +1,103 @@
+#include "checks.h"
+#include "../services/timeline_ranker.h"
+#include "../utils/id_generator.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+    using Candidates = std::vector<std::shared_ptr<const Post>>;
+
+    std::shared_ptr<const Post> post(int64_t id, std::time_t createdAt, int likes, int comments, const char* author) {
+        return std::make_shared<Post>(id, author, "text", "", createdAt, likes, comments);
+    }
+
+    // n generated-id candidates from the last two days by 40 authors, with skewed counters
+    Candidates randomCandidates(size_t n, uint64_t seed) {
+        std::mt19937_64 rng(seed);
+        static const std::vector<std::string> authors = [] {
+            std::vector<std::string> names;
+            for (int a = 0; a < 40; a++) {
+                names.push_back("ranker_author" + std::to_string(a));
+            }
+            return names;
+        }();
+        std::time_t now = std::time(nullptr);
+        Candidates candidates;
+        for (size_t i = 0; i < n; i++) {
+            std::time_t at = now - (std::time_t)(rng() % (2 * 86400));
+            int64_t id = IdGenerator::firstIdAt(at) + (int64_t)(rng() % 4096);
+            int likes = (int)(std::pow((double)(rng() % 1000) / 1000, 4) * 2000);
+            candidates.push_back(post(id, at, likes, likes / 10, authors[rng() % authors.size()].c_str()));
+        }
+        return candidates;
+    }
+
+    double affinityOf(std::string_view author) {
+        return (double)(author.size() % 7);
+    }
+
+    // What topK replaces: score every candidate the same way, then sort them all
+    Candidates sortAll(const Candidates& candidates, size_t k) {
+        TimelineRanker::Weights weights = TimelineRanker::instance().weights();
+        const double decayPerMilli = std::log(2.0) / (weights.halfLifeHours * 3600000.0);
+        std::vector<std::pair<double, size_t>> scored;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const Post& p = *candidates[i];
+            double engagement = 1.0 + weights.like * std::log1p((double)p.getLikeCount()) +
+                                weights.comment * std::log1p((double)p.getCommentCount());
+            double key = std::log(engagement) + std::log1p(weights.affinity * affinityOf(p.getUserName())) +
+                         IdGenerator::millisOf(p.getId()) * decayPerMilli;
+            scored.emplace_back(key, i);
+        }
+        std::sort(scored.begin(), scored.end(), std::greater<std::pair<double, size_t>>());
+        Candidates ranked;
+        for (size_t i = 0; i < std::min(k, scored.size()); i++) {
+            ranked.push_back(candidates[scored[i].second]);
+        }
+        return ranked;
+    }
+}
+
+// Posts whose ids predate the generator are aged by created_at, not as if posted at its epoch
+CHECK_CASE(timeline_ranker_legacy_recency) {
+    TimelineRanker& ranker = TimelineRanker::instance();
+    std::time_t now = std::time(nullptr);
+    auto legacyFresh = post(42, now - 3600, 0, 0, "ranker_a");
+    auto generatedDayOld = post(IdGenerator::firstIdAt(now - 86400), now - 86400, 0, 0, "ranker_b");
+    auto legacyOld = post(7, now - 7 * 86400, 0, 0, "ranker_c");
+    Candidates ranked = ranker.topK({legacyOld, generatedDayOld, legacyFresh}, 3, nullptr);
+    CHECK((ranked == Candidates{legacyFresh, generatedDayOld, legacyOld}));
+    CHECK(!IdGenerator::isGenerated(42));
+    CHECK(IdGenerator::isGenerated(IdGenerator::firstIdAt(now)));
+}
+
+// The bounded heap picks the same posts, in the same order, as scoring and sorting them all
+CHECK_CASE(timeline_ranker_matches_sort) {
+    for (size_t n : {0, 10, 500, 3000}) {
+        Candidates candidates = randomCandidates(n, n);
+        for (size_t k : {1, 50, 600}) {
+            CHECK(TimelineRanker::instance().topK(candidates, k, affinityOf) == sortAll(candidates, k));
+        }
+    }
+}
+
+// Microseconds to pick the top 50 of n candidates (default 10K): the bounded heap against
+// scoring and sorting all of them
+BENCH_CASE(timeline_ranker_bench) {
+    std::cout << "candidates   heap-us   sort-us" << std::endl;
+    for (size_t n : checks::sizes(args, {10000})) {
+        Candidates candidates = randomCandidates(n, 43);
+        if (TimelineRanker::instance().topK(candidates, 50, affinityOf) != sortAll(candidates, 50)) {
+            checks::fail(__FILE__, __LINE__, "top 50 differs from the full sort");
+        }
+        const size_t kReps = 50;
+        double heap = checks::timePerCall(kReps, [&] {
+            checks::keep(TimelineRanker::instance().topK(candidates, 50, affinityOf).size());
+        });
+        double sorted = checks::timePerCall(kReps, [&] { checks::keep(sortAll(candidates, 50).size()); });
+        std::cout << std::setw(10) << n << std::fixed << std::setprecision(0) << std::setw(10) << heap
+                  << std::setw(10) << sorted << std::endl;
+    }
+}
@@ -0,0 +1,66 @@
+#include "checks.h"
+#include "../services/post_store.h"
+#include "../services/timeline_response_cache.h"
+
+namespace {
+    bool cachedPage(const std::string& username, int64_t cursor, uint64_t version) {
+        return TimelineResponseCache::instance().find(username, cursor, version) != nullptr;
+    }
+}
+
+// Stored pages are found by (user, cursor, version), dropped when one of their posts changes,
+// and not stored at all when a post on them changed between reading it and storing the page
+CHECK_CASE(timeline_response_cache_invalidation) {
+    TimelineResponseCache& cache = TimelineResponseCache::instance();
+    {
+        TimelineResponseCache::BuildScope build;
+        auto stored = cache.store(build, "rc_alice", 0, 7, "[1,2,3]", {3, 2, 1});
+        CHECK_EQ(stored->nextCursor, int64_t(1));
+        CHECK_EQ(stored->etag, TimelineResponseCache::makeEtag("[1,2,3]"));
+        cache.store(build, "rc_alice", 1, 7, "[0]", {0});
+        cache.store(build, "rc_bob", 0, 3, "[2,9]", {9, 2});
+    }
+    auto hit = cache.find("rc_alice", 0, 7);
+    CHECK(hit && hit->body == "[1,2,3]");
+    CHECK(!cachedPage("rc_alice", 0, 8));  // A new version drops the old page
+    CHECK(!cachedPage("rc_alice", 0, 7));
+
+    {
+        TimelineResponseCache::BuildScope build;
+        cache.store(build, "rc_alice", 0, 8, "[1,2,3]", {3, 2, 1});
+    }
+    PostStore::instance().invalidate(2);  // Through PostStore's listener, as a like does
+    CHECK(!cachedPage("rc_alice", 0, 8));
+    CHECK(!cachedPage("rc_bob", 0, 3));
+    CHECK(cachedPage("rc_alice", 1, 7));
+
+    // A like landing after the page's posts were read but before it is stored
+    sqlite3* db = checks::openSchemaDb();
+    checks::exec(db, "INSERT INTO users (id, username) VALUES (1, 'rc_carol');"
+                     "INSERT INTO posts (id, user_id, content, like_count) VALUES (40, 1, 'a', 0), (41, 1, 'b', 0);");
+    uint64_t raced = cache.stats().raced;
+    {
+        TimelineResponseCache::BuildScope build;
+        auto posts = PostStore::instance().multiGet(db, {41, 40});
+        CHECK_EQ(posts[1]->getLikeCount(), 0);
+        checks::exec(db, "UPDATE posts SET like_count = 1 WHERE id = 40;");
+        PostStore::instance().invalidate(40);
+        auto response = cache.store(build, "rc_carol", 0, 1, "[41,40]", {41, 40});
+        CHECK(response->body == "[41,40]");  // Still served, just not kept
+    }
+    CHECK_EQ(cache.stats().raced, raced + 1);
+    CHECK(!cachedPage("rc_carol", 0, 1));
+
+    // A change to some other post during the build doesn't matter
+    {
+        TimelineResponseCache::BuildScope build;
+        PostStore::instance().invalidate(99);
+        cache.store(build, "rc_carol", 0, 1, "[41,40]", {41, 40});
+    }
+    CHECK(cachedPage("rc_carol", 0, 1));
+    PostStore::instance().invalidate(40);
+    CHECK(!cachedPage("rc_carol", 0, 1));
+
+    PostStore::instance().clear();
+    sqlite3_close(db);
+}
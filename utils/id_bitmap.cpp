@@ -0,0 +1,290 @@
+#include "id_bitmap.h"
+#include <algorithm>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace {
+    // Calls onMatch(low) for every value in both sorted arrays, ascending. A much smaller
+    // array is searched for in the larger one instead of merging the two.
+    template <typename F>
+    void visitArrays(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, F onMatch) {
+        if (na > nb) {
+            std::swap(a, b);
+            std::swap(na, nb);
+        }
+        if (na * 32 < nb) {
+            const uint16_t* from = b;
+            const uint16_t* end = b + nb;
+            for (size_t i = 0; i < na && from != end; i++) {
+                from = std::lower_bound(from, end, a[i]);
+                if (from != end && *from == a[i]) {
+                    onMatch(a[i]);
+                }
+            }
+            return;
+        }
+        size_t i = 0, j = 0;
+        while (i < na && j < nb) {
+            uint16_t x = a[i], y = b[j];
+            if (x == y) {
+                onMatch(x);
+            }
+            i += x <= y;
+            j += y <= x;
+        }
+    }
+
+    template <typename F>
+    void visitArrayBitmap(const uint16_t* a, size_t na, const uint64_t* bits, F onMatch) {
+        for (size_t i = 0; i < na; i++) {
+            if (bits[a[i] >> 6] >> (a[i] & 63) & 1) {
+                onMatch(a[i]);
+            }
+        }
+    }
+
+    // Bits set in both of two bitmap containers; words is a multiple of 4
+    size_t andPopcount(const uint64_t* a, const uint64_t* b, size_t words) {
+        size_t total = 0;
+#ifdef __AVX2__
+        // Per-nibble popcount by table lookup, summed per 64-bit lane
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i lowNibbles = _mm256_set1_epi8(0x0f);
+        __m256i sums = _mm256_setzero_si256();
+        for (size_t i = 0; i < words; i += 4) {
+            __m256i v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+            __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, lowNibbles));
+            __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), lowNibbles));
+            sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+        }
+        total = (size_t)_mm256_extract_epi64(sums, 0) + (size_t)_mm256_extract_epi64(sums, 1) +
+                (size_t)_mm256_extract_epi64(sums, 2) + (size_t)_mm256_extract_epi64(sums, 3);
+#else
+        for (size_t i = 0; i < words; i++) {
+            total += __builtin_popcountll(a[i] & b[i]);
+        }
+#endif
+        return total;
+    }
+}
+
+IdBitmap::IdBitmap(const uint32_t* begin, const uint32_t* end) {
+    while (begin != end) {
+        uint16_t key = (uint16_t)(*begin >> 16);
+        const uint32_t* groupEnd = std::find_if(begin, end, [key](uint32_t id) { return (id >> 16) != key; });
+        Container container;
+        container.key = key;
+        container.count = (uint32_t)(groupEnd - begin);
+        container.array.reserve(container.count);
+        for (const uint32_t* it = begin; it != groupEnd; ++it) {
+            container.array.push_back((uint16_t)*it);
+        }
+        if (container.count > kArrayMax) {
+            container.toBitmap();
+        }
+        containers.push_back(std::move(container));
+        begin = groupEnd;
+    }
+}
+
+bool IdBitmap::add(uint32_t id) {
+    uint16_t key = (uint16_t)(id >> 16);
+    uint16_t low = (uint16_t)id;
+    auto it = find(key);
+    if (it == containers.end() || it->key != key) {
+        Container container;
+        container.key = key;
+        container.count = 1;
+        container.array.push_back(low);
+        containers.insert(it, std::move(container));
+        return true;
+    }
+    if (it->isBitmap()) {
+        uint64_t& word = it->bitmap[low >> 6];
+        uint64_t bit = uint64_t(1) << (low & 63);
+        if (word & bit) {
+            return false;
+        }
+        word |= bit;
+        it->count++;
+        return true;
+    }
+    auto pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+    if (pos != it->array.end() && *pos == low) {
+        return false;
+    }
+    it->array.insert(pos, low);
+    it->count++;
+    if (it->count > kArrayMax) {
+        it->toBitmap();
+    }
+    return true;
+}
+
+bool IdBitmap::remove(uint32_t id) {
+    uint16_t key = (uint16_t)(id >> 16);
+    uint16_t low = (uint16_t)id;
+    auto it = find(key);
+    if (it == containers.end() || it->key != key) {
+        return false;
+    }
+    if (it->isBitmap()) {
+        uint64_t& word = it->bitmap[low >> 6];
+        uint64_t bit = uint64_t(1) << (low & 63);
+        if ((word & bit) == 0) {
+            return false;
+        }
+        word &= ~bit;
+        if (--it->count <= kArrayMax) {
+            it->toArray();
+        }
+        return true;
+    }
+    auto pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+    if (pos == it->array.end() || *pos != low) {
+        return false;
+    }
+    it->array.erase(pos);
+    if (--it->count == 0) {
+        containers.erase(it);
+    }
+    return true;
+}
+
+bool IdBitmap::contains(uint32_t id) const {
+    uint16_t key = (uint16_t)(id >> 16);
+    uint16_t low = (uint16_t)id;
+    auto it = find(key);
+    if (it == containers.end() || it->key != key) {
+        return false;
+    }
+    if (it->isBitmap()) {
+        return it->bitmap[low >> 6] >> (low & 63) & 1;
+    }
+    return std::binary_search(it->array.begin(), it->array.end(), low);
+}
+
+size_t IdBitmap::size() const {
+    size_t total = 0;
+    for (const Container& container : containers) {
+        total += container.count;
+    }
+    return total;
+}
+
+size_t IdBitmap::bytes() const {
+    size_t total = sizeof(*this) + containers.capacity() * sizeof(Container);
+    for (const Container& container : containers) {
+        total += container.array.capacity() * sizeof(uint16_t) + container.bitmap.capacity() * sizeof(uint64_t);
+    }
+    return total;
+}
+
+size_t IdBitmap::intersectionCount(const IdBitmap& other) const {
+    size_t total = 0;
+    auto a = containers.begin();
+    auto b = other.containers.begin();
+    while (a != containers.end() && b != other.containers.end()) {
+        if (a->key < b->key) {
+            ++a;
+        } else if (b->key < a->key) {
+            ++b;
+        } else {
+            total += countBoth(*a, *b);
+            ++a;
+            ++b;
+        }
+    }
+    return total;
+}
+
+std::vector<uint32_t> IdBitmap::intersection(const IdBitmap& other) const {
+    std::vector<uint32_t> out;
+    auto a = containers.begin();
+    auto b = other.containers.begin();
+    while (a != containers.end() && b != other.containers.end()) {
+        if (a->key < b->key) {
+            ++a;
+        } else if (b->key < a->key) {
+            ++b;
+        } else {
+            appendBoth(*a, *b, out);
+            ++a;
+            ++b;
+        }
+    }
+    return out;
+}
+
+bool IdBitmap::usesAvx2() {
+#ifdef __AVX2__
+    return true;
+#else
+    return false;
+#endif
+}
+
+void IdBitmap::Container::toBitmap() {
+    bitmap.assign(kBitmapWords, 0);
+    for (uint16_t low : array) {
+        bitmap[low >> 6] |= uint64_t(1) << (low & 63);
+    }
+    std::vector<uint16_t>().swap(array);
+}
+
+void IdBitmap::Container::toArray() {
+    array.clear();
+    array.reserve(count);
+    for (size_t w = 0; w < kBitmapWords; w++) {
+        for (uint64_t word = bitmap[w]; word != 0; word &= word - 1) {
+            array.push_back((uint16_t)(w * 64 + __builtin_ctzll(word)));
+        }
+    }
+    std::vector<uint64_t>().swap(bitmap);
+}
+
+std::vector<IdBitmap::Container>::iterator IdBitmap::find(uint16_t key) {
+    return std::lower_bound(containers.begin(), containers.end(), key,
+                            [](const Container& container, uint16_t k) { return container.key < k; });
+}
+
+std::vector<IdBitmap::Container>::const_iterator IdBitmap::find(uint16_t key) const {
+    return std::lower_bound(containers.begin(), containers.end(), key,
+                            [](const Container& container, uint16_t k) { return container.key < k; });
+}
+
+size_t IdBitmap::countBoth(const Container& a, const Container& b) {
+    size_t count = 0;
+    auto onMatch = [&count](uint16_t) { count++; };
+    if (a.isBitmap() && b.isBitmap()) {
+        return andPopcount(a.bitmap.data(), b.bitmap.data(), kBitmapWords);
+    } else if (a.isBitmap()) {
+        visitArrayBitmap(b.array.data(), b.array.size(), a.bitmap.data(), onMatch);
+    } else if (b.isBitmap()) {
+        visitArrayBitmap(a.array.data(), a.array.size(), b.bitmap.data(), onMatch);
+    } else {
+        visitArrays(a.array.data(), a.array.size(), b.array.data(), b.array.size(), onMatch);
+    }
+    return count;
+}
+
+void IdBitmap::appendBoth(const Container& a, const Container& b, std::vector<uint32_t>& out) {
+    uint32_t high = (uint32_t)a.key << 16;
+    auto onMatch = [&out, high](uint16_t low) { out.push_back(high | low); };
+    if (a.isBitmap() && b.isBitmap()) {
+        for (size_t w = 0; w < kBitmapWords; w++) {
+            for (uint64_t word = a.bitmap[w] & b.bitmap[w]; word != 0; word &= word - 1) {
+                onMatch((uint16_t)(w * 64 + __builtin_ctzll(word)));
+            }
+        }
+    } else if (a.isBitmap()) {
+        visitArrayBitmap(b.array.data(), b.array.size(), a.bitmap.data(), onMatch);
+    } else if (b.isBitmap()) {
+        visitArrayBitmap(a.array.data(), a.array.size(), b.bitmap.data(), onMatch);
+    } else {
+        visitArrays(a.array.data(), a.array.size(), b.array.data(), b.array.size(), onMatch);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed set of 32-bit ids, after Roaring bitmaps: ids are grouped by their high 16
+// bits, and each group is a sorted array of the low halves while it has at most
+// kArrayMax members, or a 65536-bit bitmap once it's denser. A set of ten ids is a few
+// dozen bytes; a set of 100K clustered ids is a handful of 8 KB bitmaps.
+//
+// Intersections pick a method per pair of containers: merge (or galloping search when one
+// array is much smaller) for two arrays, bit probes for an array against a bitmap, and a
+// word-wise AND with popcount for two bitmaps. Building with AVX2 (FRIEND_SETS_AVX2 in
+// CMake) does the last 256 bits at a time.
+class IdBitmap {
+public:
+    IdBitmap() = default;
+    // From ids in ascending order, without repeats
+    IdBitmap(const uint32_t* begin, const uint32_t* end);
+
+    bool add(uint32_t id);     // False if already present
+    bool remove(uint32_t id);  // False if absent
+    bool contains(uint32_t id) const;
+    size_t size() const;
+    bool empty() const { return containers.empty(); }
+    size_t bytes() const;
+
+    // |this ∩ other| without materializing the intersection
+    size_t intersectionCount(const IdBitmap& other) const;
+    // this ∩ other, ascending
+    std::vector<uint32_t> intersection(const IdBitmap& other) const;
+
+    // Whether this build counts bitmap intersections with AVX2
+    static bool usesAvx2();
+
+private:
+    static constexpr size_t kArrayMax = 4096;
+    static constexpr size_t kBitmapWords = 65536 / 64;
+
+    struct Container {
+        uint16_t key;                   // High 16 bits shared by every member
+        uint32_t count;                 // Members
+        std::vector<uint16_t> array;    // Low halves, ascending, while count <= kArrayMax
+        std::vector<uint64_t> bitmap;   // kBitmapWords words once denser
+
+        bool isBitmap() const { return !bitmap.empty(); }
+        void toBitmap();
+        void toArray();
+    };
+
+    std::vector<Container> containers;  // Ascending by key
+
+    std::vector<Container>::iterator find(uint16_t key);
+    std::vector<Container>::const_iterator find(uint16_t key) const;
+
+    static size_t countBoth(const Container& a, const Container& b);
+    static void appendBoth(const Container& a, const Container& b, std::vector<uint32_t>& out);
+};
@@ -0,0 +1,48 @@
+#include "id_generator.h"
+#include "time_utils.h"
+#include <algorithm>
+#include <thread>
+
+IdGenerator& IdGenerator::posts() {
+    static IdGenerator generator;
+    return generator;
+}
+
+IdGenerator& IdGenerator::comments() {
+    static IdGenerator generator;
+    return generator;
+}
+
+int64_t IdGenerator::next() {
+    int64_t previous = last.load();
+    while (true) {
+        int64_t now = (time_utils::nowMillis() - kEpochMillis) << kSequenceBits;
+        // Same millisecond (or a clock step back): take the next sequence number
+        int64_t id = std::max(now, previous + 1);
+        if ((id >> kSequenceBits) == (now >> kSequenceBits) + 1 && (id & kSequenceMask) == 0) {
+            // All 4096 ids of this millisecond are taken: wait for the next one rather than
+            // stamp ids ahead of the clock. After a step back ids still run ahead, unwaited.
+            std::this_thread::yield();
+            previous = last.load();
+            continue;
+        }
+        if (last.compare_exchange_weak(previous, id)) {
+            return id;
+        }
+    }
+}
+
+void IdGenerator::seedAbove(int64_t existing) {
+    int64_t previous = last.load();
+    while (previous < existing && !last.compare_exchange_weak(previous, existing)) {
+    }
+}
+
+int64_t IdGenerator::millisOf(int64_t id) {
+    return (id >> kSequenceBits) + kEpochMillis;
+}
+
+int64_t IdGenerator::firstIdAt(std::time_t t) {
+    int64_t millis = static_cast<int64_t>(t) * 1000 - kEpochMillis;
+    return millis > 0 ? millis << kSequenceBits : 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+// Time-sortable 64-bit ids for posts and comments (Snowflake-style).
+//
+//   bits 52..12  milliseconds since kEpochMillis (41 bits, ~69 years)
+//   bits 11..0   sequence within the millisecond (4096 ids/ms)
+//
+// Ids fit in 53 bits, so JavaScript clients read them exactly. They increase strictly
+// within a process, even if the clock steps back; once a millisecond's sequence runs out,
+// next() waits for the clock to move on. Ids handed out by the database before the switch
+// (small autoincrement values) all sort below every generated one.
+class IdGenerator {
+public:
+    static constexpr int64_t kEpochMillis = 1704067200000LL;  // 2024-01-01T00:00:00Z
+    static constexpr int kSequenceBits = 12;
+    static constexpr int64_t kSequenceMask = (int64_t(1) << kSequenceBits) - 1;
+    // Generated ids are at least this (17 minutes past kEpochMillis); rowids SQLite handed
+    // out before the switch stay far below it
+    static constexpr int64_t kFirstGeneratedId = int64_t(1) << 32;
+
+    static IdGenerator& posts();
+    static IdGenerator& comments();
+
+    int64_t next();
+
+    // Ensures every later id is greater than existing (e.g. the largest id already stored)
+    void seedAbove(int64_t existing);
+
+    // Creation time encoded in a generated id, in epoch milliseconds. Meaningless for ids
+    // that weren't generated; see isGenerated.
+    static int64_t millisOf(int64_t id);
+    static bool isGenerated(int64_t id) { return id >= kFirstGeneratedId; }
+    // Smallest id that can be generated at or after epoch second t
+    static int64_t firstIdAt(std::time_t t);
+
+private:
+    IdGenerator() : last(0) {}
+
+    std::atomic<int64_t> last;
+};
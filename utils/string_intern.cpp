@@ -0,0 +1,71 @@
+#include "string_intern.h"
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+    const std::string emptyString;
+
+    // Process-wide atom table. Strings live in a deque so their addresses never change,
+    // and the map keys are views into those strings.
+    struct AtomTable {
+        std::shared_mutex mutex;
+        std::deque<std::string> storage;
+        std::unordered_map<std::string_view, const std::string*> index;
+        size_t heapBytes = 0;  // Text too long for the small-string buffer
+
+        const std::string* intern(std::string_view text) {
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex);
+                auto it = index.find(text);
+                if (it != index.end()) {
+                    return it->second;
+                }
+            }
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            auto it = index.find(text);  // Another thread may have added it meanwhile
+            if (it != index.end()) {
+                return it->second;
+            }
+            storage.emplace_back(text);
+            const std::string* stored = &storage.back();
+            index.emplace(std::string_view(*stored), stored);
+            if (stored->capacity() > std::string().capacity()) {
+                heapBytes += stored->capacity() + 1;
+            }
+            return stored;
+        }
+
+        Atom::TableStats stats() {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            size_t perAtom = sizeof(std::string) + sizeof(std::pair<std::string_view, const std::string*>) +
+                             2 * sizeof(void*);  // Hash node and bucket
+            return Atom::TableStats{storage.size(), storage.size() * perAtom + heapBytes};
+        }
+    };
+
+    AtomTable& atomTable() {
+        static AtomTable table;
+        return table;
+    }
+}
+
+Atom::Atom() : text(&emptyString) {}
+
+Atom::Atom(std::string_view text)
+    : text(text.empty() ? &emptyString : atomTable().intern(text)) {}
+
+Atom::TableStats Atom::tableStats() {
+    return atomTable().stats();
+}
+
+SharedText::SharedText(std::string text) {
+    if (!text.empty()) {
+        this->text = std::make_shared<const std::string>(std::move(text));
+    }
+}
+
+const std::string& SharedText::str() const {
+    return text ? *text : emptyString;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Interned string for short, heavily repeated values such as usernames.
+// Every distinct value is stored once for the life of the process and equal atoms share
+// that storage, so an Atom is one pointer wide, copies for free and compares by address.
+// The referenced text never moves, so views into it stay valid forever.
+//
+// The table is never pruned: it grows by every distinct value ever interned. Only intern
+// values drawn from a bounded set such as usernames (about 70 bytes each plus text longer
+// than the small-string buffer), never free text. tableStats() reports its size.
+class Atom {
+public:
+    struct TableStats {
+        size_t atoms;
+        size_t bytes;  // Approximate: stored strings plus index entries
+    };
+
+    Atom();
+    explicit Atom(std::string_view text);
+
+    static TableStats tableStats();
+
+    std::string_view view() const { return *text; }
+    const std::string& str() const { return *text; }
+    const char* c_str() const { return text->c_str(); }
+    bool empty() const { return text->empty(); }
+
+    bool operator==(const Atom& other) const { return text == other.text; }
+    bool operator!=(const Atom& other) const { return text != other.text; }
+
+private:
+    const std::string* text;
+};
+
+// Immutable, reference-counted text for post and comment bodies and other long values.
+// Copies share one buffer instead of duplicating it; empty text allocates nothing.
+class SharedText {
+public:
+    SharedText() = default;
+    explicit SharedText(std::string text);
+
+    std::string_view view() const { return text ? std::string_view(*text) : std::string_view(); }
+    const std::string& str() const;
+    const char* c_str() const { return str().c_str(); }
+    size_t size() const { return text ? text->size() : 0; }
+    bool empty() const { return size() == 0; }
+
+private:
+    std::shared_ptr<const std::string> text;
+};
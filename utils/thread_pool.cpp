@@ -0,0 +1,73 @@
+#include "thread_pool.h"
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+ThreadPool::ThreadPool(size_t threads, int niceness) : stopping(false) {
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::run, this, niceness);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    ready.notify_one();
+}
+
+size_t ThreadPool::pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.size();
+}
+
+size_t ThreadPool::discardPending() {
+    std::deque<std::function<void()>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dropped.swap(tasks);
+    }
+    return dropped.size();  // Destroyed outside the lock
+}
+
+void ThreadPool::run(int niceness) {
+#ifdef __linux__
+    // On Linux the nice value is per thread, so this leaves the request threads untouched
+    if (niceness != 0 && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), niceness) != 0) {
+        std::cerr << "ThreadPool: could not lower worker priority" << std::endl;
+    }
+#else
+    (void)niceness;
+#endif
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;  // Stopping, and everything submitted has run
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "ThreadPool task failed: " << e.what() << std::endl;
+        }
+    }
+}
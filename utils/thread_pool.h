@@ -0,0 +1,39 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads draining a FIFO task queue.
+//
+// Workers can be started at a lower scheduling priority (a positive nice value) so that
+// background work only gets CPU the request threads aren't using. Destroying the pool
+// runs every task already submitted, then joins the workers, so a caller waiting on a
+// task's future always gets its result. Owners of fire-and-forget work that shouldn't
+// delay shutdown call discardPending() first.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads, int niceness = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    size_t pending() const;
+
+    // Drops the tasks that haven't started and returns how many there were. Only for tasks
+    // nobody waits on: a dropped packaged_task leaves its future with broken_promise.
+    size_t discardPending();
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::thread> workers;
+    bool stopping;
+
+    void run(int niceness);
+};
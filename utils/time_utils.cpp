@@ -0,0 +1,234 @@
+#include "time_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace {
+    // "00".."99" so each two-digit field is a single 2-byte copy
+    const char kDigitPairs[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    inline void putPair(char* out, unsigned value) {
+        std::memcpy(out, kDigitPairs + 2 * value, 2);
+    }
+
+    // Days since 1970-01-01 to a proleptic Gregorian (year, month, day); no loops or tables
+    inline void civilFromDays(int64_t z, int64_t& year, unsigned& month, unsigned& day) {
+        z += 719468;
+        const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        const unsigned doe = static_cast<unsigned>(z - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        day = doy - (153 * mp + 2) / 5 + 1;
+        month = mp < 10 ? mp + 3 : mp - 9;
+        year = static_cast<int64_t>(yoe) + era * 400 + (month <= 2);
+    }
+
+    // Inverse of civilFromDays: proleptic Gregorian date to days since 1970-01-01
+    inline int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+        year -= month <= 2;
+        const int64_t era = (year >= 0 ? year : year - 399) / 400;
+        const unsigned yoe = static_cast<unsigned>(year - era * 400);
+        const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<int64_t>(doe) - 719468;
+    }
+
+    // Reads exactly n digits starting at text[pos]
+    inline bool readDigits(std::string_view text, size_t pos, size_t n, unsigned& value) {
+        value = 0;
+        for (size_t i = pos; i < pos + n; i++) {
+            unsigned d = static_cast<unsigned char>(text[i]) - '0';
+            if (d > 9) {
+                return false;
+            }
+            value = value * 10 + d;
+        }
+        return true;
+    }
+
+    inline int64_t floorDiv(int64_t a, int64_t b) {
+        return (a >= 0 ? a : a - (b - 1)) / b;
+    }
+
+    long offsetAt(int64_t t) {
+        std::time_t instant = static_cast<std::time_t>(t);
+        std::tm local;
+        localtime_r(&instant, &local);
+        return local.tm_gmtoff;
+    }
+
+    // Per-thread cache of UTC offsets over whole intervals between zone transitions: a DST
+    // period, or two years at a time in zones without DST. Intervals are kept sorted, so
+    // timestamps spread over decades cost one miss per interval, then a binary search.
+    //
+    // A miss finds the transitions around t by probing a week at a time, then narrowing to
+    // the quarter hour (zones only change offset on 15-minute boundaries of UTC). That
+    // assumes transitions are more than a week apart, as they are throughout the tz database.
+    struct OffsetCache {
+        static const size_t kMaxIntervals = 512;  // Over 250 years of DST; then start over
+        static const int64_t kQuarterHour = 900;
+        static const int64_t kWeek = 7 * 86400;
+        static const int64_t kSearchSpan = 366 * 86400;
+
+        struct Interval {
+            int64_t start;  // Inclusive
+            int64_t end;    // Exclusive
+            long offset;
+        };
+        std::vector<Interval> intervals;  // Sorted by start, disjoint
+        size_t last = 0;                  // Index of the interval that answered last
+
+        long lookup(int64_t t) {
+            if (last < intervals.size() && intervals[last].start <= t && t < intervals[last].end) {
+                return intervals[last].offset;
+            }
+            auto it = std::upper_bound(intervals.begin(), intervals.end(), t,
+                                       [](int64_t value, const Interval& interval) { return value < interval.start; });
+            if (it != intervals.begin() && t < std::prev(it)->end) {
+                last = std::prev(it) - intervals.begin();
+                return intervals[last].offset;
+            }
+
+            long offset = offsetAt(t);
+            if (intervals.size() >= kMaxIntervals) {
+                intervals.clear();
+                it = intervals.end();
+            }
+            // Neighbours found on earlier misses bound the search, so intervals never overlap
+            int64_t start = transitionAtOrBefore(t, offset);
+            int64_t end = transitionAfter(t, offset);
+            if (it != intervals.begin()) {
+                start = std::max(start, std::prev(it)->end);
+            }
+            if (it != intervals.end()) {
+                end = std::min(end, it->start);
+            }
+            last = intervals.insert(it, Interval{start, end, offset}) - intervals.begin();
+            return offset;
+        }
+
+        // First quarter-hour boundary after t where the offset stops being offset, or the end
+        // of the search span if there is none
+        static int64_t transitionAfter(int64_t t, long offset) {
+            int64_t same = t;
+            for (int64_t probe = t + kWeek; probe <= t + kSearchSpan; same = probe, probe += kWeek) {
+                if (offsetAt(probe) != offset) {
+                    return narrow(floorDiv(same, kQuarterHour), floorDiv(probe, kQuarterHour), offset, true);
+                }
+            }
+            return same;
+        }
+
+        // Last quarter-hour boundary at or before t where the offset became offset, or the
+        // start of the search span if there is none
+        static int64_t transitionAtOrBefore(int64_t t, long offset) {
+            int64_t same = t;
+            for (int64_t probe = t - kWeek; probe >= t - kSearchSpan; same = probe, probe -= kWeek) {
+                if (offsetAt(probe) != offset) {
+                    return narrow(floorDiv(probe, kQuarterHour), floorDiv(same, kQuarterHour), offset, false);
+                }
+            }
+            return same;
+        }
+
+        // Binary search over quarter hours lo < q <= hi for the boundary between quarter hours
+        // with offset and those without. If sameIsLow, quarter hour lo has offset and hi
+        // doesn't; otherwise the reverse.
+        static int64_t narrow(int64_t lo, int64_t hi, long offset, bool sameIsLow) {
+            while (hi - lo > 1) {
+                int64_t mid = lo + (hi - lo) / 2;
+                if ((offsetAt(mid * kQuarterHour) == offset) == sameIsLow) {
+                    lo = mid;
+                } else {
+                    hi = mid;
+                }
+            }
+            return hi * kQuarterHour;
+        }
+    };
+}
+
+namespace time_utils {
+
+long utcOffsetSeconds(std::time_t t) {
+    thread_local OffsetCache cache;
+    return cache.lookup(static_cast<int64_t>(t));
+}
+
+size_t formatIso8601(std::time_t t, char* out, char separator) {
+    int64_t local = static_cast<int64_t>(t) + utcOffsetSeconds(t);
+    int64_t days = (local >= 0 ? local : local - 86399) / 86400;
+    unsigned secs = static_cast<unsigned>(local - days * 86400);
+
+    int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+    unsigned y = year < 0 ? 0 : year > 9999 ? 9999 : static_cast<unsigned>(year);
+
+    putPair(out, y / 100);
+    putPair(out + 2, y % 100);
+    out[4] = '-';
+    putPair(out + 5, month);
+    out[7] = '-';
+    putPair(out + 8, day);
+    out[10] = separator;
+    putPair(out + 11, secs / 3600);
+    out[13] = ':';
+    putPair(out + 14, secs / 60 % 60);
+    out[16] = ':';
+    putPair(out + 17, secs % 60);
+    out[19] = '\0';
+    return 19;
+}
+
+std::string toIso8601(std::time_t t, char separator) {
+    char buf[kIsoBufferSize];
+    return std::string(buf, formatIso8601(t, buf, separator));
+}
+
+std::string nowString() {
+    thread_local std::time_t cachedSecond = -1;
+    thread_local char cached[kIsoBufferSize];
+    std::time_t now = std::time(nullptr);
+    if (now != cachedSecond) {
+        formatIso8601(now, cached, ' ');
+        cachedSecond = now;
+    }
+    return std::string(cached, kIsoBufferSize - 1);
+}
+
+int64_t nowMillis() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+bool parseDateTime(std::string_view text, int64_t& epochMillis) {
+    // YYYY-MM-DD?HH:MM:SS is 19 characters; anything shorter can't be a full timestamp
+    if (text.size() < 19 || text[4] != '-' || text[7] != '-' || (text[10] != ' ' && text[10] != 'T')
+        || text[13] != ':' || text[16] != ':') {
+        return false;
+    }
+    unsigned year, month, day, hour, minute, second, millis = 0;
+    if (!readDigits(text, 0, 4, year) || !readDigits(text, 5, 2, month) || !readDigits(text, 8, 2, day)
+        || !readDigits(text, 11, 2, hour) || !readDigits(text, 14, 2, minute) || !readDigits(text, 17, 2, second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+    if (text.size() >= 23 && text[19] == '.' && !readDigits(text, 20, 3, millis)) {
+        return false;
+    }
+    int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    epochMillis = seconds * 1000 + millis;
+    return true;
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+// Thread-safe local-time formatting shared by every JSON serializer.
+//
+// Avoids std::localtime (a shared static buffer, and glibc takes its tz lock on every call):
+// the UTC offset is cached per thread for the whole interval between DST transitions, and the
+// calendar fields are computed arithmetically and written digit-pairs at a time into the
+// caller's buffer.
+namespace time_utils {
+    // "YYYY-MM-DDTHH:MM:SS" plus the terminating NUL
+    constexpr size_t kIsoBufferSize = 20;
+
+    // Local-time offset from UTC, in seconds, in effect at time t
+    long utcOffsetSeconds(std::time_t t);
+
+    // Writes t as local "YYYY-MM-DD<separator>HH:MM:SS" into out (at least kIsoBufferSize
+    // bytes, NUL-terminated). Returns the number of characters written, excluding the NUL.
+    size_t formatIso8601(std::time_t t, char* out, char separator = 'T');
+    std::string toIso8601(std::time_t t, char separator = 'T');
+
+    // Current local time as "YYYY-MM-DD HH:MM:SS", reformatted at most once per second per thread
+    std::string nowString();
+
+    // Milliseconds since the Unix epoch; the unit of every created_at column
+    int64_t nowMillis();
+
+    // Parses SQLite's UTC "YYYY-MM-DD HH:MM:SS[.SSS]" (or with 'T') into epoch milliseconds.
+    // Returns false if text isn't in that shape.
+    bool parseDateTime(std::string_view text, int64_t& epochMillis);
+}